@@ -21,6 +21,8 @@
 
 #pragma link C++ function BuildTree;
 #pragma link C++ function TreeToHepMC;
+#pragma link C++ function BuildHepMC;
+#pragma link C++ function SmearedTreeToHepMC;
 
 // Particle classes
 
@@ -32,6 +34,19 @@
 // Base event classes
 
 #pragma link C++ class erhic::EventMC+;
+// Older files don't store the scattered lepton index, so mark it unresolved
+// rather than keeping the value from a previously read event.
+#pragma read sourceClass="erhic::EventMC" version="[-2]" \
+  targetClass="erhic::EventMC" source="" target="mScatteredIndex" \
+  code="{ mScatteredIndex = -2; }"
+// Reading a new event into an existing object discards the cached sums
+// and beams.
+#pragma read sourceClass="erhic::EventMC" version="[1-]" \
+  targetClass="erhic::EventMC" source="" target="mFinalStateSumsValid" \
+  code="{ mFinalStateSumsValid = false; }"
+#pragma read sourceClass="erhic::EventMC" version="[1-]" \
+  targetClass="erhic::EventMC" source="" target="mBeamsIdentified" \
+  code="{ mBeamsIdentified = false; }"
 #pragma link C++ class erhic::VirtualEvent+;
 #pragma link C++ class erhic::EventDis+;
 
@@ -71,6 +86,8 @@
 
 #pragma link C++ class erhic::Forester+;
 #pragma link C++ class erhic::Forester::Status+;
+#pragma link C++ class erhic::InputPolicy+;
+#pragma link C++ class erhic::OutputPolicy+;
 
 // Monte carlo log file processing
 
@@ -27,18 +27,72 @@
 
 // Functions
 #pragma link C++ function SmearTree;
+#pragma link C++ function SmearTreeShards;
+#pragma link C++ function CompileDetector;
+#pragma link C++ function LoadDetector;
 
 // Event structures
 #pragma link C++ class Smear::Event+;
+// Older files store one entry per Monte Carlo track
+#pragma read sourceClass="Smear::Event" version="[-1]" \
+  targetClass="Smear::Event" source="" target="mSparse" \
+  code="{ mSparse = false; }"
+// Reading a new event discards the lookup by Monte Carlo track
+#pragma read sourceClass="Smear::Event" version="[1-]" \
+  targetClass="Smear::Event" source="" target="mSmearedIndicesValid" \
+  code="{ mSmearedIndicesValid = false; }"
 #pragma link C++ class Smear::ParticleMCS+;
+// Version 3 stored one bool per smeared quantity; pack them into the flags.
+#pragma read sourceClass="Smear::ParticleMCS" version="[3]" \
+  targetClass="Smear::ParticleMCS" \
+  source="bool kParticleSmeared; bool kESmeared; bool kPSmeared; \
+          bool kPtSmeared; bool kPxSmeared; bool kPySmeared; \
+          bool kPzSmeared; bool kThetaSmeared; bool kPhiSmeared; \
+          bool kIdSmeared; bool kNumSigmaSmeared" \
+  target="mSmearFlags" \
+  code="{ typedef Smear::ParticleMCS P; \
+          mSmearFlags = \
+            (onfile.kParticleSmeared ? P::kSmearedParticle : 0) | \
+            (onfile.kESmeared ? P::kSmearedE : 0) | \
+            (onfile.kPSmeared ? P::kSmearedP : 0) | \
+            (onfile.kPtSmeared ? P::kSmearedPt : 0) | \
+            (onfile.kPxSmeared ? P::kSmearedPx : 0) | \
+            (onfile.kPySmeared ? P::kSmearedPy : 0) | \
+            (onfile.kPzSmeared ? P::kSmearedPz : 0) | \
+            (onfile.kThetaSmeared ? P::kSmearedTheta : 0) | \
+            (onfile.kPhiSmeared ? P::kSmearedPhi : 0) | \
+            (onfile.kIdSmeared ? P::kSmearedId : 0) | \
+            (onfile.kNumSigmaSmeared ? P::kSmearedNumSigma : 0); }"
+// Older versions had no flags
+#pragma read sourceClass="Smear::ParticleMCS" version="[-2]" \
+  targetClass="Smear::ParticleMCS" source="" target="mSmearFlags" \
+  code="{ mSmearFlags = 0; }"
 
 // Core smearing components
 #pragma link C++ class Smear::Acceptance+;
+// Compile the zones read, as AddZone() does
+#pragma read sourceClass="Smear::Acceptance" version="[1-]" \
+  targetClass="Smear::Acceptance" \
+  source="std::vector<Smear::Acceptance::Zone> mZones" \
+  target="mLower, mUpper, mHasCustomCuts" \
+  code="{ Smear::Acceptance::Compile(onfile.mZones, mLower, mUpper, \
+                                     mHasCustomCuts); }"
 #pragma link C++ class Smear::Acceptance::CustomCut+;
 #pragma link C++ class Smear::Acceptance::Zone+;
 #pragma link C++ class Smear::Detector+;
+// Count the scan points of the devices read when first needed
+#pragma read sourceClass="Smear::Detector" version="[1-]" \
+  targetClass="Smear::Detector" source="" target="mNScanPoints" \
+  code="{ mNScanPoints = -1; }"
+#pragma link C++ class Smear::DetectorStats+;
+#pragma link C++ class Smear::DeviceStats+;
 #pragma link C++ class Smear::Distributor+;
 #pragma link C++ class Smear::FormulaString+;
+// Compiled formulas are shared within a process, so are not stored
+#pragma read sourceClass="Smear::FormulaString" version="[1-]" \
+  targetClass="Smear::FormulaString" source="std::string mInput" \
+  target="mFormula" \
+  code="{ mFormula = Smear::FormulaString::Compile(onfile.mInput); }"
 #pragma link C++ class Smear::ParticleID+;
 #pragma link C++ class Smear::PerfectID+;
 #pragma link C++ class Smear::Smearer+;
@@ -46,6 +100,11 @@
 // Specialized smearing devices
 #pragma link C++ class Smear::Bremsstrahlung+;
 #pragma link C++ class Smear::Device+;
+#pragma read sourceClass="Smear::Device" version="[1-]" \
+  targetClass="Smear::Device" source="Smear::KinType mSmeared" \
+  target="mKinematicFunction" \
+  code="{ mKinematicFunction = Smear::FormulaString::CompileFunction( \
+            Smear::FormulaString::GetKinName(onfile.mSmeared)); }"
 #pragma link C++ class Smear::Tracker+;
 #pragma link C++ class Smear::PlanarTracker+;
 #pragma link C++ class Smear::RadialTracker+;
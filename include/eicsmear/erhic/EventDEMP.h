@@ -36,7 +36,7 @@ class EventDEMP : public EventMC {
    false in case of an error.
    */
   virtual bool Parse(const std::string&);
-  const ParticleMC* ScatteredLepton() const;
+  const ParticleMC* FindScatteredLepton() const;
 
   Double32_t numParticles;
   Double32_t weight;
@@ -50,7 +50,7 @@ class EventDjangoh : public EventMC {
   /**
    Returns a pointer to the scattered lepton, or NULL if it cannot be found.
    */
-  virtual const ParticleMC* ScatteredLepton() const;
+  virtual const ParticleMC* FindScatteredLepton() const;
 
   Int_t nucleon;
   Int_t IChannel;
@@ -92,7 +92,7 @@ inline const ParticleMC* EventDjangoh::ExchangeBoson() const {
   return GetTrack(2);
 }
 
-inline const ParticleMC* EventDjangoh::ScatteredLepton() const {
+inline const ParticleMC* EventDjangoh::FindScatteredLepton() const {
   return GetTrack(3);
 }
 
@@ -28,6 +28,7 @@
 
 namespace erhic {
 
+class EventMCFilterABC;
 class ParticleMC;
 
 /**
@@ -96,6 +97,28 @@ class VirtualEventFactory : public TObject {
   **/
   std::map<std::string, std::string> mAdditionalInformation;
 
+  /**
+   Returns the time spent by Create() in end-of-event calculations,
+   mostly of event kinematics, since the factory was created.
+   */
+  Double_t GetFinishEventSeconds() const { return mFinishEventSeconds; }
+
+  /**
+   Sets a filter so that Create() returns only events it accepts.
+   The factory does not take ownership of the filter, which must
+   outlive it. NULL removes the filter.
+   Returns false if the factory does not support filtering.
+   */
+  virtual bool SetFilter(const EventMCFilterABC*) { return false; }
+
+  /**
+   Returns the number of events rejected by the filter so far.
+   */
+  virtual Long64_t GetNRejected() const { return 0; }
+
+ protected:
+  Double_t mFinishEventSeconds = 0.;  //!
+
   ClassDef(VirtualEventFactory, 3)
 };
 
@@ -139,10 +162,36 @@ class EventFromAsciiFactory : public VirtualEventFactory {
 
   virtual void FindFirstEvent();
 
+  /**
+   Sets a filter so that Create() returns only events it accepts.
+   Events rejected by EventMCFilterABC::AcceptHeader() are skipped
+   without parsing their particles.
+   */
+  virtual bool SetFilter(const EventMCFilterABC*);
+
+  /**
+   Returns the number of events rejected by the filter so far.
+   */
+  virtual Long64_t GetNRejected() const;
+
  protected:
   std::istream* mInput;  //!
   std::string mLine;  //!
   std::unique_ptr<T> mEvent;  //!
+  const EventMCFilterABC* mFilter = nullptr;  //!
+  Long64_t mNRejected = 0;  //!
+
+  /**
+   Replaces mEvent with a new, empty event.
+   */
+  void NewEvent();
+
+  /**
+   Skips the rest of the current event, reading only as far as the
+   first non-blank character of lines that cannot be the end-of-event
+   marker. Returns true if the marker was found.
+   */
+  bool SkipEvent();
 
   /**
    Returns true when an end-of-event marker is encountered in the input stream.
@@ -161,7 +210,7 @@ class EventFromAsciiFactory : public VirtualEventFactory {
 
   // Warning: explicitly putting the erhic:: namespace before the class
   // name doesn't seen to work for template classes.
-  ClassDef(EventFromAsciiFactory, 2)
+  ClassDef(EventFromAsciiFactory, 3)
 };
 
 /**
@@ -18,6 +18,7 @@
 
 #include "eicsmear/erhic/EventDis.h"
 #include "eicsmear/erhic/ParticleMC.h"
+#include "eicsmear/erhic/TrackView.h"
 
 class TTree;
 
@@ -29,6 +30,11 @@ namespace erhic {
  */
 class EventMC : public EventDis {
  public:
+  /**
+   A selection of tracks in the event, see FinalStateParticles().
+   */
+  typedef TrackView<EventMC, ParticleMC> ParticleView;
+
   /**
    Constructor.
    */
@@ -65,6 +71,9 @@ class EventMC : public EventDis {
 
   /**
    \overload const ParticleMC* GetTrack(UInt_t) const
+   The cached final-state sums (see FinalStateMomentum()) and beams
+   (see IdentifyBeams()) are not updated if the track is modified;
+   call Clear() and AddLast() to change the particles of an event.
    */
   virtual ParticleMC* GetTrack(UInt_t);
 
@@ -107,11 +116,37 @@ class EventMC : public EventDis {
    is assumed to be the first final-state particle in the particle list
    with the same PDG code as the incident lepton beam.
 
+   The search is done by FindScatteredLepton(). Once the event is complete,
+   ResolveScatteredLepton() stores the index of the particle it finds,
+   after which this is a simple lookup.
+   */
+  virtual const ParticleMC* ScatteredLepton() const;
+
+  /**
+   Searches the event record for the scattered lepton.
+   See also notes in ScatteredLepton().
+
    Please overwrite this method accordingly!
-   By default, it will simply use the fourth particle in the particle list.
+   By default, it will simply use the third particle in the particle list.
    See e.g. EventPythia, EventSimple.
    */
-  virtual const ParticleMC* ScatteredLepton() const;
+  virtual const ParticleMC* FindScatteredLepton() const;
+
+  /**
+   Searches for the scattered lepton and stores its index, so subsequent
+   calls to ScatteredLepton() need not repeat the search.
+   Call once all particles are added; adding or clearing particles
+   discards the stored index.
+   */
+  void ResolveScatteredLepton();
+
+  /**
+   Identifies the beams, exchange boson and scattered lepton as
+   ParticleIdentifier::IdentifyBeams() does.
+   The event record is only searched the first time; the result is
+   kept until the particle list changes (see FinalStateMomentum()).
+   */
+  bool IdentifyBeams(std::vector<const VirtualParticle*>& beams) const;
 
   /**
    Populates the event-wise variables from a string.
@@ -187,18 +222,39 @@ class EventMC : public EventDis {
    */
   void HadronicFinalState(ParticlePtrList&) const;
 
+  /**
+   Returns the final-state particles, for iterating over them
+   without copying them to a list first:
+   \code
+   for (const ParticleMC* particle : event.FinalStateParticles()) {
+   \endcode
+   */
+  ParticleView FinalStateParticles() const;
+
+  /**
+   Returns the particles of the hadronic final state, i.e. the final
+   state minus the scattered lepton. See also FinalStateParticles().
+   */
+  ParticleView HadronicFinalStateParticles() const;
+
   /**
    Returns the total momentum of the final state in GeV/c.
+   The final-state sums are computed together on first use and cached
+   until the particle list changes.
+   Particles changed via pointers obtained before the last call to
+   this or another sum aren't noticed.
    */
   TLorentzVector FinalStateMomentum() const;
 
   /**
    Returns the total momentum of the hadronic final state in GeV/c.
+   See notes in FinalStateMomentum().
    */
   TLorentzVector HadronicFinalStateMomentum() const;
 
   /**
    Returns the total charge of the final state in units of e.
+   See notes in FinalStateMomentum().
    */
   Double_t FinalStateCharge() const;
 
@@ -208,6 +264,46 @@ class EventMC : public EventDis {
    */
   std::vector<const VirtualParticle*> GetTracks() const;
 
+  /**
+   Drops intermediate particles, keeping the final state plus the
+   leading particles up to and including the beams and exchange boson,
+   so BeamLepton(), BeamHadron() and ExchangeBoson() are unchanged.
+   The scattered lepton is always kept.
+   Particle indices are renumbered. A parent that is dropped is replaced
+   by its nearest kept ancestor; the child indices give the first and
+   last kept particles with this particle as parent. As the kept
+   children need not be contiguous, [first, last] may also span
+   particles with other parents: check GetParentIndex() of each
+   particle in the range. The stored parent
+   PDG code (ParticleMC::GetParentId()) is that of the original parent.
+   Marks the event as slim (see IsSlim()).
+   Call once the event is complete.
+   */
+  void Slim();
+
+  /**
+   Returns true if the event was slimmed by Slim().
+   The particle quantities derived from the four-momentum and from the
+   event kinematics are not stored in slim trees; they are restored by
+   ComputeDerivedQuantities(), which Reader and SmearTree call for you.
+   */
+  bool IsSlim() const;
+
+  /**
+   Returns true if the named data member of EventMC records how the
+   event is stored rather than describing it, so is not an event
+   variable, e.g. for HepMC attributes.
+   */
+  static bool IsBookkeepingMember(const std::string& name);
+
+  /**
+   Computes the particle quantities derived from the four-momentum
+   (see ParticleMC::ComputeDerivedQuantities()) and from the event
+   kinematics, such as z and xFeynman, e.g. after reading a slim event.
+   The stored parent PDG codes are kept.
+   */
+  void ComputeDerivedQuantities();
+
  protected:
   Int_t number;  ///< Event number
   Int_t process;  ///< PYTHIA code for the physics process producing the event
@@ -217,10 +313,35 @@ class EventMC : public EventDis {
   Double32_t ELeptonOutNucl;  ///< Scattered lepton energy in the
                               ///< nuclear rest frame
   TClonesArray particles;  ///< Particle list
+  // Bookkeeping members, listed by IsBookkeepingMember()
+  Int_t mScatteredIndex;  ///< Index of the scattered lepton in particles,
+                          ///< -1 if there is none, -2 if not yet resolved
+  Bool_t mSlim;  ///< True if intermediate particles and derived
+                 ///< particle quantities were not stored
 
-  ClassDef(erhic::EventMC, 2)
+  /**
+   Computes and caches the final-state sums in one pass.
+   */
+  void ComputeFinalStateSums() const;
+
+  // Final-state sums, cached by ComputeFinalStateSums()
+  mutable bool mFinalStateSumsValid;  //!
+  mutable TLorentzVector mFinalStateMomentum;  //!
+  mutable TLorentzVector mHadronicFinalStateMomentum;  //!
+  mutable Double_t mFinalStateCharge;  //!
+
+  // Result of IdentifyBeams(), cached on first use
+  mutable bool mBeamsIdentified;  //!
+  mutable bool mFoundAllBeams;  //!
+  mutable std::vector<const VirtualParticle*> mIdentifiedBeams;  //!
+
+  ClassDef(erhic::EventMC, 4)
 };
 
+inline bool EventMC::IsSlim() const {
+  return mSlim;
+}
+
 inline ULong64_t EventMC::GetN() const {
   return number;
 }
@@ -249,6 +370,14 @@ inline ParticleMC* EventMC::GetTrack(UInt_t u) {
   }  // if
 }
 
+inline EventMC::ParticleView EventMC::FinalStateParticles() const {
+  return ParticleView(*this, 0, true);
+}
+
+inline EventMC::ParticleView EventMC::HadronicFinalStateParticles() const {
+  return ParticleView(*this, 0, true, ScatteredLepton());
+}
+
 inline void EventMC::SetProcess(int code) {
   process = code;
 }
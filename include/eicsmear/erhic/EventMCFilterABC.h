@@ -32,6 +32,19 @@ class EventMCFilterABC {
    */
   virtual bool Accept(const VirtualEvent&) const = 0;
 
+  /**
+   Prefilter applied by factories reading text input as soon as the
+   event header line is parsed, before any particle is read. Only the
+   event-wise variables from the header are set, such as the process ID
+   or, for PYTHIA, the generated Q2 (EventPythia::GetTrueQ2()); kinematics
+   computed from the particles, such as EventDis::GetQ2(), are not.
+   Rejected events are skipped without parsing their particles, so cuts
+   on header variables are best applied here.
+   Events passing the prefilter are built in full and then passed to
+   Accept(). Accepts all events by default.
+   */
+  virtual bool AcceptHeader(const VirtualEvent&) const { return true; }
+
   ClassDef(erhic::EventMCFilterABC, 1)
 };
 
@@ -48,7 +48,7 @@ class EventPepsi : public EventMC {
   /**
    Returns a pointer to the scattered lepton, or NULL if it cannot be found.
    */
-  virtual const ParticleMC* ScatteredLepton() const;
+  virtual const ParticleMC* FindScatteredLepton() const;
 
   Int_t nucleon;  ///< PDG code of the hadron beam
   Int_t struckparton;  ///< Parton hit in the target LST(25)
@@ -101,7 +101,7 @@ inline const ParticleMC* EventPepsi::ExchangeBoson() const {
   return GetTrack(2);
 }
 
-inline const ParticleMC* EventPepsi::ScatteredLepton() const {
+inline const ParticleMC* EventPepsi::FindScatteredLepton() const {
   return GetTrack(3);
 }
 
@@ -298,12 +298,12 @@ class EventPythia : public EventMC {
   virtual double GetR() const;
 
   /**
-   Returns the scattered lepton.
+   Searches the event record for the scattered lepton.
    This is the first final state particle with the same species
    as the beam lepton and parent index equal to three
    (counting index from 1).
    */
-  virtual const ParticleMC* ScatteredLepton() const;
+  virtual const ParticleMC* FindScatteredLepton() const;
 
   // Let them all be public; this access method dances for POD does not make sense;
   //protected:
@@ -32,7 +32,7 @@ class EventRapgap : public EventMC {
        2) status code is 1 i.e. it's a stable/final-state particle.
        3) the parent is track 1 or 2
   */
-  const ParticleMC* ScatteredLepton() const;
+  const ParticleMC* FindScatteredLepton() const;
 
   /**
    Returns a pointer to the exchanged boson.   
@@ -42,7 +42,7 @@ class EventSartre : public EventMC {
        2) status code is 1 i.e. it's a stable/final-state particle.
        3) the parent is track 1 or 2
   */
-  const ParticleMC* ScatteredLepton() const;
+  const ParticleMC* FindScatteredLepton() const;
   /**
      Returns a pointer to the exchanged boson.   
      It would probably be the third track, but we'll go with the first status=21 boson
@@ -34,7 +34,7 @@ class EventSimple : public EventMC {
    false in case of an error.
    */
   virtual bool Parse(const std::string&);
-  const ParticleMC* ScatteredLepton() const;
+  const ParticleMC* FindScatteredLepton() const;
 
   Double32_t numParticles;
 
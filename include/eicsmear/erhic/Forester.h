@@ -13,6 +13,7 @@
 // C(++) headers
 #include <cmath>
 #include <ctime>
+#include <deque>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
@@ -26,9 +27,11 @@
 
 // Other headers
 #include "eicsmear/erhic/EventMC.h"
+#include "eicsmear/erhic/OutputPolicy.h"
 
 namespace erhic {
 
+class EventMCFilterABC;
 class FileType;
 class VirtualEventFactory;
 
@@ -117,6 +120,55 @@ class Forester : public TObject {
    */
   void SetMessageInterval(Long64_t = 10000);
 
+  /**
+   Sets the name of a file to which a JSON summary of the run
+   (see Status::PrintJson()) is written at the end of Plant().
+   No summary is written if the name is empty (this is the default).
+   */
+  void SetSummaryFileName(const std::string& = "");
+
+  /**
+   Returns the name of the JSON summary file.
+   */
+  std::string GetSummaryFileName() const;
+
+  /**
+   Sets the compression, basket size and other settings of the
+   output file and tree.
+   */
+  void SetOutputPolicy(const OutputPolicy&);
+
+  /**
+   Returns the settings of the output file and tree.
+   */
+  const OutputPolicy& GetOutputPolicy() const;
+
+  /**
+   Sets a filter so that only events it accepts are written.
+   Events failing EventMCFilterABC::AcceptHeader() are skipped without
+   parsing their particles. The filter is not owned by the Forester and
+   must exist during Plant(). NULL (the default) writes all events.
+   */
+  void SetFilter(const EventMCFilterABC*);
+
+  /**
+   Returns the event filter, or NULL if there is none.
+   */
+  const EventMCFilterABC* GetFilter() const;
+
+  /**
+   If set to true, writes slim events (see EventMC::Slim()): intermediate
+   particles are dropped, and the particle quantities derived from the
+   four-momentum and event kinematics are not stored, being computed
+   again when the events are read.
+   */
+  void SetSlim(bool = true);
+
+  /**
+   Returns true if slim events are written.
+   */
+  bool GetSlim() const;
+
   /**
    Prints the current configuration to the requested output stream.
    */
@@ -149,6 +201,8 @@ class Forester : public TObject {
 
   /**
    Stores summary information about the last call to Forester::Plant().
+   Rates are measured over the last WindowSeconds() seconds of the run,
+   so they follow changes in throughput during long runs.
    KK: Made public for rootcint
    */
   class Status{
@@ -157,25 +211,126 @@ class Forester : public TObject {
     virtual ~Status();
     virtual std::ostream& Print(std::ostream& os = std::cout) const;
 
+    /**
+     Writes the summary as a JSON object.
+     */
+    virtual std::ostream& PrintJson(std::ostream& os) const;
+
+    /** Returns the number of events written to the tree. */
+    Long64_t GetNEvents() const { return mNEvents; }
+
+    /** Returns the number of particles in the events written. */
+    Long64_t GetNParticles() const { return mNParticles; }
+
+    /** Returns the number of bad events skipped. */
+    Long64_t GetNSkipped() const { return mNSkipped; }
+
+    /**
+     Returns the number of events rejected by the event filter.
+     The accepted events are those written, GetNEvents().
+     */
+    Long64_t GetNRejected() const { return mNRejected; }
+
+    /** Returns the seconds spent reading and parsing the input. */
+    Double_t GetParseSeconds() const { return mParseSeconds; }
+
+    /** Returns the seconds spent in event kinematics calculations. */
+    Double_t GetKinematicsSeconds() const { return mKinematicsSeconds; }
+
+    /** Returns the seconds spent filling the tree. */
+    Double_t GetFillSeconds() const { return mFillSeconds; }
+
+    /** Returns the bytes read from the input file. */
+    Long64_t GetCompressedBytes() const { return mCompressedBytes; }
+
+    /** Returns the bytes of text read, after any decompression. */
+    Long64_t GetUncompressedBytes() const { return mUncompressedBytes; }
+
+    /** Returns the events per second. */
+    Double_t GetEventRate() const { return mEventRate; }
+
+    /** Returns the particles per second. */
+    Double_t GetParticleRate() const { return mParticleRate; }
+
+    /** Returns the input file bytes read per second. */
+    Double_t GetCompressedByteRate() const { return mCompressedByteRate; }
+
+    /** Returns the bytes of text read per second. */
+    Double_t GetUncompressedByteRate() const {
+      return mUncompressedByteRate;
+    }
+
+    /** Returns the peak resident memory of the process in kB. */
+    Long64_t GetPeakResidentKB() const { return mPeakResidentKB; }
+
+    /** Returns the length of the window over which rates are measured. */
+    static Double_t WindowSeconds() { return 10.; }
+
+    /**
+     Counts at one point of the run, from which rates are computed.
+     */
+    struct Point {
+      double seconds;
+      Long64_t events;
+      Long64_t particles;
+      Long64_t compressed;
+      Long64_t uncompressed;
+    };
+
   protected:
+    virtual void Reset();
     virtual void StartTimer();
     virtual void StopTimer();
     virtual void ModifyEventCount(Long64_t count);
     virtual void ModifyParticleCount(Long64_t count);
+    virtual void ModifySkippedCount(Long64_t count);
+    virtual void ModifyRejectedCount(Long64_t count);
+
+    /**
+     Adds the time spent building and writing one event.
+     */
+    virtual void AddTimes(double parse, double kinematics, double fill);
+
+    /**
+     Records the input read after the given number of seconds, and
+     updates the rates. Negative byte counts are ignored.
+     */
+    virtual void Sample(double seconds, Long64_t compressedBytes,
+                        Long64_t uncompressedBytes);
 
     time_t mStartTime;
     time_t mEndTime;
     Long64_t mNEvents;
     Long64_t mNParticles;
+    Long64_t mNSkipped;
+    Long64_t mNRejected;
+    Double_t mParseSeconds;
+    Double_t mKinematicsSeconds;
+    Double_t mFillSeconds;
+    Long64_t mCompressedBytes;
+    Long64_t mUncompressedBytes;
+    Double_t mEventRate;
+    Double_t mParticleRate;
+    Double_t mCompressedByteRate;
+    Double_t mUncompressedByteRate;
+    Long64_t mPeakResidentKB;
+    std::deque<Point> mPoints;  //! Samples within the rate window
 
     // The TStopwatch is mutable as "GetRealTime()" is non-const.
     mutable TStopwatch mTimer;
 
     friend class Forester;
 
-    ClassDef(Status, 1);
+    ClassDef(Status, 3);
   };
 
+  /**
+   Returns a summary of the last call to Plant().
+   */
+  const Status& GetStatus() const {
+    return mStatus;
+  }
+
  protected:
   /**
    Prints a summary of the last call to Plant()
@@ -185,6 +340,11 @@ class Forester : public TObject {
     return mStatus;
   }
 
+  /**
+   Records the input read so far in the status.
+   */
+  void SampleInput(double seconds);
+
   /**
    Opens the input file and checks that it was produced by a
    supported Monte Carlo generator.
@@ -239,6 +399,7 @@ class Forester : public TObject {
 
   Bool_t mQuit;  ///< Quit status. Set to true once EoF or max events reached
   Bool_t mVerbose;  ///< Verbosity flag
+  Bool_t mSlim;  ///< Slim event flag
   TTree* mTree;  //! < Output TTree, owned by mRootFile
   VirtualEvent* mEvent;  //! < Stores event branch address
   const erhic::FileType* mFile;  //! < File type information
@@ -252,10 +413,13 @@ class Forester : public TObject {
   std::string mTreeName;  ///< Name of the output TTree
   std::string mBranchName;  ///< Name of the event TBranch
   std::string mLine;  ///< Stores the latest text line read from the input file
+  std::string mSummaryName;  ///< Name of the JSON summary file
   Status mStatus;  ///< Forester status information
+  OutputPolicy mPolicy;  ///< Output file and tree settings
   VirtualEventFactory* mFactory;  //! < Pointer to the event-builder object
+  const EventMCFilterABC* mFilter;  //! < Event filter, not owned
 
-  ClassDef(Forester, 3)
+  ClassDef(Forester, 6)
 };
 
 inline void Forester::SetInputFileName(const std::string& name) {
@@ -302,6 +466,38 @@ inline void Forester::SetMessageInterval(Long64_t number) {
   mInterval = number;
 }
 
+inline void Forester::SetSummaryFileName(const std::string& name) {
+  mSummaryName = name;
+}
+
+inline std::string Forester::GetSummaryFileName() const {
+  return mSummaryName;
+}
+
+inline void Forester::SetOutputPolicy(const OutputPolicy& policy) {
+  mPolicy = policy;
+}
+
+inline const OutputPolicy& Forester::GetOutputPolicy() const {
+  return mPolicy;
+}
+
+inline void Forester::SetFilter(const EventMCFilterABC* filter) {
+  mFilter = filter;
+}
+
+inline const EventMCFilterABC* Forester::GetFilter() const {
+  return mFilter;
+}
+
+inline void Forester::SetSlim(bool slim) {
+  mSlim = slim;
+}
+
+inline bool Forester::GetSlim() const {
+  return mSlim;
+}
+
 inline bool Forester::MustQuit() const {
   return mQuit;
 }
@@ -0,0 +1,175 @@
+/**
+ \file
+ Declaration of class erhic::InputPolicy.
+
+ \date      2026-10-18
+ \copyright 2026 Brookhaven National Lab
+ */
+
+#ifndef INCLUDE_EICSMEAR_ERHIC_INPUTPOLICY_H_
+#define INCLUDE_EICSMEAR_ERHIC_INPUTPOLICY_H_
+
+#include <TObject.h>
+#include <TString.h>
+
+class TTree;
+
+namespace erhic {
+
+/**
+ Settings for reading event trees, as done by SmearTree:
+ the size of the TTreeCache and the branches it holds, parallel
+ unzipping of baskets, ROOT's implicit multithreading and asynchronous
+ prefetching of the next block of the file.
+ The cache avoids many small reads, which are slow on network file
+ systems; unzipping in parallel hides the decompression time.
+ */
+class InputPolicy : public TObject {
+ public:
+  /**
+   Constructor.
+   Caches the "event" branch, and all its sub-branches, in a 30 MB
+   cache. Parallel unzipping, implicit multithreading and asynchronous
+   prefetching are off.
+   */
+  InputPolicy();
+
+  /**
+   Destructor.
+   */
+  virtual ~InputPolicy();
+
+  /**
+   Returns a policy for reading over the network: a 100 MB cache,
+   asynchronous prefetching and parallel unzipping on all cores.
+   */
+  static InputPolicy Remote();
+
+  /**
+   Sets the size in bytes of the TTreeCache.
+   0 turns the cache off; a negative value uses ROOT's default.
+   */
+  void SetCacheSize(Long64_t bytes = 30000000);
+
+  /**
+   Returns the size in bytes of the TTreeCache.
+   */
+  Long64_t GetCacheSize() const;
+
+  /**
+   Sets the branches to cache, as a whitespace- or comma-separated list
+   of names, which may include wildcards. Sub-branches are included.
+   */
+  void SetCachedBranches(const TString& = "event");
+
+  /**
+   Returns the list of cached branches.
+   */
+  const TString& GetCachedBranches() const;
+
+  /**
+   Turns on or off asynchronous prefetching, which reads the next block
+   of the file in a separate thread while the current one is processed.
+   Off (the default) leaves ROOT's TFile.AsyncPrefetching setting, e.g.
+   from a .rootrc, as it is.
+   */
+  void SetAsyncPrefetch(bool = true);
+
+  /**
+   Returns true if asynchronous prefetching is on.
+   */
+  bool GetAsyncPrefetch() const;
+
+  /**
+   Turns on or off parallel unzipping of the baskets in the cache.
+   */
+  void SetParallelUnzip(bool = true);
+
+  /**
+   Returns true if parallel unzipping is on.
+   */
+  bool GetParallelUnzip() const;
+
+  /**
+   Sets the number of threads for ROOT's implicit multithreading,
+   used to unzip baskets in parallel: 0 uses one thread per core,
+   a negative number (the default) leaves it off.
+   Once turned on, it stays on for the rest of the process.
+   */
+  void SetImplicitMT(Int_t nThreads);
+
+  /**
+   Returns the number of implicit multithreading threads.
+   */
+  Int_t GetImplicitMT() const;
+
+  /**
+   Applies the process-wide settings: prefetching, parallel unzipping
+   and implicit multithreading.
+   Call before opening the input files.
+   */
+  void ApplyGlobal() const;
+
+  /**
+   Sets up the cache of a tree, or a chain once its first tree is loaded.
+   */
+  void Apply(TTree&) const;
+
+  /**
+   Prints the settings to standard output.
+   */
+  virtual void Print(Option_t* = "") const;
+
+ protected:
+  Long64_t mCacheSize;  ///< TTreeCache size in bytes, negative for default
+  TString mBranches;  ///< Cached branches
+  Bool_t mAsyncPrefetch;  ///< Asynchronous prefetching flag
+  Bool_t mParallelUnzip;  ///< Parallel unzipping flag
+  Int_t mImplicitMT;  ///< Implicit MT threads, negative for off
+
+  ClassDef(erhic::InputPolicy, 1)
+};
+
+inline void InputPolicy::SetCacheSize(Long64_t bytes) {
+  mCacheSize = bytes;
+}
+
+inline Long64_t InputPolicy::GetCacheSize() const {
+  return mCacheSize;
+}
+
+inline void InputPolicy::SetCachedBranches(const TString& branches) {
+  mBranches = branches;
+}
+
+inline const TString& InputPolicy::GetCachedBranches() const {
+  return mBranches;
+}
+
+inline void InputPolicy::SetAsyncPrefetch(bool prefetch) {
+  mAsyncPrefetch = prefetch;
+}
+
+inline bool InputPolicy::GetAsyncPrefetch() const {
+  return mAsyncPrefetch;
+}
+
+inline void InputPolicy::SetParallelUnzip(bool unzip) {
+  mParallelUnzip = unzip;
+}
+
+inline bool InputPolicy::GetParallelUnzip() const {
+  return mParallelUnzip;
+}
+
+inline void InputPolicy::SetImplicitMT(Int_t nThreads) {
+  mImplicitMT = nThreads;
+}
+
+inline Int_t InputPolicy::GetImplicitMT() const {
+  return mImplicitMT;
+}
+
+}  // namespace erhic
+
+#endif  // INCLUDE_EICSMEAR_ERHIC_INPUTPOLICY_H_
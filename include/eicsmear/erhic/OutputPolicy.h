@@ -0,0 +1,254 @@
+/**
+ \file
+ Declaration of class erhic::OutputPolicy.
+
+ \date      2026-10-18
+ \copyright 2026 Brookhaven National Lab
+ */
+
+#ifndef INCLUDE_EICSMEAR_ERHIC_OUTPUTPOLICY_H_
+#define INCLUDE_EICSMEAR_ERHIC_OUTPUTPOLICY_H_
+
+#include <string>
+
+#include <TObject.h>
+#include <TString.h>
+
+class TBranch;
+class TFile;
+class TTree;
+
+namespace erhic {
+
+/**
+ Settings of the ROOT files and trees written by BuildTree and SmearTree:
+ compression, basket size, split level, auto-flush and auto-save
+ intervals, maximum tree size and ROOT's implicit multithreading, which
+ compresses baskets in parallel.
+ The defaults reproduce the settings used before the policy existed:
+ the auto-save interval and maximum tree size are left to ROOT, and
+ BuildTree sets its own unless the policy does.
+ The policy is written to each output file as "outputPolicy".
+ */
+class OutputPolicy : public TObject {
+ public:
+  /**
+   Constructor.
+   Uses ROOT's default compression, 32000-byte baskets, split level 99,
+   ROOT's default auto-flush, auto-save and maximum tree size, and no
+   implicit multithreading.
+   */
+  OutputPolicy();
+
+  /**
+   Destructor.
+   */
+  virtual ~OutputPolicy();
+
+  /**
+   Returns a policy for scratch files that are read many times:
+   LZ4 compression, which is the fastest to decompress.
+   */
+  static OutputPolicy Scratch();
+
+  /**
+   Returns a policy for files kept long-term:
+   LZMA compression, which gives the smallest files.
+   */
+  static OutputPolicy Archive();
+
+  /**
+   Sets the compression algorithm by name ("zlib", "lzma", "lz4" or
+   "zstd", in any case) and the level (1-9).
+   "default" uses ROOT's default setting.
+   Returns false, leaving the compression unchanged, for unknown names.
+   */
+  bool SetCompression(const TString& algorithm, Int_t level);
+
+  /**
+   Sets the compression as a ROOT compression setting,
+   100 * algorithm + level e.g. 505 for ZSTD level 5.
+   A negative value uses ROOT's default setting.
+   */
+  void SetCompressionSettings(Int_t settings);
+
+  /**
+   Returns the ROOT compression setting, negative for ROOT's default.
+   */
+  Int_t GetCompressionSettings() const;
+
+  /**
+   Sets the buffer size in bytes of each branch basket.
+   */
+  void SetBasketSize(Int_t bytes = 32000);
+
+  /**
+   Returns the basket buffer size in bytes.
+   */
+  Int_t GetBasketSize() const;
+
+  /**
+   Sets the split level of the event branch.
+   */
+  void SetSplitLevel(Int_t level = 99);
+
+  /**
+   Returns the split level of the event branch.
+   */
+  Int_t GetSplitLevel() const;
+
+  /**
+   Sets the size of the clusters of entries flushed together, as for
+   TTree::SetAutoFlush(): a positive value is a number of entries,
+   a negative value a number of bytes.
+   */
+  void SetAutoFlush(Long64_t autoFlush = -30000000);
+
+  /**
+   Returns the auto-flush setting.
+   */
+  Long64_t GetAutoFlush() const;
+
+  /**
+   Sets the interval between saves of the tree header, as for
+   TTree::SetAutoSave(): a positive value is a number of bytes,
+   a negative value a number of entries. 0 leaves ROOT's setting.
+   */
+  void SetAutoSave(Long64_t autoSave = 500LL * 1024LL * 1024LL);
+
+  /**
+   Returns the auto-save setting.
+   */
+  Long64_t GetAutoSave() const;
+
+  /**
+   Sets the size of a tree on disk at which a new file is started.
+   This applies to all trees, see TTree::SetMaxTreeSize().
+   0 or less leaves ROOT's setting. SmearTree writes to a single
+   file, so needs a size larger than its output.
+   */
+  void SetMaxTreeSize(Long64_t bytes = 10LL * 1024LL * 1024LL * 1024LL);
+
+  /**
+   Returns the maximum tree size in bytes.
+   */
+  Long64_t GetMaxTreeSize() const;
+
+  /**
+   Sets the number of threads for ROOT's implicit multithreading,
+   which compresses baskets in parallel: 0 uses one thread per core,
+   a negative number (the default) leaves it off.
+   Once turned on, it stays on for the rest of the process.
+   */
+  void SetImplicitMT(Int_t nThreads);
+
+  /**
+   Returns the number of implicit multithreading threads.
+   */
+  Int_t GetImplicitMT() const;
+
+  /**
+   Applies the process-wide settings: maximum tree size and
+   implicit multithreading.
+   */
+  void ApplyGlobal() const;
+
+  /**
+   Applies the compression setting to a file.
+   Call before creating trees in the file.
+   */
+  void Apply(TFile&) const;
+
+  /**
+   Applies the auto-flush and auto-save settings to a tree.
+   */
+  void Apply(TTree&) const;
+
+  /**
+   Creates a branch holding objects of the named class with the basket
+   size and split level of the policy.
+   As for TTree::Branch(), address is the address of the caller's
+   pointer to the object, which must stay valid while the tree is
+   filled. If the pointer is NULL an object is created for it.
+   The caller owns the object either way.
+   Returns NULL in case of an error.
+   */
+  TBranch* Branch(TTree&, const std::string& name,
+                  const std::string& className, void* address) const;
+
+  /**
+   Prints the settings to standard output.
+   */
+  virtual void Print(Option_t* = "") const;
+
+ protected:
+  Int_t mCompression;  ///< ROOT compression setting, negative for default
+  Int_t mBasketSize;  ///< Basket buffer size in bytes
+  Int_t mSplitLevel;  ///< Event branch split level
+  Long64_t mAutoFlush;  ///< Auto-flush, as for TTree::SetAutoFlush()
+  Long64_t mAutoSave;  ///< Auto-save, as for TTree::SetAutoSave()
+  Long64_t mMaxTreeSize;  ///< Maximum tree size in bytes
+  Int_t mImplicitMT;  ///< Implicit MT threads, negative for off
+
+  ClassDef(erhic::OutputPolicy, 1)
+};
+
+inline void OutputPolicy::SetCompressionSettings(Int_t settings) {
+  mCompression = settings;
+}
+
+inline Int_t OutputPolicy::GetCompressionSettings() const {
+  return mCompression;
+}
+
+inline void OutputPolicy::SetBasketSize(Int_t bytes) {
+  mBasketSize = bytes;
+}
+
+inline Int_t OutputPolicy::GetBasketSize() const {
+  return mBasketSize;
+}
+
+inline void OutputPolicy::SetSplitLevel(Int_t level) {
+  mSplitLevel = level;
+}
+
+inline Int_t OutputPolicy::GetSplitLevel() const {
+  return mSplitLevel;
+}
+
+inline void OutputPolicy::SetAutoFlush(Long64_t autoFlush) {
+  mAutoFlush = autoFlush;
+}
+
+inline Long64_t OutputPolicy::GetAutoFlush() const {
+  return mAutoFlush;
+}
+
+inline void OutputPolicy::SetAutoSave(Long64_t autoSave) {
+  mAutoSave = autoSave;
+}
+
+inline Long64_t OutputPolicy::GetAutoSave() const {
+  return mAutoSave;
+}
+
+inline void OutputPolicy::SetMaxTreeSize(Long64_t bytes) {
+  mMaxTreeSize = bytes;
+}
+
+inline Long64_t OutputPolicy::GetMaxTreeSize() const {
+  return mMaxTreeSize;
+}
+
+inline void OutputPolicy::SetImplicitMT(Int_t nThreads) {
+  mImplicitMT = nThreads;
+}
+
+inline Int_t OutputPolicy::GetImplicitMT() const {
+  return mImplicitMT;
+}
+
+}  // namespace erhic
+
+#endif  // INCLUDE_EICSMEAR_ERHIC_OUTPUTPOLICY_H_
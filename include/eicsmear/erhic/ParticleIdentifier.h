@@ -95,10 +95,19 @@ class ParticleIdentifier {
    Any particle not found yields a NULL pointer in the vector.
    Returns true if all beams are found (i.e. no NULL pointers), false if not.
    Important: finding the scattered hadron beam is not implemented.
+   The result for a Monte Carlo event is kept by the event (see
+   erhic::EventMC::IdentifyBeams()), so calling this again is cheap.
    */
   static bool IdentifyBeams(const erhic::VirtualEvent&,
                             std::vector<const erhic::VirtualParticle*>&);
 
+  /**
+   As IdentifyBeams(), but always searches the event record,
+   in a single pass that stops once all beams are found.
+   */
+  static bool FindBeams(const erhic::VirtualEvent&,
+                        std::vector<const erhic::VirtualParticle*>&);
+
  protected:
   /**
    Determine the scattered lepton type from an incident lepton type.
@@ -12,6 +12,7 @@
 
 #include <string>
 
+#include <TLorentzRotation.h>
 #include <TLorentzVector.h>
 #include <TRef.h>
 #include <TVector3.h>
@@ -37,6 +38,36 @@ namespace erhic {
 };
 
 class EventMC;
+
+/**
+ The frames and invariants of an event needed for the event-dependent
+ quantities of its particles (see
+ ParticleMCbase::ComputeEventDependentQuantities()).
+ They are the same for every particle, so compute them once per event.
+ */
+struct EventFrames {
+  /**
+   Computes the frames from the beams and scattered lepton of the event.
+   If any of them is missing, IsValid() returns false.
+   */
+  explicit EventFrames(const EventMC&);
+
+  /**
+   Returns true if the frames could be determined.
+   */
+  bool IsValid() const { return valid; }
+
+  bool valid;
+  TLorentzVector hadron;  ///< Incident hadron beam
+  TLorentzVector boson;  ///< Exchange boson, from the lepton momentum transfer
+  Double_t hadronDotBoson;  ///< Four-vector product of hadron and boson
+  Double_t W;  ///< Invariant mass of the hadronic final state
+  TLorentzRotation toHadronRest;  ///< Hadron rest frame, z along the boson
+  TLorentzRotation toHcm;  ///< Boson-hadron centre of mass, z along the boson
+  TLorentzVector bosonPrf;  ///< Exchange boson in the hadron rest frame
+  TLorentzVector leptonPrf;  ///< Scattered lepton in the hadron rest frame
+};
+
 /**
  A particle produced by a Monte Carlo generator.
  */
@@ -282,6 +313,13 @@ class ParticleMCbase : public VirtualParticle {
    */
   virtual void ComputeEventDependentQuantities(EventMC&);
 
+  /**
+   \overload void ComputeEventDependentQuantities(EventMC&)
+   Uses frames already computed for the event, which is much faster
+   when computing the quantities for all particles in an event.
+   */
+  virtual void ComputeEventDependentQuantities(EventMC&, const EventFrames&);
+
   /**
    Sets the index of the particle i.e. its position in the track list
    (in principle this can be any
@@ -0,0 +1,133 @@
+/**
+ \file
+ Declaration of class erhic::TrackView.
+
+ \date      2026-10-18
+ \copyright 2026 Brookhaven National Lab
+ */
+
+#ifndef INCLUDE_EICSMEAR_ERHIC_TRACKVIEW_H_
+#define INCLUDE_EICSMEAR_ERHIC_TRACKVIEW_H_
+
+#include <cstddef>
+#include <iterator>
+
+#include <Rtypes.h>
+
+namespace erhic {
+
+/**
+ A selection of the tracks of an event, for use in range-based for loops:
+ \code
+ for (const ParticleMC* particle : event.FinalStateParticles()) {
+   ...
+ }
+ \endcode
+ Tracks are read from the event as the view is iterated, so no list of
+ them is built. NULL tracks are always skipped.
+ The view is only valid while the event is, and while the particle list
+ is not changed.
+ */
+template<typename Event, typename Particle>
+class TrackView {
+ public:
+  /**
+   Forward iterator over the selected tracks.
+   */
+  class const_iterator {
+   public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef const Particle* value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const Particle* const* pointer;
+    typedef const Particle* reference;
+
+    const_iterator(const TrackView* view, UInt_t index)
+    : mView(view)
+    , mIndex(index)
+    , mParticle(NULL) {
+      Seek();
+    }
+
+    reference operator*() const { return mParticle; }
+
+    const_iterator& operator++() {
+      ++mIndex;
+      Seek();
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator previous(*this);
+      ++(*this);
+      return previous;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return mIndex == other.mIndex;
+    }
+
+    bool operator!=(const const_iterator& other) const {
+      return mIndex != other.mIndex;
+    }
+
+   private:
+    // Advance to the next selected track at or after the current index.
+    void Seek() {
+      for (; mIndex < mView->mEnd; ++mIndex) {
+        mParticle = mView->mEvent->GetTrack(mIndex);
+        if (mView->Selects(mParticle)) {
+          return;
+        }  // if
+      }  // for
+      mParticle = NULL;
+    }
+
+    const TrackView* mView;
+    UInt_t mIndex;
+    const Particle* mParticle;
+  };
+
+  /**
+   Constructor.
+   Selects tracks from index first onwards. If finalOnly is true, only
+   tracks with status 1 are selected. The track exclude, typically the
+   scattered lepton, is never selected.
+   */
+  TrackView(const Event& event, UInt_t first = 0, bool finalOnly = false,
+            const Particle* exclude = NULL)
+  : mEvent(&event)
+  , mFirst(first)
+  , mEnd(event.GetNTracks())
+  , mFinalOnly(finalOnly)
+  , mExclude(exclude) {
+    if (mFirst > mEnd) {
+      mFirst = mEnd;
+    }  // if
+  }
+
+  const_iterator begin() const { return const_iterator(this, mFirst); }
+
+  const_iterator end() const { return const_iterator(this, mEnd); }
+
+  /**
+   Returns true if no track is selected.
+   */
+  bool empty() const { return begin() == end(); }
+
+ private:
+  bool Selects(const Particle* particle) const {
+    return particle && particle != mExclude &&
+           (!mFinalOnly || 1 == particle->GetStatus());
+  }
+
+  const Event* mEvent;
+  UInt_t mFirst;
+  UInt_t mEnd;
+  bool mFinalOnly;
+  const Particle* mExclude;
+};
+
+}  // namespace erhic
+
+#endif  // INCLUDE_EICSMEAR_ERHIC_TRACKVIEW_H_
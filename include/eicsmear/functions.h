@@ -15,6 +15,7 @@
 #include <Rtypes.h>
 #include <TString.h>
 
+#include "eicsmear/erhic/OutputPolicy.h"
 #include "eicsmear/smear/Smear.h"
 #include "eicsmear/smear/Detector.h"
 
@@ -22,6 +23,7 @@ class TLorentzVector;
 
 namespace erhic {
   class EventMC;
+  class EventMCFilterABC;
   class VirtualEventFactory;
   /** 
       Simple namespace-wide constant to determine the version
@@ -57,11 +59,24 @@ double computeHermesPhiH(const TLorentzVector& hadronInPrf,
 /**
  \fn
  Function for generating a ROOT TTree file from a plain-text Monte Carlo file.
+ The policy sets the compression, basket size etc. of the output,
+ e.g. erhic::OutputPolicy::Scratch() for fast-to-read LZ4 files.
+ If a filter is given, only events it accepts are written, and events
+ it rejects on their header alone are skipped without parsing their
+ particles (see erhic::EventMCFilterABC::AcceptHeader()).
+ maxEvent then counts accepted events.
+ If slim is true, only the final state, beams and exchange boson are
+ written, without the particle quantities that can be computed from them
+ (see erhic::EventMC::Slim()); files are then much smaller.
  */
 Long64_t BuildTree(const std::string& inputFileName,
                    const std::string& outputDirName = ".",
                    const Long64_t maxEvent = 0,
-                   const std::string& logFileName = "");
+                   const std::string& logFileName = "",
+                   const erhic::OutputPolicy& policy =
+                   erhic::OutputPolicy(),
+                   const erhic::EventMCFilterABC* filter = NULL,
+                   bool slim = false);
 
 /**
  \enum
@@ -74,11 +89,53 @@ namespace erhic{
 /**
  \fn
  Function for generating a HepMC file from en EICTree ROOT file.
+ Event-wise generator variables are exported as event attributes.
+ attributes optionally restricts them to a whitespace- or
+ comma-separated list of names, e.g. "QSquared x y"; by default all
+ are exported. The event weight is always kept.
+ With nThreads > 1 events are converted in parallel, each thread reading
+ its own copy of the tree, and written in their original order by a
+ single writer. nThreads = 0 uses one thread per available core.
  */
 Long64_t TreeToHepMC(const std::string& inputFileName,
 		     const std::string& outputDirName = ".",
 		     Long64_t maxEvent = 0,
-		     const erhic::HepMC_outtype outtype = erhic::HepMC_outtype::HepMC3);
+		     const erhic::HepMC_outtype outtype = erhic::HepMC_outtype::HepMC3,
+		     const std::string& attributes = "",
+		     unsigned nThreads = 1);
+
+/**
+ \fn
+ Function for generating a HepMC file directly from a plain-text
+ Monte Carlo file, without an intermediate ROOT tree.
+ The output is the same as from BuildTree followed by TreeToHepMC.
+ The log file is used for the cross section as in BuildTree;
+ if no name is given it is located automatically.
+ */
+Long64_t BuildHepMC(const std::string& inputFileName,
+		    const std::string& outputDirName = ".",
+		    Long64_t maxEvent = 0,
+		    const erhic::HepMC_outtype outtype = erhic::HepMC_outtype::HepMC3,
+		    const std::string& attributes = "",
+		    const std::string& logFileName = "");
+
+/**
+ \fn
+ Function for generating a HepMC file from a smeared ROOT file.
+ If the Monte Carlo file the smeared tree was produced from is given,
+ the full event record is written, with the smeared kinematics of
+ detected final-state particles; undetected ones are dropped.
+ Otherwise only the detected particles are written, coming from a single
+ vertex with the beams. Options are as for TreeToHepMC; smeared event
+ variables replace Monte Carlo ones of the same name.
+ */
+Long64_t SmearedTreeToHepMC(const std::string& smearedFileName,
+			    const std::string& mcFileName = "",
+			    const std::string& outputDirName = ".",
+			    Long64_t maxEvent = 0,
+			    const erhic::HepMC_outtype outtype = erhic::HepMC_outtype::HepMC3,
+			    const std::string& attributes = "",
+			    unsigned nThreads = 1);
 
 /**
  \fn
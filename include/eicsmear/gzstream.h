@@ -62,6 +62,10 @@ public:
         // ASSERT: both input & output capabilities will not be used together
     }
     int is_open() { return opened; }
+    // Read positions in the uncompressed data and in the compressed
+    // file, or -1 if no file is open.
+    long uncompressed_offset() { return opened ? gztell( file) : -1; }
+    long compressed_offset() { return opened ? gzoffset( file) : -1; }
     gzstreambuf* open( const char* name, int open_mode);
     gzstreambuf* close();
     ~gzstreambuf() { close(); }
@@ -89,6 +89,17 @@ class HadronicEventBuilder : public EventFactory<erhic::hadronic::EventSmear> {
     mcBranch.SetAddress(&mMcEvent);
   }
 
+  /**
+   Constructor.
+   Reads Monte Carlo events from the "event" branch of the tree.
+   Unlike the branch, this also follows a TChain from file to file.
+   */
+  HadronicEventBuilder(const Detector& d, TTree& mcTree)
+  : mDetector(d)
+  , mMcEvent(NULL) {
+    mcTree.SetBranchAddress("event", &mMcEvent);
+  }
+
   /**
    Create a smeared event corresponding to the current DIS Monte Carlo
    event in the input branch passed to the constructor.
@@ -106,6 +117,13 @@ class HadronicEventBuilder : public EventFactory<erhic::hadronic::EventSmear> {
     return event;
   }
 
+  /**
+   Returns the builder's copy of the detector.
+   */
+  const Detector& GetDetector() const {
+    return mDetector;
+  }
+
  protected:
   Detector mDetector;
   erhic::hadronic::EventMC* mMcEvent;
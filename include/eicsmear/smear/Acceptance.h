@@ -24,6 +24,7 @@ class TString;
 
 namespace erhic {
 
+class VirtualEvent;
 class VirtualParticle;
 
 }  // namespace erhic
@@ -49,6 +50,13 @@ class Acceptance {
     CustomCut();
     CustomCut(const TString&, double min, double max);
     virtual bool Contains(const erhic::VirtualParticle&) const;
+
+    /**
+     Evaluate the cut on precomputed kinematics.
+     The array holds E, p, theta, phi, pz and pt indexed by KinType,
+     with the values returned by GetVariable().
+     */
+    bool Contains(const double* kinematics) const;
    protected:
     TFormula mFormula;
     int dim;
@@ -102,6 +110,24 @@ class Acceptance {
      */
     virtual Bool_t Contains(const erhic::VirtualParticle&) const;
 
+    /**
+     Fills the accepted (min, max) ranges of the zone,
+     ordered as theta, phi, E, p, pT, pz.
+     Each array must hold at least six values.
+     */
+    void GetBox(double* lower, double* upper) const;
+
+    /**
+     Returns true if the zone has one or more CustomCuts.
+     */
+    bool HasCustomCuts() const;
+
+    /**
+     Returns true if precomputed kinematics (indexed by KinType)
+     pass all CustomCuts of the zone.
+     */
+    bool PassesCustomCuts(const double* kinematics) const;
+
    protected:
     double thetaMin;
     double thetaMax;
@@ -121,6 +147,26 @@ class Acceptance {
     ClassDef(Smear::Acceptance::Zone, 1)
   };
 
+  /**
+   The kinematics of the final-state tracks of an event, gathered once
+   per event by Gather() and shared by the acceptances of all devices,
+   with scratch space for AcceptTracks().
+   Reuse one across events, so its buffers are allocated only once.
+   */
+  struct TrackKinematics {
+    /**
+     Gathers the non-NULL final-state tracks of the event.
+     */
+    void Gather(const erhic::VirtualEvent&);
+
+    std::vector<const erhic::VirtualParticle*> tracks;
+    std::vector<unsigned> indices;  ///< Index of each track in the event
+    std::vector<double> boxes;  ///< Six per track, ordered as GetBox()
+    std::vector<double> kinematics;  ///< Per track, indexed by KinType
+    std::vector<char> decided;  ///< Scratch for AcceptTracks()
+    std::vector<char> inZone;  ///< Scratch for AcceptTracks()
+  };
+
   /** Destructor */
   virtual ~Acceptance();
 
@@ -181,12 +227,47 @@ class Acceptance {
    */
   bool Is(const erhic::VirtualParticle& prt) const;
 
+  /**
+   Evaluates the acceptance of all gathered tracks of an event in one
+   pass, setting accepted[i * stride] nonzero for each track i of the
+   event for which Is() would return true. Leaves the other entries,
+   which the caller should have zeroed, alone.
+   */
+  void AcceptTracks(TrackKinematics&, char* accepted, unsigned stride) const;
+
+  /**
+   Flattens zones into contiguous (min, max) boxes, six bounds per zone
+   ordered as in Zone::GetBox(), and flags the zones with CustomCuts.
+   */
+  static void Compile(const std::vector<Zone>&, std::vector<double>& lower,
+                      std::vector<double>& upper,
+                      std::vector<char>& hasCustomCuts);
+
  protected:
+  /**
+   Returns true if the particle passes the genre, charge and
+   particle-type selections, i.e. everything but the zones.
+   */
+  bool IsSelectedSpecies(const erhic::VirtualParticle& prt) const;
+
+  /**
+   Compiles the zones of this acceptance.
+   Called whenever the zones change; the read rule compiles the zones
+   of an acceptance read from a file.
+   */
+  void Compile();
+
   int mGenre;
   ECharge mCharge;  // Particle charges accepted (neutral, charged or all)
   std::vector<Zone> mZones;
   std::set<int> mParticles;
 
+  // Zones compiled by Compile(). Each zone contributes six consecutive
+  // bounds, ordered as in Zone::GetBox(). Rebuilt, not stored.
+  std::vector<double> mLower;  //!
+  std::vector<double> mUpper;  //!
+  std::vector<char> mHasCustomCuts;  //!
+
   ClassDef(Smear::Acceptance, 1)
 };
 
@@ -16,17 +16,22 @@
 #include <TObject.h>
 #include <TString.h>
 
+#include "eicsmear/smear/Acceptance.h"
+
 namespace erhic {
 
 class EventDis;
+class VirtualEvent;
 class VirtualParticle;
 
 }  // namespace erhic
 
 namespace Smear {
 
+class DetectorStats;
 class Event;
 class ParticleMCS;
+class ParticlePool;
 class Smearer;
 
 /**
@@ -120,8 +125,47 @@ class Detector : public TObject {
    */
   ParticleMCS* Smear(const erhic::VirtualParticle&) const;
 
+  /**
+   As Smear(), but takes the smeared particle from the pool
+   instead of allocating a new one. The pool keeps ownership.
+   */
+  ParticleMCS* Smear(const erhic::VirtualParticle&, ParticlePool&) const;
+
+  /**
+   Smears the particle once per pool, storing the smeared replicas in
+   the vector, each taken from its pool or, for a NULL pool, allocated
+   with new. The acceptance is tested once, and each device evaluates
+   its resolution once, so only the random throws differ between
+   replicas. All entries are NULL if the particle isn't accepted.
+   If any device has scan points (see Device::SetScan()), replica k is
+   scan point k, and all points share the same Gaussian random numbers.
+   */
+  void Smear(const erhic::VirtualParticle&,
+             const std::vector<ParticlePool*>& pools,
+             std::vector<ParticleMCS*>& replicas) const;
+
+  /**
+   As Smear() with replicas, for a particle whose acceptance by each
+   device was found with the rest of its event by Accept(): accepted
+   points to the entry of the particle for the first device.
+   An instrumented detector tests the acceptance itself, to count it.
+   */
+  void Smear(const erhic::VirtualParticle&, const char* accepted,
+             const std::vector<ParticlePool*>& pools,
+             std::vector<ParticleMCS*>& replicas) const;
+
+  /**
+   Returns the largest number of scan points of any device,
+   0 if no device scans its resolution.
+   Counted once when the devices change, as Smear() needs it for every
+   particle.
+   */
+  UInt_t GetNScanPoints() const;
+
   /**
    Print information about all smearers to standard output.
+   With option "stats", prints the per-device statistics instead
+   (see SetInstrumentation()).
    */
   virtual void Print(Option_t* = "") const;
 
@@ -130,6 +174,20 @@ class Detector : public TObject {
    */
   std::list<Smear::Smearer*> Accept(const erhic::VirtualParticle&) const;
 
+  /**
+   Tests the acceptance of every track of the event by each device,
+   one device at a time (see Acceptance::AcceptTracks()).
+   Entry j * GetNDevices() + i is nonzero if device i accepts track j.
+   */
+  void Accept(const erhic::VirtualEvent&, std::vector<char>& accepted) const;
+
+  /**
+   As Accept() for an event, gathering the kinematics of the tracks
+   into the caller's buffers, which can be reused for every event.
+   */
+  void Accept(const erhic::VirtualEvent&, Acceptance::TrackKinematics&,
+              std::vector<char>& accepted) const;
+
   /**
      Turn off consistency checks and momentum regularization in Smear().
      Use only for legacy smear scripts from earlier versions (<~1.0.4)
@@ -140,19 +198,60 @@ class Detector : public TObject {
      Check status of legacy mode.
   */
   virtual bool GetLegacyMode() const;
-  
+
+  /**
+   Turns recording of per-device statistics in Smear() on or off.
+   For each device, counts the particles tested and accepted, the time
+   spent testing and smearing them, negative values reset by
+   ParticleMCS::HandleBogusValues() and particles it first gave a NaN.
+   Turning it on, or adding or deleting devices, resets the counts.
+   Off by default, when it costs one test per particle.
+   */
+  void SetInstrumentation(bool on = true);
+
+  /**
+   Returns the per-device statistics, or NULL if instrumentation is off.
+   Copies of the detector, such as those held by smeared event factories,
+   keep their own statistics.
+   */
+  const DetectorStats* GetStats() const;
+
  protected:
   /**
    Returns pointers to new copies of all devices.
    */
   std::vector<Smear::Smearer*> CopyDevices() const;
 
+  /**
+   Implements Smear(), taking the smeared particle from the pool
+   or, if it is NULL, allocating a new one.
+   */
+  ParticleMCS* SmearParticle(const erhic::VirtualParticle&,
+                             ParticlePool*) const;
+
+  /**
+   Smear() with instrumentation: smears the particle with each
+   accepting device in turn, recording the device statistics.
+   */
+  ParticleMCS* SmearCounted(const erhic::VirtualParticle&,
+                            ParticlePool*) const;
+
+  /**
+   Computes the momentum components of the smeared particle that no
+   device smeared from those that were, throwing std::runtime_error if
+   they are inconsistent (unless in legacy mode).
+   Does nothing for a NULL particle.
+   */
+  void DeriveMomentum(const erhic::VirtualParticle&, ParticleMCS*) const;
+
   bool LegacyMode=false;
 
   bool useNM;
   bool useJB;
   bool useDA;
   std::vector<Smearer*> Devices;
+  DetectorStats* mStats;  //! NULL unless instrumented
+  mutable Int_t mNScanPoints;  //! Cached by GetNScanPoints(), -1 if not yet
 
   ClassDef(Smear::Detector, 1)
 };
@@ -161,6 +260,10 @@ inline UInt_t Detector::GetNDevices() const {
   return Devices.size();
 }
 
+inline const DetectorStats* Detector::GetStats() const {
+  return mStats;
+}
+
 }  // namespace Smear
 
 #endif  // INCLUDE_EICSMEAR_SMEAR_DETECTOR_H_
@@ -0,0 +1,129 @@
+/**
+ \file
+ Declaration of class Smear::DetectorStats.
+
+ \date      2026-10-18
+ \copyright 2026 Brookhaven National Lab
+ */
+
+#ifndef INCLUDE_EICSMEAR_SMEAR_DETECTORSTATS_H_
+#define INCLUDE_EICSMEAR_SMEAR_DETECTORSTATS_H_
+
+#include <vector>
+
+#include <TObject.h>
+#include <TString.h>
+
+namespace Smear {
+
+class Smearer;
+
+/**
+ Counters recorded for one device of an instrumented Detector.
+ */
+struct DeviceStats {
+  DeviceStats();
+
+  TString name;          ///< Index and class of the device
+  Long64_t tested;       ///< Final-state particles tested for acceptance
+  Long64_t accepted;     ///< Particles accepted, and so smeared
+  Long64_t nanoseconds;  ///< Time spent testing and smearing particles
+  Long64_t bogus;        ///< Negative E, p or pT reset to zero
+  Long64_t nan;          ///< Particles first given a NaN value by the device
+};
+
+/**
+ Per-device statistics of an instrumented Detector.
+ See Detector::SetInstrumentation().
+ */
+class DetectorStats : public TObject {
+ public:
+  /**
+   Default constructor.
+   */
+  DetectorStats();
+
+  /**
+   Destructor.
+   */
+  virtual ~DetectorStats();
+
+  /**
+   Clears all counts, and sets one entry per device.
+   */
+  void Reset(const std::vector<Smearer*>& devices);
+
+  /**
+   Returns the number of devices.
+   */
+  UInt_t GetNDevices() const;
+
+  /**
+   Returns the counters of device number n.
+   */
+  DeviceStats& GetDevice(UInt_t n);
+
+  /**
+   Returns the counters of device number n.
+   */
+  const DeviceStats& GetDevice(UInt_t n) const;
+
+  /**
+   Counts a particle passed to Detector::Smear(), and whether any
+   device smeared it.
+   */
+  void AddParticle(bool smeared);
+
+  /**
+   Returns the number of particles passed to Detector::Smear().
+   */
+  Long64_t GetNParticles() const;
+
+  /**
+   Returns the number of particles smeared by at least one device.
+   */
+  Long64_t GetNSmeared() const;
+
+  /**
+   Prints a table of the counters, one line per device.
+   */
+  virtual void Print(Option_t* = "") const;
+
+ protected:
+  std::vector<DeviceStats> mDevices;
+  Long64_t mNParticles;
+  Long64_t mNSmeared;
+
+  ClassDef(Smear::DetectorStats, 1)
+};
+
+inline UInt_t DetectorStats::GetNDevices() const {
+  return mDevices.size();
+}
+
+inline DeviceStats& DetectorStats::GetDevice(UInt_t n) {
+  return mDevices.at(n);
+}
+
+inline const DeviceStats& DetectorStats::GetDevice(UInt_t n) const {
+  return mDevices.at(n);
+}
+
+inline void DetectorStats::AddParticle(bool smeared) {
+  ++mNParticles;
+  if (smeared) {
+    ++mNSmeared;
+  }  // if
+}
+
+inline Long64_t DetectorStats::GetNParticles() const {
+  return mNParticles;
+}
+
+inline Long64_t DetectorStats::GetNSmeared() const {
+  return mNSmeared;
+}
+
+}  // namespace Smear
+
+#endif  // INCLUDE_EICSMEAR_SMEAR_DETECTORSTATS_H_
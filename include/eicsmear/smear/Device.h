@@ -101,6 +101,28 @@ class Device : public Smearer {
    */
   virtual void Smear(const erhic::VirtualParticle&, ParticleMCS&);
 
+  /**
+   As Smear(), without testing the acceptance.
+   The resolution is only evaluated again if the particle kinematics
+   differ from the previous call, so smearing replicas of a particle
+   costs one random number each.
+   */
+  virtual void SmearAccepted(const erhic::VirtualParticle&, ParticleMCS&);
+
+  /**
+   Sets the resolutions of a parameter scan, one formula per scan point,
+   in the same form as the resolution passed to the constructor.
+   While the Detector smears scan point k (see Distributor::BeginScanPoint()),
+   this device uses resolution k instead of its own; all points use the
+   same random numbers. An empty list ends the scan.
+   */
+  void SetScan(const std::vector<TString>& resolutions);
+
+  /**
+   Returns the number of scan points, 0 if there is no scan.
+   */
+  UInt_t GetNScanPoints() const;
+
   /**
    Set the random distribution from which to sample smeared kinematics.
    By default a Gaussian distribution is used.
@@ -116,23 +138,36 @@ class Device : public Smearer {
   bool Init(const TString&, const TString&, int);
 
   KinType mSmeared;   ///< Smeared variable
-  TF1* mKinematicFunction;
+  const TF1* mKinematicFunction;  //! Shared, see FormulaString::Compile()
   FormulaString* mFormula;  ///< Expression for resolution standard deviation
   std::vector<Smear::KinType> mDimensions;  ///< Variables on which smearing
                                             ///< is dependent (up to 4)
   Distributor mDistribution;  ///< Random distribution
+  std::vector<FormulaString*> mScan;  ///< Resolution of each scan point
+
+  // Arguments and results of the last evaluation of the kinematic and
+  // resolution functions, see SmearAccepted()
+  std::vector<double> mCachedArgs;  //!
+  double mCachedVariable;  //!
+  double mCachedUnsmeared;  //!
+  double mCachedResolution;  //!
+  bool mCacheValid;  //!
 
  private:
   // Assignment is not supported
   Device& operator=(const Device&) { return *this; }
 
-  ClassDef(Smear::Device, 1)
+  ClassDef(Smear::Device, 3)
 };
 
 inline void Device::SetDistribution(const Distributor& d) {
   mDistribution = d;
 }
 
+inline UInt_t Device::GetNScanPoints() const {
+  return mScan.size();
+}
+
 }  // namespace Smear
 
 #endif  // INCLUDE_EICSMEAR_SMEAR_DEVICE_H_
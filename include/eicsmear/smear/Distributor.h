@@ -13,6 +13,7 @@
 #include <Rtypes.h>
 
 class TF1;
+class TRandom;
 class TString;
 
 namespace Smear {
@@ -64,6 +65,40 @@ class Distributor {
    */
   virtual double Generate(double midpoint, double width);
 
+  /**
+   Sets the generator used by all distributions in the calling thread,
+   in place of gRandom, so threads smearing at once each have their own.
+   NULL goes back to gRandom. The caller keeps ownership.
+   Custom distributions only use it with ROOT 6.24 or later.
+   */
+  static void SetThreadRandom(TRandom*);
+
+  /**
+   Returns the generator used in the calling thread.
+   */
+  static TRandom* GetRandom();
+
+  /**
+   Starts smearing scan point k of a particle in the calling thread,
+   for common random numbers: Gaussian values are thrown as
+   midpoint + width * z, where point 0 draws new standard-normal z and
+   records them, and later points reuse them in the same order.
+   Points then differ only by their widths, not by statistical noise.
+   Custom distributions still throw independently.
+   */
+  static void BeginScanPoint(int point);
+
+  /**
+   Ends the scan in the calling thread, going back to independent throws.
+   */
+  static void EndScan();
+
+  /**
+   Returns the scan point being smeared in the calling thread,
+   or -1 outside a scan.
+   */
+  static int GetScanPoint();
+
  protected:
   double mPlus;
   double mMinus;
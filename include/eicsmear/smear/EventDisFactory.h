@@ -10,15 +10,21 @@
 #ifndef INCLUDE_EICSMEAR_SMEAR_EVENTDISFACTORY_H_
 #define INCLUDE_EICSMEAR_SMEAR_EVENTDISFACTORY_H_
 
+#include <deque>
+#include <string>
+#include <vector>
+
 #include "eicsmear/smear/Detector.h"
 #include "eicsmear/smear/EventSmear.h"
 #include "eicsmear/smear/EventFactory.h"
+#include "eicsmear/smear/ParticlePool.h"
 
 class TBranch;
 
 namespace erhic {
 
 class EventDis;
+class OutputPolicy;
 
 }  // namespace erhic
 
@@ -41,6 +47,29 @@ class EventDisFactory : public EventFactory<Smear::Event> {
    */
   EventDisFactory(const Detector&, TBranch&);
 
+  /**
+   Constructor.
+   Reads DIS Monte Carlo events from the "event" branch of the tree.
+   Unlike the branch, this also follows a TChain from file to file.
+   */
+  EventDisFactory(const Detector&, TTree&);
+
+  /**
+   Constructor.
+   Reads no input: the Monte Carlo event is passed to SetMcEvent(),
+   typically by a reader shared by several factories. The reader then
+   computes the quantities slim events don't store
+   (see erhic::EventMC::ComputeDerivedQuantities()), so that the
+   factories only read the event.
+   */
+  explicit EventDisFactory(const Detector&);
+
+  /**
+   Sets the Monte Carlo event to smear, for a factory reading no input.
+   The factory doesn't take ownership.
+   */
+  void SetMcEvent(erhic::EventDis*);
+
   /**
    Create a smeared event corresponding to the current DIS Monte Carlo
    event in the input branch passed to the constructor.
@@ -49,17 +78,145 @@ class EventDisFactory : public EventFactory<Smear::Event> {
    */
   virtual Event* Create();
 
+  using EventFactory<Smear::Event>::Branch;
+
+  /**
+   Creates the branch for the events filled by Fill(), with the basket
+   size and split level of the policy. The branch holds the address of
+   the recycled event, which the factory owns.
+   Returns NULL in case of an error.
+   */
+  TBranch* Branch(TTree&, const std::string& name,
+                  const erhic::OutputPolicy&);
+
+  /**
+   Creates a branch in each tree for the replicas filled by
+   FillReplicas(), as Branch() does.
+   Returns the branches, or none in case of an error.
+   */
+  std::vector<TBranch*> BranchReplicas(const std::vector<TTree*>&,
+                                       const std::string& name,
+                                       const erhic::OutputPolicy&);
+
+  /**
+   Smears the current DIS Monte Carlo event and fills the branch with it.
+   When recycling (the default), one event and the particles in it are
+   reused for every call, and the branch address stays the same;
+   otherwise each call creates and deletes a new event.
+   */
+  virtual void Fill(TBranch&);
+
+  /**
+   Smears the current DIS Monte Carlo event once per branch, and fills
+   each branch, typically each in its own tree, with its replica.
+   The acceptance and resolutions are evaluated once for all replicas,
+   so only the random throws differ (see Detector::Smear()).
+   The events and particles are recycled as by Fill().
+   */
+  void FillReplicas(const std::vector<TBranch*>&);
+
+  /**
+   Turns reuse of the event and particles by Fill() on or off.
+   */
+  void SetRecycling(bool = true);
+
+  /**
+   Returns true if Fill() reuses the event and particles.
+   */
+  bool GetRecycling() const;
+
+  /**
+   If set to true, smeared events store only the detected particles,
+   with the indices of their Monte Carlo tracks (see Event::SetSparse()).
+   */
+  void SetSparse(bool = true);
+
+  /**
+   Returns true if smeared events store only detected particles.
+   */
+  bool GetSparse() const;
+
   erhic::VirtualEvent* GetEvBufferPtr();
 
+  /**
+   Returns the factory's copy of the detector.
+   */
+  const Detector& GetDetector() const;
+
  protected:
+  /**
+   Smears the current DIS Monte Carlo event into the (empty) event,
+   taking particles from its pool if it has one.
+   */
+  void Build(Event&);
+
+  /**
+   Smears the current DIS Monte Carlo event into each of the (empty)
+   events, taking particles from their pools if they have them.
+   */
+  void Build(Event* const* events, unsigned nEvents);
+
+  /**
+   Creates the recycled event of Fill(), if not done yet.
+   */
+  void AllocateEvent();
+
+  /**
+   Replaces the recycled events of FillReplicas() by n new ones.
+   */
+  void AllocateReplicas(unsigned n);
+
   Detector mDetector;
   erhic::EventDis* mMcEvent;
+  bool mDeriveSlim;  ///< Compute the quantities slim events don't store
+  bool mRecycling;
+  bool mSparse;
+  ParticlePool mPool;  ///< Particles of the recycled event
+  Event* mEvent;  ///< The recycled event, the address of mBranch
+  TBranch* mBranch;  ///< The branch last filled with mEvent
+  std::vector<Event*> mReplicas;  ///< Recycled events of FillReplicas()
+  std::deque<ParticlePool> mReplicaPools;  ///< Particles of mReplicas
+  std::vector<TBranch*> mReplicaBranches;  ///< Branches last filled
+                                           ///< with mReplicas
+  std::vector<ParticlePool*> mPools;  ///< Pools of the events in Build()
+  std::vector<ParticleMCS*> mSmeared;  ///< Replicas of a particle in Build()
+  std::vector<char> mAccepted;  ///< Acceptance of each track by each
+                                ///< device in Build()
+  Acceptance::TrackKinematics mTracks;  ///< Gathered by Accept() in Build()
+
+ private:
+  EventDisFactory(const EventDisFactory&) = delete;
+  EventDisFactory& operator=(const EventDisFactory&) = delete;
 };
 
+inline void EventDisFactory::SetMcEvent(erhic::EventDis* event) {
+  mMcEvent = event;
+}
+
 inline erhic::VirtualEvent* EventDisFactory::GetEvBufferPtr() {
   return mMcEvent;
 }
 
+inline void EventDisFactory::SetRecycling(bool recycle) {
+  mRecycling = recycle;
+}
+
+inline bool EventDisFactory::GetRecycling() const {
+  return mRecycling;
+}
+
+inline void EventDisFactory::SetSparse(bool sparse) {
+  mSparse = sparse;
+}
+
+inline bool EventDisFactory::GetSparse() const {
+  return mSparse;
+}
+
+inline const Detector& EventDisFactory::GetDetector() const {
+  return mDetector;
+}
+
 }  // namespace Smear
 
 #endif  // INCLUDE_EICSMEAR_SMEAR_EVENTDISFACTORY_H_
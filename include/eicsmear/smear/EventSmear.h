@@ -12,22 +12,31 @@
 
 #include <cmath>
 #include <list>
+#include <string>
 #include <vector>
 
 #include <TObject.h>
 
 #include "eicsmear/erhic/EventDis.h"
 #include "eicsmear/erhic/Kinematics.h"
+#include "eicsmear/erhic/TrackView.h"
 #include "eicsmear/smear/ParticleMCS.h"
 #include "eicsmear/erhic/VirtualParticle.h"
 
 namespace Smear {
 
+class ParticlePool;
+
 /*
  A generator-independent DIS event with smeared kinematics and particles.
  */
 class Event : public erhic::EventDis {
  public:
+  /**
+   A selection of tracks in the event, see HadronicFinalStateParticles().
+   */
+  typedef erhic::TrackView<Event, ParticleMCS> ParticleView;
+
   /**
    Default constructor.
    */
@@ -48,6 +57,19 @@ class Event : public erhic::EventDis {
    */
   virtual void ClearParticles();
 
+  /**
+   Sets a pool owning the particles of the event, which are then
+   returned to the pool instead of deleted when the event is cleared.
+   The pool must outlive the event. NULL (the default) means the event
+   owns its particles.
+   */
+  void SetParticlePool(ParticlePool*);
+
+  /**
+   Returns the pool owning the particles, or NULL if the event owns them.
+   */
+  ParticlePool* GetParticlePool() const;
+
   /**
    Returns the number of tracks in the event.
    */
@@ -121,10 +143,45 @@ class Event : public erhic::EventDis {
   /**
    Add a new track to the end of the track list.
    The track must be allocated via new and is subsequently owned
-   by the Event.
+   by the Event, or taken from the event's particle pool if it has one.
    */
   virtual void AddLast(ParticleMCS* particle);
 
+  /**
+   Adds a track smeared from the Monte Carlo track with the index given.
+   In a sparse event (see SetSparse()) the track and index are stored
+   only if the track is not NULL, i.e. was detected; otherwise this is
+   the same as AddLast(ParticleMCS*).
+   */
+  void AddLast(ParticleMCS* particle, Int_t truthIndex);
+
+  /**
+   Sets whether the event is sparse, storing only detected particles
+   together with the indices of their Monte Carlo tracks, rather than
+   one entry per Monte Carlo track with NULL for undetected ones.
+   Set before adding tracks.
+   */
+  void SetSparse(bool = true);
+
+  /**
+   Returns true if the event stores only detected particles.
+   */
+  bool IsSparse() const;
+
+  /**
+   Returns the index of the Monte Carlo track from which the track with
+   the index given was smeared, or -1 if there is no such track.
+   Without sparse storage this is the index itself.
+   */
+  Int_t GetTruthIndex(UInt_t) const;
+
+  /**
+   Returns the track smeared from the Monte Carlo track with the index
+   given, or NULL if that track was not detected.
+   This works the same with and without sparse storage.
+   */
+  const ParticleMCS* GetTrackFromTruth(UInt_t truthIndex) const;
+
   /**
    Yields all particles that belong to the hadronic final state.
    This is the same as the result of FinalState(), minus the scattered
@@ -132,9 +189,19 @@ class Event : public erhic::EventDis {
    */
   void HadronicFinalState(ParticlePtrList&) const;
 
+  /**
+   Returns the detected particles of the hadronic final state, as
+   HadronicFinalState() but without copying them to a list first:
+   \code
+   for (const ParticleMCS* particle : event.HadronicFinalStateParticles()) {
+   \endcode
+   */
+  ParticleView HadronicFinalStateParticles() const;
+
   /**
    Returns a vector of pointers to all tracks in the event.
-   Note that this includes NULL pointers to tracks that were not detected.
+   Note that this includes NULL pointers to tracks that were not detected,
+   unless the event is sparse (see SetSparse()).
    Do not delete the pointers.
    */
   std::vector<const erhic::VirtualParticle*> GetTracks() const;
@@ -150,12 +217,29 @@ class Event : public erhic::EventDis {
    */
   virtual void Print(Option_t* = "") const;
 
+  /**
+   Returns true if the named data member of Event records how the
+   event is stored rather than describing it, so is not an event
+   variable, e.g. for HepMC attributes.
+   */
+  static bool IsBookkeepingMember(const std::string& name);
+
  protected:
   Int_t nTracks;  ///< Number of particles (intermediate + final)
   std::vector<ParticleMCS*> particles;  ///< The smeared particle list
+  // Bookkeeping members, listed by IsBookkeepingMember()
   Int_t mScatteredIndex;
+  Bool_t mSparse;  ///< True if only detected particles are stored
+  std::vector<Int_t> mTruthIndices;  ///< Monte Carlo track index of each
+                                     ///< particle, for sparse events
+  ParticlePool* mPool;  //! Owner of the particles, if not NULL
 
-  ClassDef(Smear::Event, 1)
+  // Position of the track smeared from each Monte Carlo track, or -1,
+  // built from mTruthIndices on first use by GetTrackFromTruth()
+  mutable std::vector<Int_t> mSmearedIndices;  //!
+  mutable bool mSmearedIndicesValid;  //!
+
+  ClassDef(Smear::Event, 2)
 };
 
 inline UInt_t Event::GetNTracks() const {
@@ -170,6 +254,29 @@ inline Smear::ParticleMCS* Event::GetTrack(UInt_t u) {
   return (u < particles.size() ? particles.at(u) : NULL);
 }
 
+inline void Event::SetSparse(bool sparse) {
+  mSparse = sparse;
+}
+
+inline bool Event::IsSparse() const {
+  return mSparse;
+}
+
+inline Int_t Event::GetTruthIndex(UInt_t u) const {
+  if (u >= particles.size()) {
+    return -1;
+  }  // if
+  return (mSparse ? mTruthIndices.at(u) : Int_t(u));
+}
+
+inline void Event::SetParticlePool(ParticlePool* pool) {
+  mPool = pool;
+}
+
+inline ParticlePool* Event::GetParticlePool() const {
+  return mPool;
+}
+
 inline const ParticleMCS* Event::BeamLepton() const {
   return (particles.empty() ? NULL : particles.front());
 }
@@ -178,6 +285,11 @@ inline const ParticleMCS* Event::BeamHadron() const {
   return (particles.size() > 1 ? particles.at(1) : NULL);
 }
 
+inline Event::ParticleView Event::HadronicFinalStateParticles() const {
+  // Skip the first two entries, as these are the incident beams
+  return ParticleView(*this, 2, false, ScatteredLepton());
+}
+
 inline const ParticleMCS* Event::ExchangeBoson() const {
   return NULL;
 }
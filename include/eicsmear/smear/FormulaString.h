@@ -17,6 +17,7 @@
 
 #include "eicsmear/smear/Smear.h"  // For KinType enum
 
+class TF1;
 class TFormula;
 
 namespace Smear {
@@ -58,6 +59,19 @@ class FormulaString : public TObject {
    */
   explicit FormulaString(const std::string&);
 
+  /**
+   Copy constructor.
+   The copy shares the compiled formula, so is cheap.
+   */
+  FormulaString(const FormulaString&);
+
+  /**
+   Returns a dynamically allocated copy of this object.
+   The argument is unused and is present for compatibility with
+   ROOT::TObject::Clone().
+   */
+  virtual FormulaString* Clone(const char* = "") const;
+
   /**
    Evaluate the formula with the provided arguments.
    Arguments should be listed in the order they were
@@ -97,6 +111,22 @@ class FormulaString : public TObject {
    */
   static KinType GetKinType(const std::string&);
 
+  /**
+   Returns the compiled TFormula for a formula string in the form passed
+   to the constructor, or NULL for an empty string.
+   Each distinct expression, ignoring whitespace, is compiled once per
+   process and shared by every formula using it, so constructing and
+   copying detectors doesn't compile them again.
+   The formula is owned by the cache and kept for the life of the process.
+   */
+  static const TFormula* Compile(const std::string&);
+
+  /**
+   As Compile(), returning a TF1 of one variable, for functions that
+   need inverting.
+   */
+  static const TF1* CompileFunction(const std::string&);
+
  protected:
   /**
    Process the input string, containing "P", "theta" etc into a version
@@ -104,11 +134,11 @@ class FormulaString : public TObject {
    */
   std::string Parse(const std::string&);
 
-  TFormula* mFormula;
+  const TFormula* mFormula;  //! Shared, compiled from mInput (see Compile())
   std::string mInput;  ///< Original formula (before parsing)
   std::vector<Smear::KinType> mVariables;
 
-  ClassDef(Smear::FormulaString, 1)
+  ClassDef(Smear::FormulaString, 2)
 };
 
 }  // namespace Smear
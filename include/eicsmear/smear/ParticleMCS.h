@@ -48,6 +48,18 @@ class ParticleMCS : public erhic::VirtualParticle {
   // Let's kill all else
   ParticleMCS(const ParticleMCS&) =delete;
   ParticleMCS& operator=(const ParticleMCS&) =delete;
+
+  /**
+   Restores the values of a default-constructed particle,
+   so the particle can be reused (see ParticlePool).
+   */
+  void Reset();
+
+  /**
+   Restores the values of a particle constructed from an E-p 4-vector,
+   pdg code and status code.
+   */
+  void Reset(const TLorentzVector&, int pdg, int status);
   
 
   // ---------------
@@ -168,6 +180,33 @@ class ParticleMCS : public erhic::VirtualParticle {
   virtual bool IsIdSmeared() const; //< pdg Id smeared?
   virtual bool IsNumSigmaSmeared() const; //< PID numSigma smeared?
 
+  /**
+   Bits of mSmearFlags, one per smeared quantity.
+   */
+  enum SmearFlag {
+    kSmearedParticle = 1 << 0,
+    kSmearedE = 1 << 1,
+    kSmearedP = 1 << 2,
+    kSmearedPt = 1 << 3,
+    kSmearedPx = 1 << 4,
+    kSmearedPy = 1 << 5,
+    kSmearedPz = 1 << 6,
+    kSmearedTheta = 1 << 7,
+    kSmearedPhi = 1 << 8,
+    kSmearedId = 1 << 9,
+    kSmearedNumSigma = 1 << 10
+  };
+
+  /**
+   Returns true if the flag is set.
+   */
+  bool TestSmearFlag(SmearFlag) const;
+
+  /**
+   Sets or clears the flag.
+   */
+  void SetSmearFlag(SmearFlag, bool);
+
   // ---------------
   // --- Setters ---
   // ---------------
@@ -269,44 +308,68 @@ class ParticleMCS : public erhic::VirtualParticle {
   */
   void HandleBogusValues( const KinType kin );
 
+  /**
+     Returns the number of values reset by HandleBogusValues() so far,
+     by all particles smeared in the calling thread.
+  */
+  static ULong64_t GetNBogusValues();
+
 
  protected:
 
-  /** should always be true for a ParticleMCS
-      This replaces the brittle mechanism of checking values against 0
-      If false, it should indicate an old tree was used.
+  /**
+   Sets the flag of a quantity about to be smeared.
+   If check is true, throws std::runtime_error if it was already set.
    */
-  bool kParticleSmeared=false;
-  bool kESmeared=false;
-  bool kPSmeared=false;
-  bool kPtSmeared=false;
-  bool kPxSmeared=false;
-  bool kPySmeared=false;
-  bool kPzSmeared=false;
-  bool kThetaSmeared=false;
-  bool kPhiSmeared=false;
-  bool kIdSmeared=false;
-  bool kNumSigmaSmeared=false;
-
-
+  void MarkSmeared(SmearFlag, bool check, const char* name);
+
+  // The momenta and energy are stored as floats with the mantissa
+  // truncated to 14 bits, a relative precision of 6e-5, well below the
+  // resolution of any detector, which keeps the precision of small
+  // momenta. The angles have fixed ranges, so are stored as integers
+  // of 20 bits with the same absolute precision anywhere in the range;
+  // values outside the range are stored as its nearest end.
+  UShort_t   mSmearFlags;  ///< SmearFlag bits; kSmearedParticle should
+                           ///< always be set for a ParticleMCS,
+                           ///< unset indicates an old tree
   UShort_t   status;      ///< Status code
   Int_t      id;          ///< PDG particle code
-  Double32_t px;          ///< x component of particle momentum
-  Double32_t py;          ///< y component of particle momentum
-  Double32_t pz;          ///< z component of particle momentum
-  Double32_t E;           ///< Energy of particle
-  Double32_t pt;          ///< Transverse momentum of particle
-  Double32_t p;           ///< Total momentum of particle
-  Double32_t theta;       ///< Polar angle
-  Double32_t phi;         ///< Azimuthal angle
-
-  double  numSigma;       ///< PID: nSigma deviation
+  Double32_t px;          ///< x component of particle momentum [0,0,14]
+                          ///< to a relative 6e-5
+  Double32_t py;          ///< y component of particle momentum [0,0,14]
+                          ///< to a relative 6e-5
+  Double32_t pz;          ///< z component of particle momentum [0,0,14]
+                          ///< to a relative 6e-5
+  Double32_t E;           ///< Energy of particle [0,0,14]
+                          ///< to a relative 6e-5
+  Double32_t pt;          ///< Transverse momentum of particle [0,0,14]
+                          ///< to a relative 6e-5
+  Double32_t p;           ///< Total momentum of particle [0,0,14]
+                          ///< to a relative 6e-5
+  Double32_t theta;       ///< Polar angle [0,pi,20] to 3e-6 rad
+  Double32_t phi;         ///< Azimuthal angle [-pi,2pi,20] to 9e-6 rad,
+                          ///< as smeared angles are in [0, 2pi) but
+                          ///< copies of Monte Carlo ones in (-pi, pi]
+
+  Double32_t numSigma;    ///< PID: nSigma deviation [0,0,10]
   int numSigmaType;       ///< PID: nSigma deviation type. pi_k == 1, k_p == 2. \TODO: This should be agreed upon and fixed better.
 
-  ClassDef(Smear::ParticleMCS, 3)
+  ClassDef(Smear::ParticleMCS, 4)
 };
 
 
+inline bool ParticleMCS::TestSmearFlag(SmearFlag flag) const {
+  return mSmearFlags & flag;
+}
+
+inline void ParticleMCS::SetSmearFlag(SmearFlag flag, bool set) {
+  if (set) {
+    mSmearFlags |= flag;
+  } else {
+    mSmearFlags &= ~flag;
+  }  // if
+}
+
 }  // namespace Smear
 
 #endif  // INCLUDE_EICSMEAR_SMEAR_PARTICLEMCS_H_
@@ -0,0 +1,82 @@
+/**
+ \file
+ Declaration of class Smear::ParticlePool.
+
+ \date      2026-10-18
+ \copyright 2026 Brookhaven National Lab
+ */
+
+#ifndef INCLUDE_EICSMEAR_SMEAR_PARTICLEPOOL_H_
+#define INCLUDE_EICSMEAR_SMEAR_PARTICLEPOOL_H_
+
+#include <cstddef>
+#include <deque>
+
+#include "eicsmear/smear/ParticleMCS.h"
+
+namespace Smear {
+
+/**
+ A slab of smeared particles reused from one event to the next,
+ so smearing an event allocates no memory once the slab is large enough
+ for the largest event.
+ Particles stay at the same address while the pool exists, so pointers
+ to them remain valid until Release() is called.
+ */
+class ParticlePool {
+ public:
+  /**
+   Constructor.
+   */
+  ParticlePool();
+
+  /**
+   Destructor. Deletes all particles.
+   */
+  ~ParticlePool();
+
+  /**
+   Returns a particle with the values of a default-constructed particle.
+   The pool keeps ownership; do not delete it.
+   */
+  ParticleMCS* Acquire();
+
+  /**
+   Returns all particles to the pool, for use by the next event.
+   */
+  void Release();
+
+  /**
+   Returns the number of particles acquired since the last Release().
+   */
+  std::size_t GetNAcquired() const;
+
+  /**
+   Returns the number of particles held by the pool.
+   */
+  std::size_t GetCapacity() const;
+
+ protected:
+  std::deque<ParticleMCS> mParticles;  ///< Adding keeps existing addresses
+  std::size_t mNAcquired;
+
+ private:
+  ParticlePool(const ParticlePool&) = delete;
+  ParticlePool& operator=(const ParticlePool&) = delete;
+};
+
+inline void ParticlePool::Release() {
+  mNAcquired = 0;
+}
+
+inline std::size_t ParticlePool::GetNAcquired() const {
+  return mNAcquired;
+}
+
+inline std::size_t ParticlePool::GetCapacity() const {
+  return mParticles.size();
+}
+
+}  // namespace Smear
+
+#endif  // INCLUDE_EICSMEAR_SMEAR_PARTICLEPOOL_H_
@@ -47,6 +47,17 @@ class Smearer : public TObject {
    */
   virtual void Smear(const erhic::VirtualParticle&, ParticleMCS&) = 0;
 
+  /**
+   As Smear(), for a particle already known to be in the acceptance,
+   so a smearer may skip testing it again.
+   Smearing the same particle several times, as for replicas, gives
+   independent random values each time.
+   */
+  virtual void SmearAccepted(const erhic::VirtualParticle& particle,
+                             ParticleMCS& smeared) {
+    Smear(particle, smeared);
+  }
+
   Acceptance Accept;
 
   ClassDef(Smear::Smearer, 1)
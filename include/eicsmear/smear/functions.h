@@ -10,9 +10,14 @@
 #ifndef INCLUDE_EICSMEAR_SMEAR_FUNCTIONS_H_
 #define INCLUDE_EICSMEAR_SMEAR_FUNCTIONS_H_
 
+#include <vector>
+
 #include <Rtypes.h>  // For Long64_t
 #include <TString.h>
 
+#include "eicsmear/erhic/InputPolicy.h"
+#include "eicsmear/erhic/OutputPolicy.h"
+
 namespace Smear {
 
   class Detector;
@@ -23,8 +28,96 @@ namespace Smear {
  \fn
  Processes a ROOT Monte Carlo event file to produce a file with 
  information smeared for detector effects.
+ Several files, separated by whitespace or commas and/or given by
+ wildcards, e.g. "ep_*.root", are chained into one output file.
+ The output policy sets the compression, basket size etc. of the output.
+ The input policy sets the read cache, parallel unzipping and
+ prefetching of the input; the bytes read and cache hit rate
+ are printed at the end.
+ If sparse is true, smeared DIS events store only the detected
+ particles, with the indices of their Monte Carlo tracks, instead of
+ a NULL entry for each undetected track (see Smear::Event::SetSparse()).
+ With nReplicas > 1, each DIS event is smeared that many times in one
+ pass over the input, into the trees "Smeared" and "Smeared_1" to
+ "Smeared_<nReplicas-1>"; the acceptance and resolutions are evaluated
+ once per particle, so only the random throws differ.
+ If the detector scans resolutions (see Smear::Device::SetScan()),
+ each scan point is a replica, all with the same random numbers, so
+ nReplicas may be left at 1.
  */
 int SmearTree(const Smear::Detector&, const TString& inFileName,
-              const TString& outFileName = "", Long64_t nEvents = -1);
+              const TString& outFileName = "", Long64_t nEvents = -1,
+              const erhic::OutputPolicy& = erhic::OutputPolicy(),
+              const erhic::InputPolicy& = erhic::InputPolicy(),
+              bool sparse = false, unsigned nReplicas = 1);
+
+/**
+ \fn
+ Smears DIS events with each of several detectors, e.g. variants of a
+ design, reading and deserializing the input only once.
+ Each detector smears in its own thread, with its own random seed drawn
+ from gRandom, and writes a Smeared tree to the output file of the same
+ index; by default these are named after the first input file, e.g.
+ "ep.smear.0.root", "ep.smear.1.root" etc.
+ The other arguments are as for SmearTree() with one detector.
+ Returns 0 upon success, 1 upon failure.
+ */
+int SmearTree(const std::vector<Smear::Detector>&, const TString& inFileName,
+              const std::vector<TString>& outFileNames = std::vector<TString>(),
+              Long64_t nEvents = -1,
+              const erhic::OutputPolicy& = erhic::OutputPolicy(),
+              const erhic::InputPolicy& = erhic::InputPolicy(),
+              bool sparse = false);
+
+/**
+ \fn
+ Smears each of several ROOT Monte Carlo event files, given as for
+ SmearTree(), to its own output file in outputDirName (by default
+ next to the input), smearing up to nEvents events per file.
+ Up to nJobs files are smeared at once, each in its own process with
+ its own copy of the detector; nJobs = 0 uses one per available core.
+ The processes are forked, so the calling process must have no other
+ threads running; with ROOT's implicit multithreading enabled, the
+ files are smeared one after the other in the calling process.
+ Each file is smeared with its own random seed drawn from gRandom,
+ so the output doesn't depend on nJobs.
+ A summary of the events per second of each file is printed at the end.
+ Each file is read and written with the policies, sparse or not and
+ with the number of replicas, as for SmearTree().
+ Returns the number of files that failed.
+ */
+int SmearTreeShards(const Smear::Detector&, const TString& inFileNames,
+                    const TString& outputDirName = "", Long64_t nEvents = -1,
+                    unsigned nJobs = 1,
+                    const erhic::OutputPolicy& = erhic::OutputPolicy(),
+                    const erhic::InputPolicy& = erhic::InputPolicy(),
+                    bool sparse = false, unsigned nReplicas = 1);
+
+/**
+ \fn
+ Compiles a detector macro, such as those of eicsmeardetectors, into a
+ shared library in the cache directory, for LoadDetector().
+ The function returning the detector is named after the macro file
+ unless given, e.g. "BuildMatrixDetector_0_1".
+ Entries are keyed by a hash of the macro content, the function and
+ the ROOT and eic-smear versions, so a changed macro is compiled again.
+ The cache directory defaults to $EICSMEAR_DETECTOR_CACHE, else
+ ~/.cache/eic-smear/detectors.
+ Returns 0 upon success, 1 upon failure.
+ */
+int CompileDetector(const TString& macro, const TString& function = "",
+                    const TString& cacheDir = "");
+
+/**
+ \fn
+ Returns the detector built by the function in the macro, as for
+ CompileDetector(). If the cache holds the macro compiled with its current
+ content, its library is loaded and called natively, without the
+ interpreter; otherwise the macro is interpreted.
+ The caller owns the detector. Returns NULL upon failure.
+ */
+Smear::Detector* LoadDetector(const TString& macro,
+                              const TString& function = "",
+                              const TString& cacheDir = "");
 
 #endif  // INCLUDE_EICSMEAR_SMEAR_FUNCTIONS_H_
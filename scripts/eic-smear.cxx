@@ -11,6 +11,7 @@
 #include <string>
 
 #include "eicsmear/functions.h"
+#include "eicsmear/smear/functions.h"
 
 R__EXTERN class SmearRint* gSmearRint;
 
@@ -59,6 +60,17 @@ int main(int argc, char** argv)
     if ( a1 == "-v" || a1 == "--version"){      
       return 0;
     }
+    // Compile a detector macro for LoadDetector(), e.g. once before
+    // submitting many batch jobs:
+    //   eic-smear --compile-detector SmearMatrixDetector_0_1.cxx BuildMatrixDetector_0_1
+    if ( a1 == "--compile-detector" ){
+      if ( argc < 3 ){
+        std::cerr << "Usage: eic-smear --compile-detector <macro> [function] [cache directory]" << std::endl;
+        return 1;
+      }
+      return CompileDetector(argv[2], argc > 3 ? argv[3] : "",
+                             argc > 4 ? argv[4] : "");
+    }
   }    
   auto ErrorIgnoreLevel=gErrorIgnoreLevel;
   gErrorIgnoreLevel = kFatal; 
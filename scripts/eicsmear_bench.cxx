@@ -0,0 +1,869 @@
+//
+// eicsmear_bench.cxx
+//
+// Self-timed benchmarks of the build, smear and convert paths, run on
+// synthetic events generated in memory so results do not depend on
+// input files. Each benchmark is repeated until a minimum time has
+// elapsed; results are printed and written as JSON, with the number of
+// allocations (calls to operator new) per operation and the peak
+// resident memory of the process so far.
+// Usage:
+//   eicsmear_bench [--json file] [--filter text] [--min-time seconds]
+//                  [--tracks n] [--events n]
+// --filter runs only benchmarks whose name contains the text.
+// --events sets the length of the smearing loop benchmarks (100000).
+// First checks that slim trees read back to the values of full trees
+// (check/slim), and fails if not.
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <TFile.h>
+#include <TLorentzVector.h>
+#include <TMath.h>
+#include <TRandom.h>
+#include <TRandom3.h>
+#include <TString.h>
+#include <TSystem.h>
+#include <TTree.h>
+
+#include "eicsmear/erhic/EventDEMP.h"
+#include "eicsmear/erhic/EventDjangoh.h"
+#include "eicsmear/erhic/EventDpmjet.h"
+#include "eicsmear/erhic/EventFactory.h"
+#include "eicsmear/erhic/EventGmcTrans.h"
+#include "eicsmear/erhic/EventMilou.h"
+#include "eicsmear/erhic/EventPepsi.h"
+#include "eicsmear/erhic/EventPythia.h"
+#include "eicsmear/erhic/EventRapgap.h"
+#include "eicsmear/erhic/EventSartre.h"
+#include "eicsmear/erhic/EventSimple.h"
+#include "eicsmear/erhic/Kinematics.h"
+#include "eicsmear/erhic/OutputPolicy.h"
+#include "eicsmear/erhic/ParticleMC.h"
+#include "eicsmear/smear/Bremsstrahlung.h"
+#include "eicsmear/smear/Detector.h"
+#include "eicsmear/smear/Device.h"
+#include "eicsmear/smear/EventDisFactory.h"
+#include "eicsmear/smear/EventSmear.h"
+#include "eicsmear/smear/NumSigmaPid.h"
+#include "eicsmear/smear/ParticleID.h"
+#include "eicsmear/smear/ParticleMCS.h"
+#include "eicsmear/smear/PerfectID.h"
+#include "eicsmear/smear/PlanarTracker.h"
+#include "eicsmear/smear/RadialTracker.h"
+
+#include "eicsmear/functions.h"
+
+#ifdef WITH_HEPMC3
+#include "eicsmear/erhic/File.h"
+#endif
+
+// Number of calls to operator new, by this program and the libraries.
+std::atomic<Long64_t> gNAllocations(0);
+
+void* operator new(std::size_t size) {
+  ++gNAllocations;
+  void* memory = std::malloc(size > 0 ? size : 1);
+  if (!memory) {
+    throw std::bad_alloc();
+  }  // if
+  return memory;
+}
+
+void operator delete(void* memory) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+  std::free(memory);
+}
+
+namespace {
+
+// Results are written here so the compiler cannot discard the work.
+volatile double gSink(0.);
+
+// Number of synthetic events in the input streams and trees.
+const int kNEvents = 100;
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince(const Clock::time_point& start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Returns the peak resident memory of the process in kB.
+Long64_t peakResidentKB() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return -1;
+  }  // if
+  return usage.ru_maxrss;  // kB on Linux
+}
+
+struct Result {
+  std::string name;
+  Long64_t operations;
+  double seconds;
+  Long64_t allocations;
+  Long64_t peakKB;
+};
+
+/**
+ Runs and records the benchmarks.
+ */
+class Harness {
+ public:
+  Harness(double minSeconds, const std::string& filter)
+  : mMinSeconds(minSeconds)
+  , mFilter(filter) {
+  }
+
+  // Returns true if the named benchmark should be run.
+  bool Selects(const std::string& name) const {
+    return mFilter.empty() || name.find(mFilter) != std::string::npos;
+  }
+
+  // Times one operation, repeating it in batches of doubling size until
+  // the minimum time has elapsed. The first call is not timed, so lazy
+  // initialisation (formula compilation, dictionary lookup) is excluded.
+  template<typename Operation>
+  void Run(const std::string& name, Operation operation) {
+    if (!Selects(name)) {
+      return;
+    }  // if
+    operation();
+    Long64_t operations(0);
+    Long64_t batch(1);
+    double elapsed(0.);
+    const Long64_t allocations = gNAllocations;
+    const Clock::time_point start = Clock::now();
+    while (elapsed < mMinSeconds) {
+      for (Long64_t i(0); i < batch; ++i) {
+        operation();
+      }  // for
+      operations += batch;
+      batch *= 2;
+      elapsed = secondsSince(start);
+    }  // while
+    Add(name, operations, elapsed, gNAllocations - allocations);
+  }
+
+  // Records a benchmark timed by the caller, with the number of
+  // allocations made by all its operations.
+  void Add(const std::string& name, Long64_t operations, double seconds,
+           Long64_t allocations) {
+    Result result = {name, operations, seconds, allocations,
+                     peakResidentKB()};
+    mResults.push_back(result);
+    std::cout << std::left << std::setw(36) << name << std::right
+              << std::setw(12) << operations << " ops "
+              << std::setw(14) << std::fixed << std::setprecision(1)
+              << NanosecondsPerOperation(result) << " ns/op "
+              << std::setw(10) << AllocationsPerOperation(result)
+              << " allocs/op " << std::setw(10) << result.peakKB
+              << " kB peak" << std::endl;
+  }
+
+  void WriteJson(std::ostream& os, int nTracks) const {
+    os << std::fixed << "{\n"
+       << "  \"tracks\": " << nTracks << ",\n"
+       << "  \"min_time_s\": " << mMinSeconds << ",\n"
+       << "  \"benchmarks\": [";
+    for (unsigned i(0); i < mResults.size(); ++i) {
+      const Result& result = mResults.at(i);
+      os << (i > 0 ? "," : "") << "\n    {\"name\": \"" << result.name
+         << "\", \"operations\": " << result.operations
+         << ", \"seconds\": " << std::setprecision(6) << result.seconds
+         << ", \"ns_per_op\": " << std::setprecision(1)
+         << NanosecondsPerOperation(result)
+         << ", \"allocs_per_op\": " << AllocationsPerOperation(result)
+         << ", \"peak_rss_kb\": " << result.peakKB << "}";
+    }  // for
+    os << "\n  ]\n}" << std::endl;
+  }
+
+ private:
+  static double NanosecondsPerOperation(const Result& result) {
+    if (result.operations < 1) {
+      return 0.;
+    }  // if
+    return 1.e9 * result.seconds / result.operations;
+  }
+
+  static double AllocationsPerOperation(const Result& result) {
+    if (result.operations < 1) {
+      return 0.;
+    }  // if
+    return double(result.allocations) / result.operations;
+  }
+
+  double mMinSeconds;
+  std::string mFilter;
+  std::vector<Result> mResults;
+};
+
+//
+// Synthetic input
+//
+
+// Returns a particle line in the plain-text format of the generators.
+// eA (BeAGLE) lines carry a second parent and three nuclear fields.
+std::string particleLine(int index, int status, int id, int parent,
+                         const TLorentzVector& p, bool eA) {
+  std::ostringstream os;
+  os << index << ' ' << status << ' ' << id << ' ';
+  if (eA) {
+    os << "0 ";
+  }  // if
+  os << parent << " 0 0 " << p.Px() << ' ' << p.Py() << ' ' << p.Pz()
+     << ' ' << p.E() << ' ' << p.M() << " 0 0 0";
+  if (eA) {
+    os << " 0 0 0";
+  }  // if
+  return os.str();
+}
+
+// Returns the particle lines of a DIS event in the PYTHIA layout:
+// beams, incoming lepton, exchange boson and scattered lepton (parent 3),
+// followed by nTracks final-state pions.
+std::vector<std::string> particleLines(int nTracks, bool eA,
+                                       TRandom& random) {
+  TLorentzVector lepton, hadron, scattered, pion;
+  lepton.SetXYZM(0., 0., -18., 0.000511);
+  hadron.SetXYZM(0., 0., 275., 0.938272);
+  scattered.SetXYZM(1.5, 0.5, -16.5, 0.000511);
+  std::vector<std::string> lines;
+  lines.push_back(particleLine(1, 21, 11, 0, lepton, eA));
+  lines.push_back(particleLine(2, 21, 2212, 0, hadron, eA));
+  lines.push_back(particleLine(3, 21, 11, 1, lepton, eA));
+  lines.push_back(particleLine(4, 21, 22, 1, lepton - scattered, eA));
+  lines.push_back(particleLine(5, 1, 11, 3, scattered, eA));
+  for (int i(0); i < nTracks; ++i) {
+    pion.SetPtEtaPhiM(random.Exp(0.5), random.Uniform(-4., 4.),
+                      random.Uniform(0., 6.283), 0.13957);
+    lines.push_back(particleLine(i + 6, 1, 211, 2, pion, eA));
+  }  // for
+  return lines;
+}
+
+// Returns an event header line. No generator reads more than a few dozen
+// values from it, and 1 is an acceptable value for all of them.
+std::string headerLine() {
+  std::string line("0");
+  for (int i(0); i < 100; ++i) {
+    line.append(" 1");
+  }  // for
+  return line;
+}
+
+// Returns nEvents events as they appear in a generator output file.
+std::string asciiEvents(int nEvents, int nTracks, bool eA) {
+  TRandom3 random(42);
+  std::string text;
+  for (int i(0); i < nEvents; ++i) {
+    text.append(headerLine()).append("\n");
+    text.append(" ============================================\n");
+    const std::vector<std::string> lines = particleLines(nTracks, eA, random);
+    for (unsigned j(0); j < lines.size(); ++j) {
+      text.append(lines.at(j)).append("\n");
+    }  // for
+    text.append(" =============== Event finished ===============\n");
+  }  // for
+  return text;
+}
+
+// A PID response depending only on momentum, standing in for the
+// detector models that are normally plugged into NumSigmaPid.
+class MomentumPid : public PID {
+ public:
+  bool valid(double eta, double p) { return std::fabs(eta) < 3.5 && p > 0.1; }
+  double numSigma(double, double p, PID::type) { return 10. / p; }
+  double maxP(double, double numSigma, PID::type) { return 10. / numSigma; }
+  double minP(double, double, PID::type) { return 0.1; }
+  std::string name() { return "MomentumPid"; }
+  void description() { }
+};
+
+class MomentumNumSigmaPid : public Smear::NumSigmaPid {
+ public:
+  MomentumNumSigmaPid() {
+    ThePidObject = std::make_shared<MomentumPid>();
+    SetNumSigmaType(0);
+  }
+};
+
+// Writes a one-bin misidentification matrix for ParticleID, in the format
+// of data/PIDMatrix.dat, and returns the file name.
+TString writePidMatrix() {
+  const TString name = TString(gSystem->TempDirectory())
+                       + "/eicsmear_bench_pid.dat";
+  std::ofstream file(name.Data());
+  file << "!T 211 321 2212\n"
+       << "!F 211 321 2212 0\n"
+       << "!P 1\n"
+       << "1 1 0.1 100. 1 0.90 0.05 0.03\n"
+       << "1 1 0.1 100. 2 0.05 0.90 0.05\n"
+       << "1 1 0.1 100. 3 0.03 0.03 0.90\n"
+       << "1 1 0.1 100. 4 0.02 0.02 0.02\n";
+  return name;
+}
+
+// A detector in the style of the bundled detector scripts: tracking,
+// electromagnetic and hadronic calorimetry, angles and particle ID.
+Smear::Detector canonicalDetector() {
+  Smear::RadialTracker tracker;
+  Smear::Device emCal(Smear::kE, "0.12 * sqrt(E) + 0.02 * E",
+                      Smear::kElectromagnetic);
+  Smear::Device hCal(Smear::kE, "0.5 * sqrt(E) + 0.1 * E",
+                     Smear::kHadronic);
+  Smear::Device theta(Smear::kTheta, "0.001");
+  Smear::Device phi(Smear::kPhi, "0.001");
+  Smear::PerfectID pid;
+  Smear::Detector detector;
+  detector.AddDevice(tracker);
+  detector.AddDevice(emCal);
+  detector.AddDevice(hCal);
+  detector.AddDevice(theta);
+  detector.AddDevice(phi);
+  detector.AddDevice(pid);
+  detector.SetEventKinematicsCalculator("NM JB DA");
+  return detector;
+}
+
+// Returns a detector of 60 devices, as for a calorimeter and tracker
+// segmented in polar angle, each with its own resolution formula.
+// The offset makes the formulas differ from one call to the next.
+Smear::Detector segmentedDetector(double offset) {
+  Smear::Detector detector;
+  const int nSegments(20);
+  for (int i(0); i < nSegments; ++i) {
+    const double thetaMin = i * TMath::Pi() / nSegments;
+    const Smear::Acceptance::Zone zone(thetaMin,
+                                       thetaMin + TMath::Pi() / nSegments);
+    const double scale = 1. + 0.01 * i + offset;
+    Smear::Device emCal(Smear::kE,
+                        TString::Format("%g * sqrt(E) + 0.02 * E", 0.1 * scale),
+                        Smear::kElectromagnetic);
+    Smear::Device hCal(Smear::kE,
+                       TString::Format("%g * sqrt(E) + 0.1 * E", 0.5 * scale),
+                       Smear::kHadronic);
+    Smear::Device momentum(Smear::kP,
+                           TString::Format("%g * P * P + 0.005 * P",
+                                           0.001 * scale));
+    emCal.Accept.AddZone(zone);
+    hCal.Accept.AddZone(zone);
+    momentum.Accept.AddZone(zone);
+    detector.AddDevice(emCal);
+    detector.AddDevice(hCal);
+    detector.AddDevice(momentum);
+  }  // for
+  return detector;
+}
+
+// Returns a tree of kNEvents copies of the event, as written by BuildTree.
+template<typename T>
+TTree* makeTree(T& event) {
+  TTree* tree = new TTree("EICTree", "benchmark events");
+  T* buffer = &event;
+  tree->Branch("event", &buffer, 32000, 99);
+  for (int i(0); i < kNEvents; ++i) {
+    tree->Fill();
+  }  // for
+  tree->ResetBranchAddresses();
+  return tree;
+}
+
+//
+// Benchmarks
+//
+
+// Header and particle-line parsing, and complete event building with
+// EventFromAsciiFactory<T>::Create, for one generator.
+template<typename T>
+void benchGenerator(Harness& harness, const std::string& generator,
+                    int nTracks) {
+  try {
+    T event;
+    const bool eA = event.RequiresEaParticleFields();
+    const std::string header = headerLine();
+    TRandom3 random(42);
+    const std::vector<std::string> lines = particleLines(nTracks, eA, random);
+    harness.Run("parse/" + generator + "/header", [&]() {
+      gSink = event.Parse(header);
+    });
+    unsigned n(0);
+    harness.Run("parse/" + generator + "/particle", [&]() {
+      erhic::ParticleMC particle(lines[n++ % lines.size()], eA);
+      gSink = particle.GetE();
+    });
+    std::istringstream input(asciiEvents(kNEvents, nTracks, eA));
+    erhic::EventFromAsciiFactory<T> factory(input);
+    harness.Run("create/" + generator, [&]() {
+      std::unique_ptr<T> created(factory.Create());
+      if (!created) {
+        // Reached the end of the events: start again from the beginning.
+        input.clear();
+        input.seekg(0);
+        created.reset(factory.Create());
+      }  // if
+      gSink = created ? created->GetNTracks() : 0;
+    });
+  }
+  catch(std::exception& error) {
+    std::cerr << "Error in " << generator << " benchmarks: "
+              << error.what() << std::endl;
+  }  // try
+}
+
+// One smearer applied to the final-state particles of an event in turn.
+void benchSmearer(Harness& harness, const std::string& name,
+                  Smear::Smearer& smearer,
+                  const std::vector<const erhic::ParticleMC*>& particles) {
+  unsigned n(0);
+  harness.Run("smearer/" + name, [&]() {
+    const erhic::ParticleMC& truth = *particles[n++ % particles.size()];
+    Smear::ParticleMCS smeared(truth.Get4Vector(), truth.Id(),
+                               truth.GetStatus());
+    smearer.Smear(truth, smeared);
+    gSink = smeared.GetE();
+  });
+}
+
+void benchSmearers(Harness& harness, const erhic::EventPythia& event) {
+  std::vector<const erhic::ParticleMC*> particles;
+  for (const erhic::ParticleMC* particle : event.FinalStateParticles()) {
+    particles.push_back(particle);
+  }  // for
+  // Constructing the smeared particle alone, for reference.
+  unsigned n(0);
+  harness.Run("smearer/baseline", [&]() {
+    const erhic::ParticleMC& truth = *particles[n++ % particles.size()];
+    Smear::ParticleMCS smeared(truth.Get4Vector(), truth.Id(),
+                               truth.GetStatus());
+    gSink = smeared.GetE();
+  });
+  Smear::Device device(Smear::kE, "0.1 * sqrt(E)");
+  benchSmearer(harness, "Device", device, particles);
+  Smear::RadialTracker radial;
+  benchSmearer(harness, "RadialTracker", radial, particles);
+  Smear::PlanarTracker planar;
+  benchSmearer(harness, "PlanarTracker", planar, particles);
+  const TString pidMatrix = writePidMatrix();
+  Smear::ParticleID particleId(pidMatrix);
+  gSystem->Unlink(pidMatrix);
+  benchSmearer(harness, "ParticleID", particleId, particles);
+  Smear::PerfectID perfectId;
+  benchSmearer(harness, "PerfectID", perfectId, particles);
+  Smear::Bremsstrahlung bremsstrahlung;
+  benchSmearer(harness, "Bremsstrahlung", bremsstrahlung, particles);
+  MomentumNumSigmaPid numSigmaPid;
+  benchSmearer(harness, "NumSigmaPid", numSigmaPid, particles);
+}
+
+// Detector startup: building a 60-device detector the first time its
+// formulas are seen, building it again and copying it, as done for
+// each smearing factory or thread.
+void benchStartup(Harness& harness) {
+  if (harness.Selects("detector/startup-cold")) {
+    const Long64_t allocations = gNAllocations;
+    const Clock::time_point start = Clock::now();
+    const Smear::Detector detector = segmentedDetector(0.5);
+    harness.Add("detector/startup-cold", 1, secondsSince(start),
+                gNAllocations - allocations);
+    gSink = detector.GetNDevices();
+  }  // if
+  harness.Run("detector/startup", [&]() {
+    const Smear::Detector detector = segmentedDetector(0.);
+    gSink = detector.GetNDevices();
+  });
+  const Smear::Detector detector = segmentedDetector(0.);
+  harness.Run("detector/copy", [&]() {
+    const Smear::Detector copy(detector);
+    gSink = copy.GetNDevices();
+  });
+}
+
+void benchDetector(Harness& harness, erhic::EventPythia& event) {
+  const Smear::Detector detector = canonicalDetector();
+  unsigned n(0);
+  harness.Run("detector/particle", [&]() {
+    const erhic::VirtualParticle* truth =
+      event.GetTrack(n++ % event.GetNTracks());
+    std::unique_ptr<Smear::ParticleMCS> smeared(detector.Smear(*truth));
+    gSink = smeared ? smeared->GetE() : 0.;
+  });
+  // Whole events, as smeared by SmearTree, including reading the tree.
+  std::unique_ptr<TTree> tree(makeTree(event));
+  Smear::EventDisFactory factory(detector, *tree);
+  Long64_t entry(0);
+  harness.Run("detector/event", [&]() {
+    tree->GetEntry(entry++ % tree->GetEntries());
+    std::unique_ptr<Smear::Event> smeared(factory.Create());
+    gSink = smeared->GetNTracks();
+  });
+  tree->ResetBranchAddresses();
+}
+
+// Whole eA events smeared with the scattered lepton index stored, as
+// written by BuildTree, and without it, as read from older files, for
+// which the event record is searched whenever the scattered lepton is
+// needed. The events have nTracks final-state particles, which for
+// BeAGLE e+Au events, with their nuclear remnants, is of order 1000.
+void benchScattered(Harness& harness, int nTracks) {
+  if (!harness.Selects("build/scattered") &&
+      !harness.Selects("build/scattered-search")) {
+    return;
+  }  // if
+  std::istringstream input(asciiEvents(1, nTracks, true));
+  erhic::EventFromAsciiFactory<erhic::EventBeagle> factory(input);
+  std::unique_ptr<erhic::EventBeagle> event(factory.Create());
+  if (!event) {
+    std::cerr << "Error: failed to build the eA benchmark event" << std::endl;
+    return;
+  }  // if
+  // Adding the tracks again leaves the index unresolved
+  erhic::EventBeagle unresolved;
+  for (unsigned i(0); i < event->GetNTracks(); ++i) {
+    unresolved.AddLast(event->GetTrack(i));
+  }  // for
+  const Smear::Detector detector = canonicalDetector();
+  struct Case {
+    const char* name;
+    erhic::EventBeagle* event;
+  };
+  const Case cases[] = {
+    {"build/scattered", event.get()},
+    {"build/scattered-search", &unresolved}
+  };
+  for (const Case& test : cases) {
+    std::unique_ptr<TTree> tree(makeTree(*test.event));
+    Smear::EventDisFactory smearer(detector, *tree);
+    Long64_t entry(0);
+    harness.Run(test.name, [&]() {
+      tree->GetEntry(entry++ % tree->GetEntries());
+      std::unique_ptr<Smear::Event> smeared(smearer.Create());
+      gSink = smeared->GetNTracks();
+    });
+    tree->ResetBranchAddresses();
+  }  // for
+}
+
+// The SmearTree loop, reading a tree and filling a tree of smeared events
+// in a file, with a new event and particles for each event and with
+// one event and a pool of particles reused for all events, and with
+// several replicas of each event smeared at once.
+// Run once over nEvents events each, so the peak memory and
+// allocations reflect a long run.
+void benchSmearLoop(Harness& harness, erhic::EventPythia& event,
+                    Long64_t nEvents) {
+  const Smear::Detector detector = canonicalDetector();
+  std::unique_ptr<TTree> input(makeTree(event));
+  const TString fileName =
+    TString(gSystem->TempDirectory()) + "/eicsmear_bench.smear.root";
+  struct Mode {
+    const char* name;
+    bool recycle;
+    bool sparse;
+    unsigned replicas;
+  };
+  const Mode modes[] = {
+    {"smear/loop-new", false, false, 1},
+    {"smear/loop-recycled", true, false, 1},
+    {"smear/loop-sparse", true, true, 1},
+    {"smear/loop-replicas", true, false, 10}
+  };
+  const erhic::OutputPolicy policy;
+  for (const Mode& mode : modes) {
+    const std::string name(mode.name);
+    if (!harness.Selects(name)) {
+      continue;
+    }  // if
+    TFile file(fileName, "recreate");
+    TTree* output = new TTree("Smeared", "benchmark smeared events");
+    Smear::EventDisFactory factory(detector, *input);
+    factory.SetRecycling(mode.recycle);
+    factory.SetSparse(mode.sparse);
+    // Each replica in its own tree, as written by SmearTree
+    std::vector<TTree*> trees(1, output);
+    for (unsigned k(1); k < mode.replicas; ++k) {
+      trees.push_back(new TTree(TString::Format("Smeared_%u", k),
+                                "benchmark smeared events"));
+    }  // for
+    std::vector<TBranch*> branches;
+    if (mode.replicas > 1) {
+      branches = factory.BranchReplicas(trees, "eventS", policy);
+    } else {
+      branches.push_back(factory.Branch(*output, "eventS", policy));
+    }  // if
+    TBranch* branch = branches.front();
+    const Long64_t allocations = gNAllocations;
+    const Clock::time_point start = Clock::now();
+    for (Long64_t i(0); i < nEvents; ++i) {
+      input->GetEntry(i % input->GetEntries());
+      if (mode.replicas > 1) {
+        factory.FillReplicas(branches);
+      } else {
+        factory.Fill(*branch);
+      }  // if
+    }  // for
+    // Per smeared event, so replicas compare with single smearing
+    harness.Add(name, nEvents * mode.replicas, secondsSince(start),
+                gNAllocations - allocations);
+    file.Write();
+    for (unsigned k(0); k < branches.size(); ++k) {
+      branches.at(k)->ResetAddress();
+    }  // for
+    input->ResetBranchAddresses();
+  }  // for
+  gSystem->Unlink(fileName);
+}
+
+void benchKinematics(Harness& harness, const erhic::EventPythia& event) {
+  harness.Run("kinematics/LeptonKinematics", [&]() {
+    std::unique_ptr<erhic::DisKinematics> kinematics(
+      erhic::LeptonKinematicsComputer(event).Calculate());
+    gSink = kinematics.get() != NULL;
+  });
+  harness.Run("kinematics/JacquetBlondel", [&]() {
+    std::unique_ptr<erhic::DisKinematics> kinematics(
+      erhic::JacquetBlondelComputer(event).Calculate());
+    gSink = kinematics.get() != NULL;
+  });
+  harness.Run("kinematics/DoubleAngle", [&]() {
+    std::unique_ptr<erhic::DisKinematics> kinematics(
+      erhic::DoubleAngleComputer(event).Calculate());
+    gSink = kinematics.get() != NULL;
+  });
+}
+
+#ifdef WITH_HEPMC3
+// Conversion of a tree to HepMC3 with TreeToHepMC, then ingestion of
+// the HepMC3 output. Both run once over kNEvents events, as the HepMC3
+// reader cannot be rewound.
+void benchHepMC(Harness& harness, erhic::EventPythia& event) {
+  if (!harness.Selects("convert/TreeToHepMC") &&
+      !harness.Selects("create/HepMC")) {
+    return;
+  }  // if
+  const TString directory = gSystem->TempDirectory();
+  const TString rootName = directory + "/eicsmear_bench.root";
+  const TString hepmcName = directory + "/eicsmear_bench.hepmc";
+  {
+    TFile file(rootName, "recreate");
+    std::unique_ptr<TTree> tree(makeTree(event));
+    tree->SetDirectory(&file);
+    tree->Write();
+    tree->SetDirectory(NULL);
+  }
+  Long64_t allocations = gNAllocations;
+  Clock::time_point start = Clock::now();
+  const Long64_t nConverted = TreeToHepMC(rootName.Data(), directory.Data());
+  harness.Add("convert/TreeToHepMC", nConverted, secondsSince(start),
+              gNAllocations - allocations);
+  gSystem->Unlink(rootName);
+
+  std::ifstream hepmcFile(hepmcName.Data());
+  std::stringstream input;
+  input << hepmcFile.rdbuf();
+  hepmcFile.close();
+  gSystem->Unlink(hepmcName);
+  std::unique_ptr<erhic::VirtualEventFactory> factory(
+    erhic::File<erhic::EventHepMC>().CreateEventFactory(input));
+  Long64_t nCreated(0);
+  allocations = gNAllocations;
+  start = Clock::now();
+  while (true) {
+    std::unique_ptr<erhic::VirtualEvent> created(factory->Create());
+    if (!created) {
+      break;
+    }  // if
+    ++nCreated;
+  }  // while
+  harness.Add("create/HepMC", nCreated, secondsSince(start),
+              gNAllocations - allocations);
+}
+#endif
+
+//
+// Checks
+//
+
+// Returns true if the values agree to the precision they are stored with.
+bool agree(double a, double b) {
+  return std::fabs(a - b) <= 1.e-4 * std::max(1., std::fabs(a));
+}
+
+// Builds a full and a slim tree from the same generator file, reads both
+// back with TTree::GetEntry(), computing the quantities of slim events as
+// documented, and checks that the final-state particles agree in the
+// quantities slim trees don't store. Returns false if any differs.
+bool checkSlim(int nTracks) {
+  const TString directory =
+    TString(gSystem->TempDirectory()) + "/eicsmear_bench_slim";
+  const TString textName = directory + "/events.txt";
+  gSystem->mkdir(directory + "/full", kTRUE);
+  gSystem->mkdir(directory + "/slim", kTRUE);
+  {
+    std::ofstream text(textName.Data());
+    text << "PYTHIA EVENT FILE" << std::endl;
+    for (int i(0); i < 5; ++i) {
+      text << " ============================================" << std::endl;
+    }  // for
+    text << asciiEvents(kNEvents, nTracks, false);
+  }
+  BuildTree(textName.Data(), (directory + "/full").Data(), 0, "",
+            erhic::OutputPolicy(), NULL, false);
+  BuildTree(textName.Data(), (directory + "/slim").Data(), 0, "",
+            erhic::OutputPolicy(), NULL, true);
+  bool same(false);
+  {
+    TFile fullFile(directory + "/full/events.root");
+    TFile slimFile(directory + "/slim/events.root");
+    TTree* fullTree(NULL);
+    TTree* slimTree(NULL);
+    fullFile.GetObject("EICTree", fullTree);
+    slimFile.GetObject("EICTree", slimTree);
+    if (fullTree && slimTree && fullTree->GetEntries() > 0 &&
+        fullTree->GetEntries() == slimTree->GetEntries()) {
+      erhic::EventPythia* full(NULL);
+      erhic::EventPythia* slim(NULL);
+      fullTree->SetBranchAddress("event", &full);
+      slimTree->SetBranchAddress("event", &slim);
+      same = true;
+      for (Long64_t i(0); same && i < fullTree->GetEntries(); ++i) {
+        fullTree->GetEntry(i);
+        slimTree->GetEntry(i);
+        same = slim->IsSlim();
+        slim->ComputeDerivedQuantities();
+        // Slim events keep the final-state particles in the same order
+        unsigned k(0);
+        for (unsigned j(0); same && j < full->GetNTracks(); ++j) {
+          const erhic::ParticleMC* truth = full->GetTrack(j);
+          if (truth->GetStatus() != 1) {
+            continue;
+          }  // if
+          while (k < slim->GetNTracks() &&
+                 slim->GetTrack(k)->GetStatus() != 1) {
+            ++k;
+          }  // while
+          const erhic::ParticleMC* read =
+            (k < slim->GetNTracks() ? slim->GetTrack(k++) : NULL);
+          same = read && agree(truth->GetEta(), read->GetEta()) &&
+                 agree(truth->GetZ(), read->GetZ()) &&
+                 agree(truth->GetXFeynman(), read->GetXFeynman());
+        }  // for
+      }  // for
+      fullTree->ResetBranchAddresses();
+      slimTree->ResetBranchAddresses();
+      delete full;
+      delete slim;
+    }  // if
+  }
+  gSystem->Unlink(textName);
+  gSystem->Unlink(directory + "/full/events.root");
+  gSystem->Unlink(directory + "/slim/events.root");
+  gSystem->Unlink(directory + "/full");
+  gSystem->Unlink(directory + "/slim");
+  gSystem->Unlink(directory);
+  std::cout << "check/slim: " << (same ? "passed" : "FAILED") << std::endl;
+  return same;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char* argv[]) {
+  std::string jsonName("eicsmear_bench.json");
+  std::string filter;
+  double minSeconds(0.5);
+  int nTracks(50);
+  int nEaTracks(1000);
+  Long64_t nEvents(100000);
+  for (int i(1); i < argc; ++i) {
+    const std::string argument(argv[i]);
+    if ("--json" == argument && i + 1 < argc) {
+      jsonName = argv[++i];
+    } else if ("--filter" == argument && i + 1 < argc) {
+      filter = argv[++i];
+    } else if ("--min-time" == argument && i + 1 < argc) {
+      minSeconds = std::atof(argv[++i]);
+    } else if ("--tracks" == argument && i + 1 < argc) {
+      nTracks = std::atoi(argv[++i]);
+    } else if ("--ea-tracks" == argument && i + 1 < argc) {
+      nEaTracks = std::atoi(argv[++i]);
+    } else if ("--events" == argument && i + 1 < argc) {
+      nEvents = std::atoll(argv[++i]);
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--json file] [--filter text]"
+                << " [--min-time seconds] [--tracks n] [--ea-tracks n]"
+                << " [--events n]"
+                << std::endl;
+      return 1;
+    }  // if
+  }  // for
+  if (nTracks < 1 || nEaTracks < 1) {
+    std::cerr << "Error: --tracks and --ea-tracks must be at least 1"
+              << std::endl;
+    return 1;
+  }  // if
+  gRandom->SetSeed(42);
+  Harness harness(minSeconds, filter);
+
+  if (harness.Selects("check/slim") && !checkSlim(nTracks)) {
+    return 1;
+  }  // if
+
+  benchGenerator<erhic::EventPythia>(harness, "Pythia", nTracks);
+  benchGenerator<erhic::EventBeagle>(harness, "Beagle", nTracks);
+  benchGenerator<erhic::EventDjangoh>(harness, "Djangoh", nTracks);
+  benchGenerator<erhic::EventDpmjet>(harness, "Dpmjet", nTracks);
+  benchGenerator<erhic::EventMilou>(harness, "Milou", nTracks);
+  benchGenerator<erhic::EventPepsi>(harness, "Pepsi", nTracks);
+  benchGenerator<erhic::EventRapgap>(harness, "Rapgap", nTracks);
+  benchGenerator<erhic::EventGmcTrans>(harness, "GmcTrans", nTracks);
+  benchGenerator<erhic::EventSimple>(harness, "Simple", nTracks);
+  benchGenerator<erhic::EventDEMP>(harness, "DEMP", nTracks);
+  benchGenerator<erhic::EventSartre>(harness, "Sartre", nTracks);
+
+  // The smearing and conversion benchmarks share one built event.
+  std::istringstream input(asciiEvents(1, nTracks, false));
+  erhic::EventFromAsciiFactory<erhic::EventPythia> factory(input);
+  std::unique_ptr<erhic::EventPythia> event(factory.Create());
+  if (!event) {
+    std::cerr << "Error: failed to build the benchmark event" << std::endl;
+    return 1;
+  }  // if
+  benchStartup(harness);
+  benchSmearers(harness, *event);
+  benchDetector(harness, *event);
+  benchScattered(harness, nEaTracks);
+  benchSmearLoop(harness, *event, nEvents);
+  benchKinematics(harness, *event);
+#ifdef WITH_HEPMC3
+  benchHepMC(harness, *event);
+#endif
+
+  std::ofstream json(jsonName.c_str());
+  if (!json.good()) {
+    std::cerr << "Error: unable to open " << jsonName << std::endl;
+    return 1;
+  }  // if
+  harness.WriteJson(json, nTracks);
+  std::cout << "Wrote " << jsonName << std::endl;
+  return 0;
+}
@@ -14,23 +14,26 @@
 
 #include "eicsmear/erhic/Forester.h"
 #include "eicsmear/erhic/File.h"
+#include "eicsmear/erhic/OutputPolicy.h"
 
 /**
  This is an example function to generate ROOT files.
  It can be used "out of the box".
  If more control over the output is desired, then the settings of the
  Forester can be tweaked to do so.
+ The policy sets the compression, basket size and maximum size of the
+ output tree; by default a new file is started every 10 GB.
+ Only events accepted by the filter, if there is one, are written.
+ Slim trees omit intermediate particles and derived particle quantities.
  */
 Long64_t
 BuildTree(const std::string& inputFileName,
           const std::string& outputDirName,
           const Long64_t maxEvent,
-          const std::string& logFileName) {
-  // Set the maximum size of the tree on disk.
-  // Once this size is reached a new file is opened for continued writing.
-  // Set 10 Gb. Us LL to force long integer.
-  TTree::SetMaxTreeSize(10LL * 1024LL * 1024LL * 1024LL);
-
+          const std::string& logFileName,
+          const erhic::OutputPolicy& policy,
+          const erhic::EventMCFilterABC* filter,
+          bool slim) {
   // Get the input file name, stripping any leading directory path via
   // use of the BaseName() method from TSystem.
   TString outName = gSystem->BaseName(inputFileName.c_str());
@@ -69,6 +72,14 @@ BuildTree(const std::string& inputFileName,
   forester.SetMessageInterval(10000);
   forester.SetBeVerbose(true);
   forester.SetBranchName("event");
+  // Start a new file every 10 GB unless the policy says otherwise
+  erhic::OutputPolicy treePolicy(policy);
+  if (treePolicy.GetMaxTreeSize() <= 0) {
+    treePolicy.SetMaxTreeSize(10LL * 1024LL * 1024LL * 1024LL);
+  }  // if
+  forester.SetOutputPolicy(treePolicy);
+  forester.SetFilter(filter);
+  forester.SetSlim(slim);
 
   Long64_t result = forester.Plant();  // Plant that tree!
   if (result != 0) {
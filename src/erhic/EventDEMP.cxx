@@ -34,7 +34,7 @@ bool EventDEMP::Parse(const std::string& line) {
 // This is the first (only?) particle that matches the following:
 //  1) pdg code equals that of incident lepton beam.
 //  2) status code is 1 i.e. it's a stable/final-state particle.
-const ParticleMC* EventDEMP::ScatteredLepton() const {
+const ParticleMC* EventDEMP::FindScatteredLepton() const {
   // Look for the lepton beam to get the species.
   // If we don't get it we can't find the scattered
   // lepton so return NULL.
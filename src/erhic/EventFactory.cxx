@@ -9,6 +9,8 @@
 
 #include "eicsmear/erhic/EventFactory.h"
 
+#include <chrono>
+#include <limits>
 #include <memory>
 #include <stdexcept>
 #include <string>
@@ -27,6 +29,7 @@
 #include "eicsmear/erhic/EventGmcTrans.h"
 #include "eicsmear/erhic/EventSimple.h"
 #include "eicsmear/erhic/EventDEMP.h"
+#include "eicsmear/erhic/EventMCFilterABC.h"
 #include "eicsmear/erhic/EventSartre.h"
 #include "eicsmear/functions.h"  // For getFirstNonBlank()
 #include "eicsmear/erhic/Kinematics.h"
@@ -70,9 +73,7 @@ namespace erhic {
   };
 
   template<typename T>
-  T* EventFromAsciiFactory<T>::Create() {
-    // Save current object count. Will reset it when this function returns.
-    TProcessIdObjectCount objectCount;
+  void EventFromAsciiFactory<T>::NewEvent() {
     mEvent.reset(new T);
     const auto version = mAdditionalInformation.find("sartreVersion");
     if (version != mAdditionalInformation.end() && version->second == "2") {
@@ -80,6 +81,44 @@ namespace erhic {
         event->SetSartreVersion(2);
       }  // if
     }  // if
+  }
+
+  template<typename T>
+  bool EventFromAsciiFactory<T>::SkipEvent() {
+    // Particle lines start with a digit, the marker with '='.
+    // Only lines starting with '=' are read in full.
+    while (mInput->good()) {
+      *mInput >> std::ws;  // Skip leading blanks and empty lines
+      if (mInput->peek() == '=') {
+        if (!std::getline(*mInput, mLine).good()) {
+          return false;
+        }  // if
+        if (AtEndOfEvent()) {
+          return true;
+        }  // if
+      } else {
+        mInput->ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+      }  // if
+    }  // while
+    return false;
+  }
+
+  template<typename T>
+  bool EventFromAsciiFactory<T>::SetFilter(const EventMCFilterABC* filter) {
+    mFilter = filter;
+    return true;
+  }
+
+  template<typename T>
+  Long64_t EventFromAsciiFactory<T>::GetNRejected() const {
+    return mNRejected;
+  }
+
+  template<typename T>
+  T* EventFromAsciiFactory<T>::Create() {
+    // Save current object count. Will reset it when this function returns.
+    TProcessIdObjectCount objectCount;
+    NewEvent();
     // We use this flag to check input doesn't end mid-event.
     // Initialised finished flag to "success" in case of no input.
     int finished(0);
@@ -93,7 +132,16 @@ namespace erhic {
 	if (!error.empty()) {
 	  throw std::runtime_error(error);
 	} else {
+	  const auto start = std::chrono::steady_clock::now();
 	  finished = FinishEvent();  // 0 upon success
+	  mFinishEventSeconds += std::chrono::duration<double>(
+	    std::chrono::steady_clock::now() - start).count();
+	  if (finished == 0 && mFilter && !mFilter->Accept(*mEvent)) {
+	    // Rejected after building; start again with the next event
+	    ++mNRejected;
+	    NewEvent();
+	    continue;
+	  }  // if
 	  break;
 	}  // if
       } else if ('0' == getFirstNonBlank(mLine)) {
@@ -107,6 +155,15 @@ namespace erhic {
 	  // lines until the end-of-event marker. That way we stay
 	  // "aligned" with the input data ready for the next event.
 	  error = "Bad event input: " + mLine;
+	} else if (mFilter && !mFilter->AcceptHeader(*mEvent)) {
+	  // Rejected on the header alone: skip the particles unparsed
+	  // and start again with the next event.
+	  ++mNRejected;
+	  if (!SkipEvent()) {
+	    break;  // Ended mid-event
+	  }  // if
+	  finished = 0;
+	  NewEvent();
 	}  // if
       } else if ('=' != getFirstNonBlank(mLine)) {
 	// Anything remaining other than a line of '=' is a particle line
@@ -136,6 +193,9 @@ namespace erhic {
 
   template<typename T>
   Int_t EventFromAsciiFactory<T>::FinishEvent() {
+    // Locate the scattered lepton once, rather than every time
+    // the kinematics of a particle need it.
+    mEvent->ResolveScatteredLepton();
     // First, find the beams, exchange boson, scattered lepton.
     // if this isn't a DIS event, skip Kinematics computation    
     BeamParticles beams;
@@ -151,8 +211,10 @@ namespace erhic {
     if (nm.get()) {
       mEvent->SetLeptonKinematics(*nm);
     }  // if
+    // The frames are the same for all particles, so only compute them once
+    const EventFrames frames(*mEvent);
     for (unsigned n(0); n < mEvent->GetNTracks(); ++n) {
-      mEvent->GetTrack(n)->ComputeEventDependentQuantities(*mEvent);
+      mEvent->GetTrack(n)->ComputeEventDependentQuantities(*mEvent, frames);
     }  // for
     if (jb.get()) {
       mEvent->SetJacquetBlondelKinematics(*jb);
@@ -9,6 +9,7 @@
 
 #include "eicsmear/erhic/EventFactoryHepMC.h"
 
+#include <chrono>
 #include <memory>
 #include <stdexcept>
 #include <string>
@@ -27,6 +28,7 @@
 #include "eicsmear/erhic/EventGmcTrans.h"
 #include "eicsmear/erhic/EventSimple.h"
 #include "eicsmear/erhic/EventDEMP.h"
+#include "eicsmear/erhic/EventMCFilterABC.h"
 #include "eicsmear/erhic/EventSartre.h"
 #include "eicsmear/functions.h"  // For getFirstNonBlank()
 #include "eicsmear/erhic/Kinematics.h"
@@ -295,7 +297,10 @@ namespace erhic {
 	UpdateRuninfo( mObjectsToWriteAtTheEnd, evt );
       }  // if ( mEvent.get() )
 
+      const auto start = std::chrono::steady_clock::now();
       auto finished = FinishEvent(); // 0 is success
+      mFinishEventSeconds += std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
       return (finished==0);
     }  // try
     catch(std::exception& error) {
@@ -308,10 +313,20 @@ namespace erhic {
   erhic::EventHepMC* EventFromAsciiFactory<erhic::EventHepMC>::Create()
   {
     TProcessIdObjectCount objectCount;
-    mEvent.reset(new erhic::EventHepMC());
-    if (!AddParticle()) {
-      mEvent.reset(nullptr);
-    }  // if
+    while (true) {
+      mEvent.reset(new erhic::EventHepMC());
+      if (!AddParticle()) {
+        mEvent.reset(nullptr);
+        break;
+      }  // if
+      // HepMC3 reads whole events, so there is no header-only shortcut:
+      // both filter stages see the complete event.
+      if (!mFilter ||
+          (mFilter->AcceptHeader(*mEvent) && mFilter->Accept(*mEvent))) {
+        break;
+      }  // if
+      ++mNRejected;
+    }  // while
 
     return mEvent.release();
   }
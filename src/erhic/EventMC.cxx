@@ -9,8 +9,8 @@
 
 #include "eicsmear/erhic/EventMC.h"
 
+#include <algorithm>
 #include <iostream>
-#include <list>
 #include <string>
 #include <vector>
 
@@ -37,7 +37,13 @@ EventMC::EventMC()
 , nTracks(-1)
 , ELeptonInNucl(NAN)
 , ELeptonOutNucl(NAN)
-, particles("erhic::ParticleMC", 100) {
+, particles("erhic::ParticleMC", 100)
+, mScatteredIndex(-2)
+, mSlim(false)
+, mFinalStateSumsValid(false)
+, mFinalStateCharge(0.)
+, mBeamsIdentified(false)
+, mFoundAllBeams(false) {
 }
 
 EventMC::~EventMC() {
@@ -56,18 +62,12 @@ TrackVector EventMC::GetTracks() const {
 }
 
 void EventMC::HadronicFinalState(TrackVector& final_) const {
-  // This is simple but not very efficient.
-  // Copy vector to a list and use list::remove to get rid
-  // of the scattered lepton. Then copy this list back to
-  // the vector.
   // Note that the method is a bit of a misnomer - it will return ALL final
   // particles other than the scattered lepton
   // (intentionally, since you want to take decay products into account as well)
-  FinalState(final_);
-  std::list<const VirtualParticle*> plist(final_.begin(),
-                                          final_.end());
-  plist.remove(ScatteredLepton());
-  final_ = TrackVector(plist.begin(), plist.end());
+  final_.clear();
+  ParticleView hadrons = HadronicFinalStateParticles();
+  final_.assign(hadrons.begin(), hadrons.end());
 }
 
 // Get the particles that belong to the hadronic final state.
@@ -75,51 +75,52 @@ void EventMC::HadronicFinalState(TrackVector& final_) const {
 // so don't delete them!
 void EventMC::FinalState(TrackVector& final_) const {
   final_.clear();
-  TIter next(&particles);
-  ParticleMC* p(NULL);
-  while ((p = static_cast<ParticleMC*>(next()))) {
-    if (1 == p->GetStatus()) {
-      final_.push_back(p);
-    }  // if
-  }  // while
+  ParticleView final = FinalStateParticles();
+  final_.assign(final.begin(), final.end());
 }
 
-TLorentzVector EventMC::FinalStateMomentum() const {
-  TrackVector final_;
-  FinalState(final_);
-  TLorentzVector mom;
-  for (TrackVectorCIter i = final_.begin(); i != final_.end(); ++i) {
-    mom += (*i)->Get4Vector();
+void EventMC::ComputeFinalStateSums() const {
+  const ParticleMC* scattered = ScatteredLepton();
+  mFinalStateMomentum.SetXYZT(0., 0., 0., 0.);
+  mHadronicFinalStateMomentum.SetXYZT(0., 0., 0., 0.);
+  mFinalStateCharge = 0.;
+  TDatabasePDG* pdg = TDatabasePDG::Instance();
+  ParticleView final = FinalStateParticles();
+  for (ParticleView::const_iterator i = final.begin(); i != final.end(); ++i) {
+    const TLorentzVector momentum = (*i)->Get4Vector();
+    mFinalStateMomentum += momentum;
+    if (*i != scattered) {
+      mHadronicFinalStateMomentum += momentum;
+    }  // if
+    TParticlePDG* part = pdg->GetParticle((*i)->Id());
+    if (part) {
+      mFinalStateCharge += part->Charge() / 3.;
+    } else {
+      std::cout << "Unknown particle: " << (*i)->Id() << std::endl;
+    }  // if
   }  // for
+  mFinalStateSumsValid = true;
+}
 
-  return mom;
+TLorentzVector EventMC::FinalStateMomentum() const {
+  if (!mFinalStateSumsValid) {
+    ComputeFinalStateSums();
+  }  // if
+  return mFinalStateMomentum;
 }
 
 TLorentzVector EventMC::HadronicFinalStateMomentum() const {
-  TrackVector final_;
-  HadronicFinalState(final_);
-  TLorentzVector mom;
-  for (TrackVectorCIter i = final_.begin(); i != final_.end(); ++i) {
-    mom += (*i)->Get4Vector();
-  }  // for
-
-  return mom;
+  if (!mFinalStateSumsValid) {
+    ComputeFinalStateSums();
+  }  // if
+  return mHadronicFinalStateMomentum;
 }
 
 Double_t EventMC::FinalStateCharge() const {
-  TrackVector final_;
-  FinalState(final_);
-  Double_t charge(0);
-  TDatabasePDG* pdg = TDatabasePDG::Instance();
-  for (TrackVectorCIter i = final_.begin(); i != final_.end(); ++i) {
-    TParticlePDG* part = pdg->GetParticle((*i)->Id());
-    if (part) {
-      charge += part->Charge() / 3.;
-    } else {
-      std::cout << "Unknown particle: " << (*i)->Id() << std::endl;
-    }  // if
-  }  // for
-  return charge;
+  if (!mFinalStateSumsValid) {
+    ComputeFinalStateSums();
+  }  // if
+  return mFinalStateCharge;
 }
 
   // See header!
@@ -134,15 +135,42 @@ const ParticleMC* EventMC::BeamHadron() const {
 
   // See header!
 const ParticleMC* EventMC::ScatteredLepton() const {
+  if (mScatteredIndex >= 0) {
+    return GetTrack(mScatteredIndex);
+  } else if (-1 == mScatteredIndex) {
+    return NULL;
+  }  // if
+  // Not resolved, e.g. events from files written before the index was
+  // stored, so fall back to searching the event record.
+  return FindScatteredLepton();
+}
+
+  // See header!
+const ParticleMC* EventMC::FindScatteredLepton() const {
   return GetTrack(2);
 }
 
+void EventMC::ResolveScatteredLepton() {
+  const ParticleMC* scattered = FindScatteredLepton();
+  mScatteredIndex = (scattered ? particles.IndexOf(scattered) : -1);
+  mFinalStateSumsValid = false;
+}
+
   // See header!
 const ParticleMC* EventMC::ExchangeBoson() const {
   return GetTrack(3);
 }
 
 
+bool EventMC::IdentifyBeams(std::vector<const VirtualParticle*>& beams) const {
+  if (!mBeamsIdentified) {
+    mFoundAllBeams = ParticleIdentifier::FindBeams(*this, mIdentifiedBeams);
+    mBeamsIdentified = true;
+  }  // if
+  beams = mIdentifiedBeams;
+  return mFoundAllBeams;
+}
+
 void EventMC::Reset() {
   number = -1;
   process = -1;
@@ -153,11 +181,103 @@ void EventMC::Reset() {
 void EventMC::Clear(Option_t* /*option*/) {
   Reset();
   particles.Clear();
+  mScatteredIndex = -2;
+  mSlim = false;
+  mFinalStateSumsValid = false;
+  mBeamsIdentified = false;
 }
 
 void EventMC::AddLast(ParticleMC* track) {
   new(particles[particles.GetEntries()]) ParticleMC(*track);
   nTracks = particles.GetEntries();
+  mScatteredIndex = -2;
+  mFinalStateSumsValid = false;
+  mBeamsIdentified = false;
+}
+
+void EventMC::Slim() {
+  const int n = particles.GetEntries();
+  // Keep everything up to the last of the beams and exchange boson,
+  // so generators locating them by position still find them.
+  int nLeading(0);
+  const ParticleMC* special[] = {BeamLepton(), BeamHadron(), ExchangeBoson()};
+  for (const ParticleMC* particle : special) {
+    if (particle) {
+      nLeading = std::max(nLeading, particles.IndexOf(particle) + 1);
+    }  // if
+  }  // for
+  const ParticleMC* scattered = ScatteredLepton();
+  // New index of each particle by its old index, both starting at 1.
+  // 0 if the particle is dropped.
+  std::vector<int> indices(n + 1, 0);
+  std::vector<ParticleMC> kept;
+  kept.reserve(n);
+  for (int i(0); i < n; ++i) {
+    const ParticleMC* particle = GetTrack(i);
+    if (i < nLeading || particle == scattered ||
+        1 == particle->GetStatus()) {
+      kept.push_back(*particle);
+      indices.at(i + 1) = kept.size();
+    }  // if
+  }  // for
+  // Returns the new index of the nearest kept ancestor, starting from
+  // the particle with the old index given, or 0 if there is none.
+  // The number of steps is limited in case of loops in the record.
+  auto ancestor = [&](int index) -> int {
+    for (int step(0); index > 0 && index <= n && step < n; ++step) {
+      if (indices.at(index) > 0) {
+        return indices.at(index);
+      }  // if
+      index = GetTrack(index - 1)->GetParentIndex();
+    }  // for
+    return 0;
+  };
+  for (std::size_t i(0); i < kept.size(); ++i) {
+    ParticleMC& particle = kept.at(i);
+    particle.SetIndex(i + 1);
+    particle.SetParentIndex(ancestor(particle.GetParentIndex()));
+    particle.SetParentIndex1(ancestor(particle.GetParentIndex1()));
+    particle.SetChild1Index(0);
+    particle.SetChildNIndex(0);
+  }  // for
+  for (std::size_t i(0); i < kept.size(); ++i) {
+    const int parent = kept.at(i).GetParentIndex();
+    if (parent > 0) {
+      ParticleMC& mother = kept.at(parent - 1);
+      if (0 == mother.GetChild1Index()) {
+        mother.SetChild1Index(i + 1);
+      }  // if
+      mother.SetChildNIndex(i + 1);
+    }  // if
+  }  // for
+  const int scatteredIndex =
+    (scattered ? indices.at(particles.IndexOf(scattered) + 1) - 1 : -1);
+  particles.Clear();
+  for (std::size_t i(0); i < kept.size(); ++i) {
+    AddLast(&kept.at(i));
+  }  // for
+  mScatteredIndex = scatteredIndex;
+  mSlim = true;
+  mFinalStateSumsValid = false;
+  mBeamsIdentified = false;
+}
+
+bool EventMC::IsBookkeepingMember(const std::string& name) {
+  return name == "mScatteredIndex" || name == "mSlim";
+}
+
+void EventMC::ComputeDerivedQuantities() {
+  const EventFrames frames(*this);
+  for (unsigned i(0); i < GetNTracks(); ++i) {
+    ParticleMC* particle = GetTrack(i);
+    // The parent of a slim event may not be the original one
+    const Int_t parentId = particle->GetParentId();
+    particle->ComputeDerivedQuantities();
+    particle->ComputeEventDependentQuantities(*this, frames);
+    particle->SetParentId(parentId);
+  }  // for
+  mFinalStateSumsValid = false;
+  mBeamsIdentified = false;
 }
 
 void EventMC::Print( const Option_t *option) const {
@@ -188,6 +308,9 @@ EventMC* Reader::Read(Long64_t i) {
   if (mTree) {
     mTree->GetEntry(i);
     event = mEvent;
+    if (event && event->IsSlim()) {
+      event->ComputeDerivedQuantities();
+    }  // if
   }  // if
   return event;
 }
@@ -68,7 +68,7 @@ bool EventPythia::Parse(const std::string& line) {
 //  1) pdg code equals that of incident lepton beam.
 //  2) status code is 1 i.e. it's a stable/final-state particle.
 //  3) the parent is track three (counting from 1).
-const ParticleMC* EventPythia::ScatteredLepton() const {
+const ParticleMC* EventPythia::FindScatteredLepton() const {
   // Look for the lepton beam to get the species.
   // If we don't get it we can't find the scattered
   // lepton so return NULL.
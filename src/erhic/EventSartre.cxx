@@ -51,7 +51,7 @@ bool EventSartre::Parse(const std::string& line) {
   //  1) pdg code equals that of incident lepton beam.
   //  2) status code is 1 i.e. it's a stable/final-state particle.
   //  3) the parent is track 1 or 2
-  const ParticleMC* EventSartre::ScatteredLepton() const {
+  const ParticleMC* EventSartre::FindScatteredLepton() const {
     // Look for the lepton beam to get the species.
     // If we don't get it we can't find the scattered
     // lepton so return NULL.
@@ -9,6 +9,9 @@
 
 #include "eicsmear/erhic/Forester.h"
 
+#include <sys/resource.h>
+
+#include <chrono>
 #include <iomanip>
 #include <memory>
 #include <stdexcept>
@@ -16,18 +19,49 @@
 
 #include <TRefArray.h>
 #include <TString.h>
+#include <TSystem.h>
 
 #include "eicsmear/erhic/EventFactory.h"
+#include "eicsmear/erhic/EventMC.h"
 #include "eicsmear/erhic/File.h"
 #include "eicsmear/erhic/ParticleIdentifier.h"
 
 #include "eicsmear/gzstream.h"
 
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsBetween(const Clock::time_point& start,
+                      const Clock::time_point& end) {
+  return std::chrono::duration<double>(end - start).count();
+}
+
+// Returns the peak resident memory of the process in kB,
+// or -1 if it cannot be determined.
+Long64_t peakResidentKB() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return -1;
+  }  // if
+  return usage.ru_maxrss;  // kB on Linux
+}
+
+// Particle quantities not stored in slim trees,
+// restored by erhic::EventMC::ComputeDerivedQuantities().
+const char* const kDerivedParticleColumns[] = {
+  "pt", "p", "theta", "phi", "rapidity", "eta", "z", "xFeynman",
+  "thetaGamma", "ptVsGamma", "thetaGammaHCM", "ptVsGammaHCM", "phiPrf"
+};
+
+}  // anonymous namespace
+
 namespace erhic {
 
 Forester::Forester()
 : mQuit(false)
 , mVerbose(false)
+, mSlim(false)
 , mTree(NULL)
 , mEvent(NULL)
 , mFile(NULL)
@@ -39,7 +73,8 @@ Forester::Forester()
 , mOutputName("default.root")
 , mTreeName("EICTree")
 , mBranchName("event")
-, mFactory(NULL) {
+, mFactory(NULL)
+, mFilter(NULL) {
 }
 
 Forester::~Forester() {
@@ -70,16 +105,17 @@ Forester::~Forester() {
 Long64_t Forester::Plant() {
   try {
     // Initialisation of the input and output files.
+    mStatus.Reset();
     OpenInput();
     SetupOutput();
     if (BeVerbose()) {
       std::cout << "\nProcessing " << GetInputFileName() << std::endl;
     }  // if
-    /**
-     \todo Get rid of the static counter. Replace with a member
-     that is reset every time Plant() is called.
-     */
-    static int i(0);
+    // Input is sampled for the rates at most once per second.
+    const Clock::time_point start = Clock::now();
+    Clock::time_point lastSample = start;
+    SampleInput(0.);
+    Long64_t i(0);
     while (!MustQuit()) {
       ++i;
       if (BeVerbose() && i % mInterval == 0) {
@@ -100,15 +136,31 @@ Long64_t Forester::Plant() {
       // Catch exceptions from event builder here so we don't break
       // out of the whole tree building loop for a single bad event.
       try {
+        const double finishEvent = mFactory->GetFinishEventSeconds();
+        const Clock::time_point beforeCreate = Clock::now();
         mEvent = mFactory->Create();
+        if (mSlim && mEvent) {
+          static_cast<EventMC*>(mEvent)->Slim();
+        }  // if
+        const Clock::time_point afterCreate = Clock::now();
         // Fill the tree
         if (mEvent) {
           mTree->Fill();
+          const Clock::time_point afterFill = Clock::now();
+          const double kinematics =
+            mFactory->GetFinishEventSeconds() - finishEvent;
+          mStatus.AddTimes(
+            secondsBetween(beforeCreate, afterCreate) - kinematics,
+            kinematics, secondsBetween(afterCreate, afterFill));
           if (GetMaxNEvents() > 0 && i >= GetMaxNEvents()) {
             SetMustQuit(true);  // Hit max number of events, so quit
           }  // if
           mStatus.ModifyEventCount(1);
           mStatus.ModifyParticleCount(mEvent->GetNTracks());
+          if (secondsBetween(lastSample, afterFill) >= 1.) {
+            SampleInput(secondsBetween(start, afterFill));
+            lastSample = afterFill;
+          }  // if
           // We must ResetBranchAddress before deleting the event.
         } else {
           break;
@@ -118,8 +170,11 @@ Long64_t Forester::Plant() {
         std::cerr << "Caught exception in Forester::Plant(): "
         << e.what() << std::endl;
         std::cerr << "Event will be skipped..." << std::endl;
+        mStatus.ModifySkippedCount(1);
       }  // catch
     }  // while
+    SampleInput(secondsBetween(start, Clock::now()));
+    mStatus.ModifyRejectedCount(mFactory->GetNRejected());
     Finish();
     return 0;
   }  // try
@@ -166,6 +221,10 @@ bool Forester::OpenInput() {
     mFactory->mAdditionalInformation["generator"]=mFile->GetGeneratorName();
     mFactory->mAdditionalInformation.insert(mFile->mAdditionalInformation.begin(),
                                             mFile->mAdditionalInformation.end());
+    if (mFilter && !mFactory->SetFilter(mFilter)) {
+      throw std::runtime_error("Event filters are not supported for " +
+                               mFile->GetGeneratorName() + " input");
+    }  // if
     return true;
   } // Pass the exception on to be dealt with higher up the food chain.
   catch(std::exception&) {
@@ -175,12 +234,16 @@ bool Forester::OpenInput() {
 
 bool Forester::SetupOutput() {
   try {
+    // Process-wide settings e.g. maximum tree size
+    mPolicy.ApplyGlobal();
     // Open the ROOT file and check it opened OK
     mRootFile = new TFile(GetOutputFileName().c_str(), "RECREATE");
     if (!mRootFile->IsOpen()) {
       std::string message("Unable to open file ");
       throw std::runtime_error(message.append(GetOutputFileName()));
     }  // if
+    // Set compression before creating the tree
+    mPolicy.Apply(*mRootFile);
     // Create the tree and check for errors
     mTree = new TTree(GetTreeName().c_str(), "my EIC tree");
     if (!mTree) {
@@ -190,10 +253,30 @@ bool Forester::SetupOutput() {
     // Allocate memory for the branch buffer and
     // add the branch to the tree
     AllocateEvent();
-    mTree->Branch(GetBranchName().c_str(), mEvent->ClassName(),
-                  &mEvent, 32000, 99);
-    // Auto-save every 500 MB
+    if (!mPolicy.Branch(*mTree, GetBranchName(), mEvent->ClassName(),
+                        &mEvent)) {
+      throw std::runtime_error("Error creating branch " + GetBranchName());
+    }  // if
+    // Disabled branches aren't filled, so the derived particle
+    // columns of slim trees hold no entries.
+    if (mSlim) {
+      if (!dynamic_cast<EventMC*>(mEvent)) {
+        throw std::runtime_error(std::string("Slim events are not supported")
+                                 + " for " + mEvent->ClassName());
+      }  // if
+      // Sub-branch names include the branch name if it ends with a dot
+      TString prefix(GetBranchName());
+      if (!prefix.EndsWith(".")) {
+        prefix.Clear();
+      }  // if
+      for (const char* column : kDerivedParticleColumns) {
+        mTree->SetBranchStatus(prefix + "particles." + column, 0);
+      }  // for
+    }  // if
+    // Auto-flush and auto-save intervals, saving every 500 MB unless
+    // the policy says otherwise
     mTree->SetAutoSave(500LL * 1024LL * 1024LL);
+    mPolicy.Apply(*mTree);
     // Align the input file at the start of the first event (event generator dependent).
     mFactory->FindFirstEvent();
     // Start timing after opening and creating files,
@@ -221,6 +304,7 @@ void Forester::Finish() {
   // Write the Forester itself to make it easier to reproduce the file
   // with the same settings.
   Write("forester");
+  mPolicy.Write("outputPolicy");
   // Reset quit flag in case of further runs.
   SetMustQuit(false);
   // Stop timing the run.
@@ -228,9 +312,40 @@ void Forester::Finish() {
   if (BeVerbose()) {
     GetGetStatus().Print(std::cout);  // Messages for the user
   }  // if
+  if (!mSummaryName.empty()) {
+    std::ofstream summary(mSummaryName.c_str());
+    if (summary.good()) {
+      GetGetStatus().PrintJson(summary);
+    } else {
+      std::cerr << "Unable to write summary to " << mSummaryName
+                << std::endl;
+    }  // if
+  }  // if
   mRootFile->Close();
 }
 
+void Forester::SampleInput(double seconds) {
+  Long64_t compressed(-1), uncompressed(-1);
+  if (igzstream* gz = dynamic_cast<igzstream*>(mTextFile.get())) {
+    compressed = gz->rdbuf()->compressed_offset();
+    uncompressed = gz->rdbuf()->uncompressed_offset();
+  } else if (mTextFile) {
+    // The position is unavailable once the end of the file is reached,
+    // when the whole file has been read.
+    std::streampos position = mTextFile->tellg();
+    if (position >= 0) {
+      compressed = position;
+    } else if (mTextFile->eof()) {
+      FileStat_t info;
+      if (gSystem->GetPathInfo(GetInputFileName().c_str(), info) == 0) {
+        compressed = info.fSize;
+      }  // if
+    }  // if
+    uncompressed = compressed;
+  }  // if
+  mStatus.Sample(seconds, compressed, uncompressed);
+}
+
 bool Forester::AllocateEvent() {
   try {
     if (mEvent) {
@@ -265,6 +380,7 @@ void Forester::Print(std::ostream& os) const {
   os << "Output tree: " << mTreeName << std::endl;
   os << "Output branch: " << mBranchName << std::endl;
   os << "Maximum number of events: " << mMaxNEvents << std::endl;
+  os << "Slim events: " << (mSlim ? "yes" : "no") << std::endl;
   if (mEvent) {
     os << "Event type: " << mEvent->ClassName() << std::endl;
   }  // if
@@ -274,18 +390,35 @@ void Forester::Print(Option_t* /* not used */) const {
   Print(std::cout);
 }
 
-  Forester::Status::Status()
-    : mNEvents(0)
-    , mNParticles(0) {
-    // Initialise the start and end time to the creation time and reset
+  Forester::Status::Status() {
+    Reset();
+  }
+
+  Forester::Status::~Status() { /* noop */ }
+
+  void Forester::Status::Reset() {
+    // Initialise the start and end time to the current time and reset
     // the timer to ensure it is at zero.
     std::time(&mStartTime);
     mEndTime = mStartTime;
+    mNEvents = 0;
+    mNParticles = 0;
+    mNSkipped = 0;
+    mNRejected = 0;
+    mParseSeconds = 0.;
+    mKinematicsSeconds = 0.;
+    mFillSeconds = 0.;
+    mCompressedBytes = 0;
+    mUncompressedBytes = 0;
+    mEventRate = 0.;
+    mParticleRate = 0.;
+    mCompressedByteRate = 0.;
+    mUncompressedByteRate = 0.;
+    mPeakResidentKB = -1;
+    mPoints.clear();
     mTimer.Reset();
   }
 
-  Forester::Status::~Status() { /* noop */ }
-
   std::ostream& Forester::Status::Print(std::ostream& os) const {
     // Put start and end times in different os <<... otherwise I get
     // the same time for each...
@@ -295,6 +428,52 @@ void Forester::Print(Option_t* /* not used */) const {
        << mNParticles << " particles in "
        << mTimer.RealTime() << " seconds "
        << '(' << mTimer.RealTime()/mNEvents <<" sec/event)" << std::endl;
+    if (mNSkipped > 0) {
+      os << "Skipped " << mNSkipped << " bad events" << std::endl;
+    }  // if
+    if (mNRejected > 0) {
+      os << "Filter accepted " << mNEvents << " events, rejected "
+         << mNRejected << std::endl;
+    }  // if
+    os << "Time parsing " << mParseSeconds << " s, kinematics "
+       << mKinematicsSeconds << " s, filling tree " << mFillSeconds
+       << " s" << std::endl;
+    os << "Read " << mCompressedBytes << " bytes (" << mUncompressedBytes
+       << " uncompressed)" << std::endl;
+    os << "Over the last " << WindowSeconds() << " s: " << mEventRate
+       << " events/s, " << mParticleRate << " particles/s, "
+       << mCompressedByteRate / 1.e6 << " MB/s ("
+       << mUncompressedByteRate / 1.e6 << " MB/s uncompressed)"
+       << std::endl;
+    if (mPeakResidentKB >= 0) {
+      os << "Peak resident memory " << mPeakResidentKB / 1024. << " MB"
+         << std::endl;
+    }  // if
+    return os;
+  }
+
+  std::ostream& Forester::Status::PrintJson(std::ostream& os) const {
+    os << "{\n"
+       << "  \"start_time\": " << mStartTime << ",\n"
+       << "  \"end_time\": " << mEndTime << ",\n"
+       << "  \"real_time_s\": " << mTimer.RealTime() << ",\n"
+       << "  \"events\": " << mNEvents << ",\n"
+       << "  \"particles\": " << mNParticles << ",\n"
+       << "  \"skipped_events\": " << mNSkipped << ",\n"
+       << "  \"rejected_events\": " << mNRejected << ",\n"
+       << "  \"parse_s\": " << mParseSeconds << ",\n"
+       << "  \"kinematics_s\": " << mKinematicsSeconds << ",\n"
+       << "  \"fill_s\": " << mFillSeconds << ",\n"
+       << "  \"compressed_bytes\": " << mCompressedBytes << ",\n"
+       << "  \"uncompressed_bytes\": " << mUncompressedBytes << ",\n"
+       << "  \"rate_window_s\": " << WindowSeconds() << ",\n"
+       << "  \"events_per_s\": " << mEventRate << ",\n"
+       << "  \"particles_per_s\": " << mParticleRate << ",\n"
+       << "  \"compressed_bytes_per_s\": " << mCompressedByteRate << ",\n"
+       << "  \"uncompressed_bytes_per_s\": " << mUncompressedByteRate
+       << ",\n"
+       << "  \"peak_rss_kb\": " << mPeakResidentKB << "\n"
+       << "}" << std::endl;
     return os;
   }
 
@@ -316,6 +495,50 @@ void Forester::Print(Option_t* /* not used */) const {
     mNParticles += count;
   }
 
+  void Forester::Status::ModifySkippedCount(Long64_t count) {
+    mNSkipped += count;
+  }
+
+  void Forester::Status::ModifyRejectedCount(Long64_t count) {
+    mNRejected += count;
+  }
+
+  void Forester::Status::AddTimes(double parse, double kinematics,
+                                  double fill) {
+    mParseSeconds += parse;
+    mKinematicsSeconds += kinematics;
+    mFillSeconds += fill;
+  }
+
+  void Forester::Status::Sample(double seconds, Long64_t compressedBytes,
+                                Long64_t uncompressedBytes) {
+    if (compressedBytes >= 0) {
+      mCompressedBytes = compressedBytes;
+    }  // if
+    if (uncompressedBytes >= 0) {
+      mUncompressedBytes = uncompressedBytes;
+    }  // if
+    Point point = {seconds, mNEvents, mNParticles,
+                   mCompressedBytes, mUncompressedBytes};
+    mPoints.push_back(point);
+    // Drop points until the oldest is the last one at least a window
+    // before the newest.
+    while (mPoints.size() > 2 &&
+           seconds - mPoints.at(1).seconds >= WindowSeconds()) {
+      mPoints.pop_front();
+    }  // while
+    const Point& first = mPoints.front();
+    const double elapsed = seconds - first.seconds;
+    if (elapsed > 0.) {
+      mEventRate = (mNEvents - first.events) / elapsed;
+      mParticleRate = (mNParticles - first.particles) / elapsed;
+      mCompressedByteRate = (mCompressedBytes - first.compressed) / elapsed;
+      mUncompressedByteRate =
+        (mUncompressedBytes - first.uncompressed) / elapsed;
+    }  // if
+    mPeakResidentKB = peakResidentKB();
+  }
+
   // ClassImp( ForesterStatus ); // throws error for some reason
 
 
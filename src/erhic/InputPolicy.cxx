@@ -0,0 +1,99 @@
+/**
+ \file
+ Implementation of class erhic::InputPolicy.
+
+ \date      2026-10-18
+ \copyright 2026 Brookhaven National Lab
+ */
+
+#include "eicsmear/erhic/InputPolicy.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <TEnv.h>
+#include <TROOT.h>
+#include <TTree.h>
+#include <TTreeCacheUnzip.h>
+
+namespace erhic {
+
+InputPolicy::InputPolicy()
+: mCacheSize(30000000)
+, mBranches("event")
+, mAsyncPrefetch(false)
+, mParallelUnzip(false)
+, mImplicitMT(-1) {
+}
+
+InputPolicy::~InputPolicy() {
+}
+
+InputPolicy InputPolicy::Remote() {
+  InputPolicy policy;
+  policy.SetCacheSize(100000000);
+  policy.SetAsyncPrefetch(true);
+  policy.SetParallelUnzip(true);
+  policy.SetImplicitMT(0);
+  return policy;
+}
+
+void InputPolicy::ApplyGlobal() const {
+  // Read by TFile when a file is opened. Only turned on, so as not to
+  // override the user's own setting.
+  if (mAsyncPrefetch) {
+    gEnv->SetValue("TFile.AsyncPrefetching", 1);
+  }  // if
+  if (mImplicitMT >= 0 && !ROOT::IsImplicitMTEnabled()) {
+    ROOT::EnableImplicitMT(mImplicitMT);
+  }  // if
+  if (mParallelUnzip) {
+    TTreeCacheUnzip::SetParallelUnzip(TTreeCacheUnzip::kEnable);
+  }  // if
+}
+
+void InputPolicy::Apply(TTree& tree) const {
+  if (mCacheSize >= 0) {
+    tree.SetCacheSize(mCacheSize);
+  }  // if
+  if (mCacheSize == 0) {
+    return;
+  }  // if
+  // Cache only the listed branches, rather than whatever the cache
+  // learns from the first entries read.
+  std::istringstream stream(TString(mBranches).ReplaceAll(",", " ").Data());
+  std::string name;
+  while (stream >> name) {
+    if (tree.AddBranchToCache(name.c_str(), kTRUE) < 0) {
+      std::cerr << "Unable to cache branch " << name << std::endl;
+    }  // if
+  }  // while
+  tree.StopCacheLearningPhase();
+}
+
+void InputPolicy::Print(Option_t*) const {
+  std::cout << "Cache size: ";
+  if (mCacheSize < 0) {
+    std::cout << "ROOT default";
+  } else {
+    std::cout << mCacheSize << " bytes";
+  }  // if
+  std::cout << std::endl;
+  std::cout << "Cached branches: " << mBranches << std::endl;
+  std::cout << "Asynchronous prefetching: " <<
+  (mAsyncPrefetch ? "on" : "off") << std::endl;
+  std::cout << "Parallel unzipping: " <<
+  (mParallelUnzip ? "on" : "off") << std::endl;
+  std::cout << "Implicit MT threads: ";
+  if (mImplicitMT < 0) {
+    std::cout << "off";
+  } else if (mImplicitMT == 0) {
+    std::cout << "all cores";
+  } else {
+    std::cout << mImplicitMT;
+  }  // if
+  std::cout << std::endl;
+}
+
+}  // namespace erhic
@@ -0,0 +1,138 @@
+/**
+ \file
+ Implementation of class erhic::OutputPolicy.
+
+ \date      2026-10-18
+ \copyright 2026 Brookhaven National Lab
+ */
+
+#include "eicsmear/erhic/OutputPolicy.h"
+
+#include <iostream>
+
+#include <TBranch.h>
+#include <TClass.h>
+#include <TFile.h>
+#include <TROOT.h>
+#include <TTree.h>
+
+namespace {
+
+// ROOT compression algorithm codes: the setting is 100 * code + level.
+// See ROOT::RCompressionSetting::EAlgorithm.
+const char* const algorithmNames[] = {"default", "zlib", "lzma", "old",
+                                      "lz4", "zstd"};
+const int nAlgorithms = sizeof(algorithmNames) / sizeof(algorithmNames[0]);
+
+}  // anonymous namespace
+
+namespace erhic {
+
+OutputPolicy::OutputPolicy()
+: mCompression(-1)
+, mBasketSize(32000)
+, mSplitLevel(99)
+, mAutoFlush(-30000000)
+, mAutoSave(0)
+, mMaxTreeSize(0)
+, mImplicitMT(-1) {
+}
+
+OutputPolicy::~OutputPolicy() {
+}
+
+OutputPolicy OutputPolicy::Scratch() {
+  OutputPolicy policy;
+  policy.SetCompression("lz4", 4);
+  return policy;
+}
+
+OutputPolicy OutputPolicy::Archive() {
+  OutputPolicy policy;
+  policy.SetCompression("lzma", 8);
+  return policy;
+}
+
+bool OutputPolicy::SetCompression(const TString& algorithm, Int_t level) {
+  for (int i(0); i < nAlgorithms; ++i) {
+    if (algorithm.EqualTo(algorithmNames[i], TString::kIgnoreCase)) {
+      mCompression = (i == 0 ? -1 : 100 * i + level);
+      return true;
+    }  // if
+  }  // for
+  std::cerr << "Unknown compression algorithm " << algorithm << std::endl;
+  return false;
+}
+
+void OutputPolicy::ApplyGlobal() const {
+  if (mMaxTreeSize > 0) {
+    TTree::SetMaxTreeSize(mMaxTreeSize);
+  }  // if
+  if (mImplicitMT >= 0 && !ROOT::IsImplicitMTEnabled()) {
+    ROOT::EnableImplicitMT(mImplicitMT);
+  }  // if
+}
+
+void OutputPolicy::Apply(TFile& file) const {
+  if (mCompression >= 0) {
+    file.SetCompressionSettings(mCompression);
+  }  // if
+}
+
+void OutputPolicy::Apply(TTree& tree) const {
+  tree.SetAutoFlush(mAutoFlush);
+  if (mAutoSave != 0) {
+    tree.SetAutoSave(mAutoSave);
+  }  // if
+}
+
+TBranch* OutputPolicy::Branch(TTree& tree, const std::string& name,
+                              const std::string& className,
+                              void* address) const {
+  if (!TClass::GetClass(className.c_str())) {
+    std::cerr << "Unknown class " << className << " for branch " << name <<
+    std::endl;
+    return NULL;
+  }  // if
+  return tree.Branch(name.c_str(), className.c_str(), address,
+                     mBasketSize, mSplitLevel);
+}
+
+void OutputPolicy::Print(Option_t*) const {
+  std::cout << "Compression: ";
+  const int algorithm = mCompression / 100;
+  if (mCompression < 0 || algorithm >= nAlgorithms) {
+    std::cout << "ROOT default";
+  } else {
+    std::cout << algorithmNames[algorithm] << " level " << mCompression % 100;
+  }  // if
+  std::cout << std::endl;
+  std::cout << "Basket size: " << mBasketSize << " bytes" << std::endl;
+  std::cout << "Split level: " << mSplitLevel << std::endl;
+  std::cout << "Auto-flush: " << mAutoFlush << std::endl;
+  std::cout << "Auto-save: ";
+  if (mAutoSave == 0) {
+    std::cout << "ROOT default";
+  } else {
+    std::cout << mAutoSave;
+  }  // if
+  std::cout << std::endl;
+  std::cout << "Maximum tree size: ";
+  if (mMaxTreeSize <= 0) {
+    std::cout << "ROOT default";
+  } else {
+    std::cout << mMaxTreeSize << " bytes";
+  }  // if
+  std::cout << std::endl;
+  std::cout << "Implicit MT threads: ";
+  if (mImplicitMT < 0) {
+    std::cout << "off";
+  } else if (mImplicitMT == 0) {
+    std::cout << "all cores";
+  } else {
+    std::cout << mImplicitMT;
+  }  // if
+  std::cout << std::endl;
+}
+
+}  // namespace erhic
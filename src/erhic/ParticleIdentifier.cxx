@@ -9,14 +9,10 @@
 
 #include "eicsmear/erhic/ParticleIdentifier.h"
 
-#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <string>
 
-#include <TParticlePDG.h>
-#include <TDatabasePDG.h>
-
 #include "eicsmear/erhic/EventMC.h"
 
 using std::string;
@@ -24,6 +20,16 @@ using std::cout;
 using std::cerr;
 using std::endl;
 
+namespace {
+
+// True for charged leptons and neutrinos, i.e. the PDG "Lepton" class,
+// without looking the code up in the database.
+inline bool isLeptonCode(int pdgCode) {
+  const int code = ::abs(pdgCode);
+  return code >= 11 && code <= 18;
+}
+
+}  // anonymous namespace
 
 // =============================================================================
 // Constructor
@@ -56,9 +62,7 @@ bool ParticleIdentifier::isBeamLepton(
 // Identify the scattered lepton
 // =============================================================================
 bool ParticleIdentifier::isScatteredLepton(const erhic::VirtualParticle& particle) const {
-  auto pdgl = TDatabasePDG::Instance()->GetParticle( particle.Id() );
-  
-  return ( particle.GetStatus() == 1  && string(pdgl->ParticleClass()) == "Lepton" );
+  return ( particle.GetStatus() == 1  && isLeptonCode(particle.Id()) );
   // the old version here ignores flavor change, such as charged current dis
   // return ( particle.GetStatus() == 1  && particle.Id()==mScatteredPdgCode);
 }
@@ -197,6 +201,18 @@ bool ParticleIdentifier::IdentifyBeams(const erhic::VirtualEvent& event,
 // =============================================================================
 bool ParticleIdentifier::IdentifyBeams(const erhic::VirtualEvent& event,
          std::vector<const erhic::VirtualParticle*>& beams) {
+  // Monte Carlo events remember the result, so only search them once.
+  const erhic::EventMC* mc = dynamic_cast<const erhic::EventMC*>(&event);
+  if (mc) {
+    return mc->IdentifyBeams(beams);
+  }  // if
+  return FindBeams(event, beams);
+}
+
+// =============================================================================
+// =============================================================================
+bool ParticleIdentifier::FindBeams(const erhic::VirtualEvent& event,
+         std::vector<const erhic::VirtualParticle*>& beams) {
   // Initialise a vector with four NULL pointers,
   // one beam particle of interest.
   const erhic::VirtualParticle* const null(NULL);
@@ -206,13 +222,15 @@ bool ParticleIdentifier::IdentifyBeams(const erhic::VirtualEvent& event,
   if (event.GetTrack(0)) {
     finder.SetLeptonBeamPdgCode(event.GetTrack(0)->Id());
   }  // if
+  // One bit per beam particle found, in the order of the beams vector.
+  const unsigned kAllFound = (1 << 4) - 1;
+  unsigned found(0);
   // Count leptons so we don't overwrite the beam and scattered lepton with
   // subsequent leptons of the same type.
   int leptonCount(0);
   // Set to true once we find the first virtual photon, so we can skip
   // subsequent virtual photons.
   bool foundExchangeBoson(false);
-  bool foundAll(false);
   for (unsigned n(0); n < event.GetNTracks(); ++n) {
     const erhic::VirtualParticle* particle = event.GetTrack(n);
     if (!particle) {
@@ -221,19 +239,23 @@ bool ParticleIdentifier::IdentifyBeams(const erhic::VirtualEvent& event,
     // Test for beam lepton/hadron, exchange boson and scattered lepton.
     if (finder.isBeamNucleon(*particle)) {
       // cout << "Found the beam nucleon" << endl;
-      beams.at(1) = particle;
+      beams[1] = particle;
+      found |= 1 << 1;
     } else if (finder.isBeamLepton(*particle) && 0 == leptonCount) {
       // cout << "Found the beam lepton" << endl;
-      beams.at(0) = particle;
+      beams[0] = particle;
+      found |= 1 << 0;
       ++leptonCount;
     } else if (finder.isScatteredLepton(*particle) && 1 == leptonCount) {
       // cout << "Found the scattered lepton" << endl;
-      beams.at(3) = particle;
+      beams[3] = particle;
+      found |= 1 << 3;
       // Protect against additional KS == 1 leptons following this
       ++leptonCount;
     } else if (finder.IsVirtualPhoton(*particle) && !foundExchangeBoson) {
       // cout << "Found the boson" << endl;
-      beams.at(2) = particle;
+      beams[2] = particle;
+      found |= 1 << 2;
       foundExchangeBoson = true;
       // Check for charged current events, in which the scattered lepton
       // ID will not be the same as the incident lepton ID.
@@ -242,10 +264,9 @@ bool ParticleIdentifier::IdentifyBeams(const erhic::VirtualEvent& event,
     // Break out if we've found all four beams (should happen at/near the
     // start of the event record, so checking the other particles is a
     // waste of time).
-    foundAll = std::find(beams.begin(), beams.end(), null) == beams.end();
-    if (foundAll) {
+    if (kAllFound == found) {
       break;
     }  // if
   }  // for
-  return foundAll;
+  return kAllFound == found;
 }
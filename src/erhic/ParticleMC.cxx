@@ -176,41 +176,63 @@ void ParticleMCbase::ComputeDerivedQuantities() {
   phi = TVector2::Phi_0_2pi(atan2(py, px));
 }
 
+EventFrames::EventFrames(const EventMC& event)
+: valid(false)
+, hadronDotBoson(0.)
+, W(0.) {
+  // Get the beam hadon, beam lepton and exchange boson.
+  const ParticleMC* beamHadron = event.BeamHadron();
+  const ParticleMC* beamLepton = event.BeamLepton();
+  const ParticleMC* scattered = event.ScatteredLepton();
+  if (!beamHadron || !beamLepton || !scattered) {
+    return;
+  }  // if
+  hadron = beamHadron->Get4Vector();
+  const TLorentzVector lepton = scattered->Get4Vector();
+  // Determine the exchange boson 4-vector from the scattered lepton,
+  // since we're not always guaranteed to have one (weak neutral current e.g.)
+  // const TLorentzVector& boson = event.ExchangeBoson()->Get4Vector();
+  boson = beamLepton->Get4Vector() - lepton;
+  hadronDotBoson = hadron.Dot(boson);
+  W = sqrt(event.GetW2());
+  // We want pT and angle with respect to the virtual photon,
+  // so use that to define the z axis.
+  toHadronRest = computeBoost(hadron, &boson);
+  bosonPrf = (TLorentzVector(boson) *= toHadronRest);
+  leptonPrf = (TLorentzVector(lepton) *= toHadronRest);
+  // Boson-hadron centre-of-mass frame.
+  // Use the photon to define the z direction.
+  toHcm = computeBoost(boson + hadron, &boson);
+  valid = true;
+}
+
 void ParticleMCbase::ComputeEventDependentQuantities(EventMC& event) {
+  ComputeEventDependentQuantities(event, EventFrames(event));
+}
+
+void ParticleMCbase::ComputeEventDependentQuantities(
+    EventMC& event, const EventFrames& frames) {
   try {
-    // Get the beam hadon, beam lepton and exchange boson.
-    const TLorentzVector& hadron = event.BeamHadron()->Get4Vector();
-    const TLorentzVector& lepton = event.ScatteredLepton()->Get4Vector();
-    // Determine the exchange boson 4-vector from the scattered lepton,
-    // since we're not always guaranteed to have one (weak neutral current e.g.)
-    // const TLorentzVector& boson = event.ExchangeBoson()->Get4Vector();
-    const TLorentzVector boson = event.BeamLepton()->Get4Vector() - lepton;
-    
-    // Calculate z using the 4-vector definition,
-    // so we don't care about frame of reference.
-    z = hadron.Dot(Get4Vector()) / hadron.Dot(boson);
-    // Calculate properties in the proton rest frame.
-    // We want pT and angle with respect to the virtual photon,
-    // so use that to define the z axis.
-    TLorentzRotation toHadronRest = computeBoost(hadron, &boson);
-    // Boost this particle to the proton rest frame and calculate its
-    // pT and angle with respect to the virtual photon:
-    TLorentzVector p = (Get4Vector() *= toHadronRest);
-    thetaGamma = p.Theta();
-    ptVsGamma =  p.Pt();
-    // Calculate phi angle around virtual photon according
-    // to the HERMES convention.
-    TLorentzVector bosonPrf = (TLorentzVector(boson) *= toHadronRest);
-    TLorentzVector leptonPrf = (TLorentzVector(lepton) *= toHadronRest);
-    phiPrf = computeHermesPhiH(p, leptonPrf, bosonPrf);
-    // Feynman x with xF = 2 * pz / W in the boson-hadron CM frame.
-    // First boost to boson-hadron centre-of-mass frame.
-    // Use the photon to define the z direction.
-    TLorentzRotation boost = computeBoost(boson + hadron, &boson);
-    xFeynman = 2. * (Get4Vector() *= boost).Pz() / sqrt(event.GetW2());
-
-    thetaGammaHCM = (Get4Vector() *= boost).Theta();
-    ptVsGammaHCM =  (Get4Vector() *= boost).Pt();
+    if (frames.IsValid()) {
+      const TLorentzVector momentum = Get4Vector();
+      // Calculate z using the 4-vector definition,
+      // so we don't care about frame of reference.
+      z = frames.hadron.Dot(momentum) / frames.hadronDotBoson;
+      // Boost this particle to the proton rest frame and calculate its
+      // pT and angle with respect to the virtual photon:
+      TLorentzVector p = (TLorentzVector(momentum) *= frames.toHadronRest);
+      thetaGamma = p.Theta();
+      ptVsGamma =  p.Pt();
+      // Calculate phi angle around virtual photon according
+      // to the HERMES convention.
+      phiPrf = computeHermesPhiH(p, frames.leptonPrf, frames.bosonPrf);
+      // Feynman x with xF = 2 * pz / W in the boson-hadron CM frame.
+      const TLorentzVector hcm = (TLorentzVector(momentum) *= frames.toHcm);
+      xFeynman = 2. * hcm.Pz() / frames.W;
+
+      thetaGammaHCM = hcm.Theta();
+      ptVsGammaHCM =  hcm.Pt();
+    }  // if
 
     // Determine the PDG code of the parent particle, if the particle
     // has a parent and the parent is present in the particle array.
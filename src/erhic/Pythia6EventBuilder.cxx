@@ -115,6 +115,7 @@ EventPythia* Pythia6EventBuilder::BuildEvent() {
     particle->SetEvent(event.get());
     event->AddLast(particle.get());
   }  // for
+  event->ResolveScatteredLepton();
   // Compute derived event kinematics
   DisKinematics* nm = LeptonKinematicsComputer(*event).Calculate();
   DisKinematics* jb = JacquetBlondelComputer(*event).Calculate();
@@ -142,8 +143,9 @@ EventPythia* Pythia6EventBuilder::BuildEvent() {
     event->SetELeptonInNuclearFrame(l.E());
     event->SetEScatteredInNuclearFrame(s.E());
   }  // if
+  const EventFrames frames(*event);
   for (unsigned i(0); i < event->GetNTracks(); ++i) {
-    event->GetTrack(i)->ComputeEventDependentQuantities(*event);
+    event->GetTrack(i)->ComputeEventDependentQuantities(*event, frames);
   }  // for
   // Restore Object count
   // See example in $ROOTSYS/test/Event.cxx
@@ -1,23 +1,48 @@
 /**
    \file
-   Defines the main TreeToHepMC function.
+   Defines the main TreeToHepMC function, and BuildHepMC for direct
+   conversion of text files.
 
    \author    Kolja Kauder
    \date      2021-07-07
    \copyright 2021 Brookhaven National Lab
 */
 
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <iostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
 #include <TString.h>
 #include <TSystem.h>
 #include <TBranch.h>
-#include <TLeaf.h>
+#include <TClass.h>
+#include <TDataMember.h>
+#include <TDataType.h>
+#include <TList.h>
+#include <TMemFile.h>
+#include <TObjString.h>
+#include <TRealData.h>
+#include <TROOT.h>
 #include <TDatabasePDG.h>
 
+#include "eicsmear/erhic/EventFactory.h"
 #include "eicsmear/erhic/Forester.h"
 #include "eicsmear/erhic/File.h"
+#include "eicsmear/gzstream.h"
+#include "eicsmear/smear/EventSmear.h"
+#include "eicsmear/smear/ParticleMCS.h"
 
 #include "HepMC3/GenEvent.h"
 #include "HepMC3/GenVertex.h"
@@ -30,8 +55,6 @@
 #include "HepMC3/WriterRoot.h"
 #include "HepMC3/WriterRootTree.h"
 
-#include <map>
-
 using std::cout;
 using std::cerr;
 using std::endl;
@@ -46,68 +69,1162 @@ using HepMC3::GenVertexPtr;
 using HepMC3::GenCrossSection;
 using HepMC3::GenCrossSectionPtr;
 
-// see include/eicsmear/functions.h for declaration and default values
+namespace {
 
 /**
-   This function converts our tree format to HepMC3
-   It would be better to skip the ROOT step, but that
-   would require a lot of duplication and/or refactorization
+   An event-wise variable exported as a HepMC3 attribute, classified
+   once before the event loop so that the loop only has to read its
+   value at a fixed offset in the event.
 */
-Long64_t TreeToHepMC(const std::string& inputFileName,
-                     const std::string& outputDirName,
-                     Long64_t maxEvent,
-                     const erhic::HepMC_outtype outtype) {
+struct EventAttribute {
+  enum Type { kWeight, kInt, kLong, kDouble };
+  std::string name;
+  Type type;
+  Long_t offset;
+  EDataType data;
+};
+
+/**
+   Generator-specific settings shared by all events of a conversion.
+*/
+struct ConversionContext {
+  bool beaglemode;
+  bool legacymilou;
+  bool djangoh;
+  double crossSection;
+  double crossSectionError;
+  // Need to enter event loop to determine, but warn only once
+  std::atomic<bool> milouwarn;
+  // Event-wise variables to export from the Monte Carlo and smeared events
+  std::vector<EventAttribute> mcAttributes;
+  std::vector<EventAttribute> smearedAttributes;
+};
+
+/**
+   Split a whitespace- or comma-separated list of names.
+*/
+std::set<std::string> parseNameList(const std::string& names) {
+  std::string list(names);
+  std::replace(list.begin(), list.end(), ',', ' ');
+  std::istringstream stream(list);
+  std::set<std::string> result;
+  std::string name;
+  while (stream >> name) {
+    result.insert(name);
+  }  // while
+  return result;
+}
+
+/**
+   Returns the value of a basic type stored at the address.
+*/
+double readValue(const char* address, EDataType type) {
+  switch (type) {
+    case kShort_t: return *reinterpret_cast<const Short_t*>(address);
+    case kUShort_t: return *reinterpret_cast<const UShort_t*>(address);
+    case kInt_t: return *reinterpret_cast<const Int_t*>(address);
+    case kUInt_t: return *reinterpret_cast<const UInt_t*>(address);
+    case kLong_t: return *reinterpret_cast<const Long_t*>(address);
+    case kULong_t: return *reinterpret_cast<const ULong_t*>(address);
+    case kLong64_t: return *reinterpret_cast<const Long64_t*>(address);
+    case kULong64_t: return *reinterpret_cast<const ULong64_t*>(address);
+    case kFloat_t:
+    case kFloat16_t: return *reinterpret_cast<const Float_t*>(address);
+    case kDouble_t:
+    case kDouble32_t: return *reinterpret_cast<const Double_t*>(address);
+    default: return 0.;
+  }  // switch
+}
+
+/**
+   Returns true if the member records how the event is stored rather
+   than being a generator variable, so is never exported. Each event
+   class lists its own bookkeeping members, which are only skipped for
+   that class, as generator variables may have the same names.
+*/
+bool isBookkeeping(TDataMember* member, const std::string& name) {
+  const TClass* owner = member->GetClass();
+  return (owner == erhic::EventMC::Class() &&
+          erhic::EventMC::IsBookkeepingMember(name)) ||
+         (owner == Smear::Event::Class() &&
+          Smear::Event::IsBookkeepingMember(name));
+}
+
+/**
+   Go through the event-wise variables of the event class and decide
+   once how each one is exported.
+   These are the same as the event-wise leaves of an EICTree, but taken
+   from the class dictionary so the same list serves events read from a
+   tree and events built directly from a text file.
+   Particles and bookkeeping members are skipped, generator variables
+   are upconverted to int, long or double attributes. The weight is always kept.
+   If selected is non-empty, only attributes named in it are exported.
+   Selected names that are not found are reported if warn is true.
+*/
+std::vector<EventAttribute> classifyAttributes(TClass* eventClass,
+                                               const std::set<std::string>& selected,
+                                               bool warn = true) {
+  std::vector<EventAttribute> attributes;
+  std::set<std::string> found;
+  eventClass->BuildRealData();
+  TIter next(eventClass->GetListOfRealData());
+  while (TRealData* realData = static_cast<TRealData*>(next())) {
+    TDataMember* member = realData->GetDataMember();
+    const std::string name = realData->GetName();
+    // Only plain, persistent numbers - no particles, objects or arrays
+    if (!member || !member->IsPersistent() || !member->IsBasic()
+        || member->IsaPointer() || member->GetArrayDim() > 0
+        || name.find('.') != std::string::npos
+        || name.compare(0, 9, "particles") == 0
+        || isBookkeeping(member, name)) continue;
+    TDataType* dataType = member->GetDataType();
+    if (!dataType) continue;
+    EventAttribute attribute = {
+      name, EventAttribute::kDouble, realData->GetThisOffset(),
+      static_cast<EDataType>(dataType->GetType())
+    };
+    // Catch weight
+    if (name == "weight") {
+      attribute.type = EventAttribute::kWeight;
+      attributes.push_back(attribute);
+      continue;
+    }  // if
+    if (!selected.empty()) {
+      if (selected.count(name) == 0) continue;
+      found.insert(name);
+    }  // if
+    // Store generator variables - upconvert types
+    switch (attribute.data) {
+      case kLong_t:
+      case kULong_t:
+      case kLong64_t:
+      case kULong64_t:
+        attribute.type = EventAttribute::kLong;
+        break;
+      case kShort_t:
+      case kUShort_t:
+      case kInt_t:
+      case kUInt_t:
+        attribute.type = EventAttribute::kInt;
+        break;
+      case kFloat_t:
+      case kFloat16_t:
+      case kDouble_t:
+      case kDouble32_t:
+        attribute.type = EventAttribute::kDouble;
+        break;
+      default:
+        // Ignore everything else, e.g. bool and char. The latter can be a
+        // char type or a C string. I'm not aware of either use case,
+        // so don't waste time to differentiate
+        continue;
+    }  // switch
+    attributes.push_back(attribute);
+  }  // while
+  for (std::set<std::string>::const_iterator i = selected.begin();
+       i != selected.end(); ++i) {
+    if (warn && found.count(*i) == 0) {
+      cerr << "Warning: requested attribute " << *i
+           << " is not an exportable event variable - ignored" << endl;
+    }  // if
+  }  // for
+  return attributes;
+}
+
+/**
+   Attach the values of the classified variables of the event
+   to the HepMC3 event.
+*/
+void fillAttributes(const std::vector<EventAttribute>& attributes,
+                    const erhic::VirtualEvent& event,
+                    GenEvent& hepmc3evt) {
+  // Offsets are relative to the start of the complete event object
+  const char* base = static_cast<const char*>(dynamic_cast<const void*>(&event));
+  for (std::vector<EventAttribute>::const_iterator i = attributes.begin();
+       i != attributes.end(); ++i) {
+    const double value = readValue(base + i->offset, i->data);
+    switch (i->type) {
+      case EventAttribute::kWeight:
+        hepmc3evt.weights().clear();
+        hepmc3evt.weights().push_back(value);
+        break;
+      case EventAttribute::kLong:
+        hepmc3evt.add_attribute(i->name, std::make_shared<HepMC3::LongAttribute>(value));
+        break;
+      case EventAttribute::kInt:
+        hepmc3evt.add_attribute(i->name, std::make_shared<HepMC3::IntAttribute>(value));
+        break;
+      case EventAttribute::kDouble:
+        hepmc3evt.add_attribute(i->name, std::make_shared<HepMC3::DoubleAttribute>(value));
+        break;
+    }  // switch
+  }  // for
+}
+
+/**
+   Bits of the "smeared" particle attribute, recording which quantities
+   of a smeared particle were measured by the detector.
+*/
+enum SmearedQuantity {
+  kSmearedE = 1, kSmearedP = 2, kSmearedTheta = 4, kSmearedPhi = 8, kSmearedId = 16
+};
+
+int smearedQuantities(const Smear::ParticleMCS& particle) {
+  int flags(0);
+  if (particle.IsESmeared()) flags |= kSmearedE;
+  if (particle.IsPSmeared() || particle.IsPtSmeared() || particle.IsPzSmeared()
+      || particle.IsPxSmeared() || particle.IsPySmeared()) flags |= kSmearedP;
+  if (particle.IsThetaSmeared()) flags |= kSmearedTheta;
+  if (particle.IsPhiSmeared()) flags |= kSmearedPhi;
+  if (particle.IsIdSmeared()) flags |= kSmearedId;
+  return flags;
+}
+
+/**
+   Four-momentum of a smeared particle, using only what was measured.
+   A measured momentum is used as is. Without one (calorimeter only),
+   the particle is taken as massless along the smeared direction.
+   Without a measured energy, it is computed from the momentum and mass.
+   Returns false if neither energy nor momentum were measured.
+*/
+bool smearedFourVector(const Smear::ParticleMCS& particle, double mass,
+                       FourVector& pv) {
+  const int flags = smearedQuantities(particle);
+  if (!(flags & (kSmearedE | kSmearedP))) {
+    return false;
+  }  // if
+  double px = particle.GetPx();
+  double py = particle.GetPy();
+  double pz = particle.GetPz();
+  double e = particle.GetE();
+  if (!(flags & kSmearedP)) {
+    const double theta = particle.GetTheta();
+    const double phi = particle.GetPhi();
+    px = e * std::sin(theta) * std::cos(phi);
+    py = e * std::sin(theta) * std::sin(phi);
+    pz = e * std::cos(theta);
+  } else if (!(flags & kSmearedE)) {
+    e = std::sqrt(px * px + py * py + pz * pz + mass * mass);
+  }  // if
+  pv = FourVector(px, py, pz, e);
+  return true;
+}
+
+/**
+   Look up the parent of a particle via its index in the event.
+   Unlike ParticleMC::GetParent() this doesn't go through the particle's
+   TRef to the event. All events in a file share the same object ID, so
+   with several events in memory at once, as in the parallel conversion,
+   the TRef may resolve to another thread's event.
+*/
+const Particle* parentOf(const erhic::EventMC* inEvent,
+                         const Particle* inParticle) {
+  const UShort_t index = inParticle->GetParentIndex();
+  if (index < 1 || index > inEvent->GetNTracks()) {
+    return NULL;
+  }  // if
+  return inEvent->GetTrack(index - 1);
+}
+
+/**
+   Convert one event of our tree format to HepMC3.
+   The particle graph of the input event is repaired in place.
+   If the matching smeared event is given, final-state particles carry
+   their smeared kinematics instead, and undetected ones are dropped.
+   Returns 0 on success, -1 if the event cannot be converted.
+*/
+int convertEvent(erhic::EventMC* inEvent, Long64_t i,
+                 ConversionContext& context, GenEvent& hepmc3evt,
+                 const Smear::Event* smeared = NULL) {
+  hepmc3evt.set_event_number(i);
+  hepmc3evt.weights().clear();
+  hepmc3evt.weights().push_back(1.0);
+
+  // attach cross section in pb
+  GenCrossSectionPtr xsec = std::make_shared<GenCrossSection>();
+  xsec->set_cross_section( context.crossSection, context.crossSectionError);
+  hepmc3evt.set_cross_section(xsec);
+
+  // Multiple parents seem to only be in BeAGLE
+  // and somewtimes there seem to be exactly 2 parents, sometimes a range like for daughters.
+  // I cannot differentiate between the two, and for the exact case, it erroneously gives the impression
+  // of a large range, like 17 -- 254 which will wreak havoc on the graph.
+  // "Remedy": pre-burner
+  // - All intermediate non-beam particles have the exchange boson as their mother.
+  // - hadrons and leptons with status 2:
+  //   - if they have exactly one parent with status 2 (decay chain),
+  //     maintain that parent
+  //   - otherwise, they're the start of a decay, treat like a final particle
+  // - hadrons and leptons with status 1:
+  //   - if they have exactly one parent with status 2 (decay product),
+  //     maintain that parent
+  //   - otherwise, they're final, attach to the single final particle vertex
+  // - When the graph gets created, we'll separate and add another dummy node to connect
+  //   the boson to via all non-finals
+  //   and the finals one as out-going edges
+  // --> Incorrect vertex information (but I don't see it correctly in the original anyway)
+
+  // Use a special index to refer to the dummy vertex
+  // Should be ushort_max, but keep it flexible
+  auto beagle_final_index = std::numeric_limits< decltype(inEvent->GetTrack(0)->GetParentIndex())>::max();
   
-  // Make sure this is a root file, 
-  if ( !TString(inputFileName).EndsWith(".root", TString::kIgnoreCase) ){
-    cerr << "Warning: " << inputFileName << " does not end with .root" << endl;
+  if ( context.beaglemode ){
+    auto bosonindex=inEvent->ExchangeBoson()->GetIndex();
+    // IMPORTANT! ScatteredLepton() will segfault after we change its lineage!
+    // Last time we can use it.
+    auto scatteredindex = inEvent->ScatteredLepton()->GetIndex();
+    
+    for( unsigned int t=0; t<inEvent->GetNTracks(); ++t) {
+      Particle* inParticle = inEvent->GetTrack(t);
+      auto myindex = inParticle->GetIndex();
+      
+      // special cases first
+      // beam
+      if ( myindex==inEvent->BeamLepton()->GetIndex()
+           || myindex==inEvent->BeamHadron()->GetIndex()
+           ) continue;
+
+      // Scattered lepton. It may well not be a direct descendant, but we'll stuff that
+      // intermediate history in with the rest. But the beam needs a final lepton daughter
+      if ( myindex==scatteredindex ){
+        inParticle->SetParentIndex( inEvent->BeamLepton()->GetIndex() );
+        inParticle->SetParentIndex1( 0 );
+        inParticle->SetChild1Index( 0 );
+        inParticle->SetChildNIndex( 0 );
+        continue;
+      }
+      
+      // boson
+      if ( myindex==bosonindex ){
+        inParticle->SetChild1Index( 5 );
+        inParticle->SetChildNIndex( inEvent->GetNTracks() );
+        continue;
+      }
+      
+      auto pdg = TDatabasePDG::Instance()->GetParticle( inParticle->Id() );
+      // Note: ROOT's table is outdated and doesn't catch, e.g. Delta baryons 
+      switch (inParticle->GetStatus() ){
+      case 2 :
+        // mis-labeled as 2?
+        if ( !pdg ){ // ignore unknown particles (e.g. pomerons, ions)
+          inParticle->SetStatus(12);
+        } else if ( !TString(pdg->ParticleClass()).Contains("Lepton")
+                    && !TString(pdg->ParticleClass()).Contains("Baryon")
+                    && !TString(pdg->ParticleClass()).Contains("Meson")
+                    ){
+          inParticle->SetStatus(12);
+          inParticle->SetParentIndex( bosonindex );
+          inParticle->SetParentIndex1( 0 );
+          
+          inParticle->SetChild1Index( beagle_final_index ); // not needed but logically true
+          inParticle->SetChildNIndex( 0 );   
+        } else{
+          // properly labeled as 2. We better have children
+          if ( inParticle->GetChild1Index() == 0 ){
+            std::cout << "Processing event " << i << std::endl;
+            std::cout << "Processing track " << t << " with index " << inParticle->GetIndex() << std::endl;
+            std::cout << "I am a hadron or lepton with status 2, but I do not have children. "  << std::endl;
+            return -1;
+          }
+          // We better have exaxctly one parent
+          // Alas, this too does happen
+          if ( inParticle->GetParentIndex1()!=0 ){
+            std::cout << "Processing event " << i << std::endl;
+            std::cout << "Processing track " << t << " with index " << inParticle->GetIndex() << std::endl;
+            std::cout << "Warning: I am a hadron or lepton with status 2, but I have too many parents. "  << std::endl;
+            std::cout << "Discarding the older one"  << std::endl;
+            // std::cout << inParticle->GetParentIndex() << "  " << inParticle->GetParentIndex1() << endl;
+            inParticle->SetParentIndex( std::max ( inParticle->GetParentIndex(), inParticle->GetParentIndex1() ) );
+            inParticle->SetParentIndex1( 0 );
+          }
+          auto mom = parentOf(inEvent, inParticle);
+          if ( !mom ){
+            std::cout << "Processing event " << i << std::endl;
+            std::cout << "Processing track " << t << " with index " << inParticle->GetIndex() << std::endl;
+            std::cout << "I am a hadron or lepton with status 2, but I have no parents. "  << std::endl;
+            return -1;
+          }
+          // status of mother?
+          if ( mom->GetStatus() == 1 ){
+            std::cout << "Processing event " << i << std::endl;
+            std::cout << "Processing track " << t << " with index " << inParticle->GetIndex() << std::endl;
+            std::cout << "I am a hadron or lepton with status 2, but my mother is final. "  << std::endl;
+            return -1;
+          }
+          if ( mom->GetStatus() != 2 ){
+            // We're the beginning of a decay, attach to "final" vertex
+            inParticle->SetParentIndex( beagle_final_index );
+            inParticle->SetParentIndex1( 0 );
+          }       
+        }
+        break;
+      case 1:
+        {
+          // final particles
+          auto mom = parentOf(inEvent, inParticle);
+          if ( mom ){
+            // status of mother?
+            if ( mom->GetStatus() == 2 ){
+              // do nothing, we keep this mother as ours
+              inParticle->SetChild1Index( 0 );
+              inParticle->SetChildNIndex( 0 );
+              break;
+            }
+          }
+          // default behavior for finals
+          inParticle->SetParentIndex( beagle_final_index );
+          inParticle->SetParentIndex1( 0 );
+          
+          inParticle->SetChild1Index( 0 );
+          inParticle->SetChildNIndex( 0 );
+          break;
+        }
+      default : 
+        // everything else
+        inParticle->SetParentIndex( bosonindex );
+        inParticle->SetParentIndex1( 0 );
+        
+        inParticle->SetChild1Index( beagle_final_index ); // not needed but logically true
+        inParticle->SetChildNIndex( 0 );
+        break;
+      }
+    }
+  } // if ( context.beaglemode )
+
+  if ( context.legacymilou && inEvent->BeamLepton()->GetChild1Index()==0 ){
+    if ( !context.milouwarn.exchange(true) ){
+      cout << "Warning: Trying to repair legay Milou's parentage issues." << endl;
+      cout << endl;
+    }
+
+    // e
+    inEvent->GetTrack(1-1)->SetChild1Index(3);
+    inEvent->GetTrack(1-1)->SetChildNIndex(4);
+
+    // p
+    inEvent->GetTrack(2-1)->SetChild1Index(6);
+    inEvent->GetTrack(2-1)->SetChildNIndex(0);
+
+    // e'
+    inEvent->GetTrack(3-1)->SetParentIndex(1);
+    inEvent->GetTrack(3-1)->SetChild1Index(0);
+    inEvent->GetTrack(3-1)->SetChildNIndex(0);
+
+    // gamma*
+    inEvent->GetTrack(4-1)->SetParentIndex(1);
+    inEvent->GetTrack(4-1)->SetChild1Index(5);
+    inEvent->GetTrack(4-1)->SetChildNIndex(0);
+    
+    // gamma
+    inEvent->GetTrack(5-1)->SetParentIndex(4);
+    inEvent->GetTrack(5-1)->SetChild1Index(0);
+    inEvent->GetTrack(5-1)->SetChildNIndex(0);
+    
+    // p'
+    inEvent->GetTrack(6-1)->SetParentIndex(2);
+    inEvent->GetTrack(6-1)->SetChild1Index(0);
+    inEvent->GetTrack(6-1)->SetChildNIndex(0);
+
+    // ISR 
+    if (inEvent->GetTrack(7-1) ){ 
+      inEvent->GetTrack(7-1)->SetParentIndex(0);
+      inEvent->GetTrack(7-1)->SetChild1Index(0);
+      inEvent->GetTrack(7-1)->SetChildNIndex(0);
+    }
   }
   
-  // Open the input file and get the Monte Carlo tree from it.
-  // Complain and quit if we don't find the file or the tree.
-  TFile inFile(inputFileName.c_str(), "READ");
-  if (!inFile.IsOpen()) {
-    std::cerr << "Unable to open " << inputFileName << std::endl;
-  }  // if
-  TTree* mcTree(NULL);
-  // TODO: Extend to smeared trees
-  inFile.GetObject("EICTree", mcTree);
-  if (!mcTree) {
-    std::cerr << "Unable to find EICTree in " << inputFileName << std::endl;
-    return 1;
+  // First, fix sloppily implemented mother-daughter relations
+  // Not done for BeAGLE, because of the special vertex
+  if ( !context.beaglemode ){
+    for( unsigned int t=0; t<inEvent->GetNTracks(); ++t) {
+      const Particle* inParticle = inEvent->GetTrack(t);
+      
+      // Do my children know me?
+      auto myindex = inParticle->GetIndex();
+      // std::cout << "Processing track " << t << " with index " << myindex << std::endl;
+      auto c1 = inParticle->GetChild1Index();
+      auto cN = inParticle->GetChildNIndex();
+      if ( cN==0 ) cN =c1;
+      if ( c1>cN ) std::swap(c1,cN);
+      if ( c1>0 ) {
+        
+        //In a small number of Djangoh events, the particle list will be incomplete.
+        //A particle will have a child which is not included in the particle list.
+        bool djangohproblem = false;
+
+        for ( UShort_t c = c1; c<=cN; ++c ){ // sigh. index starts at 1, tracks at 0;
+          Particle* child = inEvent->GetTrack(c-1);
+          if ( !child ) {
+            cerr << "Trying to access a non-existant child" << endl;
+            cerr << "Event is " << i << "  Problem index is " << c << endl;
+            cerr << "If this is not a djangoh file, please contact the eic-smear developers"<<endl;
+            djangohproblem = true;
+            break;
+          }
+ 
+          // std::cout << "     Processing child with index " << child->GetIndex() << std::endl;
+          auto p1 = child->GetParentIndex();
+          auto pN = child->GetParentIndex1();
+          if ( p1>pN ) std::swap(p1,pN);
+          if ( p1==0 && pN==0 ){ // child erroneously believes to be motherless
+            child->SetParentIndex( myindex );
+          } else if ( p1==0 ) { // We are the only parent, is it correctly assigned?
+            if ( pN != myindex ){
+              // Nothing we can do, e.g. pythia allows multiple parenthood but lacks a way to describe that, see:
+              // 12     12       2101        5       18       31
+              // ...
+              // 16     11          2       10       18       31
+              // ...
+              // 26      1       -211       12        0        0
+              // 27      1        211       16        0        0
+              // cerr << "My child thinks its mother is " << pN << ", but it should be " << myindex << endl;
+              // return -1;
+            }
+          } else {
+            // If multiple parents come from non-BeAGLE MC's revisit
+            cout << "Found more than one parent in a non-BeAGLE file. Please contact the authors." << endl;
+            return -1;
+            // We have more than one parent, are they correct?
+            // This would be the logic if p1 and pN _span_
+            // if ( myindex < p1 || myindex > pN ){
+            //   std::cout << "Processing event " << i << std::endl;
+            //   std::cout << "Processing track " << t << " with index " << myindex << std::endl;
+            //   std::cout << "     Processing child with index " << child->GetIndex() << std::endl;
+            //   cerr << "My child thinks its mothers range between " << p1 << " and " << pN
+            //           << ", but I am " << myindex << endl;
+            //   // return -1;
+            // }
+            // Instead, it seems that BeAGLE (mostly?) assumes this to mean
+            // exactly two parents, usually far apart in index
+            // if ( myindex != p1 && myindex != pN ){
+            //   // Problematic situation in BeAGLE:
+            //   //  I       S        PID       P1       P2       D1       D2
+            //   // ==========================================================
+            //   //  17     18       2112        0        0      260      261
+            //   // ...
+            //   // 254     19        111       41      244      260      261
+            //   // 255      2       2212       41      244      260      261
+            //   // ...
+            //   // 260     16       2112       17      254        0        0
+            //   // 261     16       2212       17      254        0        0
+            // }
+          }
+        }
+        if(djangohproblem) continue;
+      }
+      // Do my parents acknowledge me?
+      auto p1 = inParticle->GetParentIndex();
+      auto pN = inParticle->GetParentIndex1();
+      if ( p1>pN ) std::swap(p1,pN);
+      if ( p1==0 ) p1 =pN;
+      // Do all my parents acknowledge me?
+      if (pN > 0){
+        for ( unsigned int p = p1; p<=pN ; ++p ){
+          Particle* parent = inEvent->GetTrack(p-1);
+          auto pc1 = parent->GetChild1Index();
+          auto pcN = parent->GetChildNIndex();
+          if ( pc1>pcN ) std::swap(pc1,pcN);
+          if ( pc1 > myindex ){
+            // cout << "hello1" << endl;
+            parent->SetChild1Index( myindex );
+          }
+          if ( pcN < myindex ){
+            // cout << "hello2" << endl;
+            parent->SetChildNIndex( myindex );
+          }
+        }
+      }      
+    }
+  } // graph repair for !context.beaglemode
+    
+  // Perform consistency checks and collect particles
+  std::vector<GenParticlePtr> hepevt_particles;
+  hepevt_particles.reserve( inEvent->GetNTracks() );
+  // Final-state particles not seen by the detector, when writing smeared events
+  std::vector<char> undetected( inEvent->GetNTracks(), 0 );
+  for( unsigned int t=0; t<inEvent->GetNTracks(); ++t) {
+    const Particle* inParticle = inEvent->GetTrack(t);
+    // Particles with status 1 cannot have children
+    auto status = inParticle->GetStatus();
+    if ( status==1 ){
+      if (inParticle->GetNChildren() != 0 ){
+        cout << "Status is 1 but we have children?" << endl;
+        inParticle->Print();
+      } 
+    }
+    
+    // // All child-less particles should have a "safe" status (like 21), best would be 1
+    // if (inParticle->GetNChildren() == 0 ){
+    //        if ( status !=1 && status !=21 ){
+    //          cerr << "Status is " << status << " but we have no children?" << endl;
+    //          inParticle->Print();
+    //        }
+    // }
+
+    // // Mother-less particles should be the beam only
+    // Alas, that's not the case :-/
+    // if ( t>1 && inParticle->GetParentIndex()==0 && inParticle->GetParentIndex1() ==0 ){
+    //        cout << "Event: " << i << " -- We have no mother" << endl;
+    //        inParticle->Print();
+    // }
+
+    FourVector pv = FourVector( inParticle->GetPx(), inParticle->GetPy(), inParticle->GetPz(),inParticle->GetE() );
+    int statusHepMC = inParticle->GetStatus();
+    // We should use only 1 (final), 2 (decayed hadron or lepton), 4 (beam), and >10, <=200 (anything else)
+    // This may need to be decided on a generator-by-generator basis
+    // We can assume final particles already have status 1, because that's
+    // what EventMC::FinalState uses (and it's not overridden in existing classes)
+
+    // Catch decayed leptons and hadrons
+    // doesn't work for BeAGLE
+    if ( ! context.beaglemode && t>3 ){     // Ignore the beam
+      if (inParticle->GetNChildren() != 0 ){ // ignore final particles
+        auto pdg = TDatabasePDG::Instance()->GetParticle( inParticle->Id() );
+        if ( pdg ){ // ignore unknown particles (e.g. pomerons, ions)
+          if ( TString(pdg->ParticleClass()).Contains("Lepton")
+               || TString(pdg->ParticleClass()).Contains("Baryon")
+               || TString(pdg->ParticleClass()).Contains("Meson")
+               ){
+            // Now our status should be 2!
+            // cout << statusHepMC << endl;
+            // inParticle->Print();
+            statusHepMC = 2;
+          }
+        }
+      }
+    }
+
+    // // catch DJANGOH trying to assign 4 to non beams
+    // if ( t>3  && (statusHepMC == 4 ) ){
+    //          cout << "Naughty Djangoh" << endl;
+    //          statusHepMC=14;
+    // }
+    
+    // force everything else to be legal
+    if ( statusHepMC != 1 && statusHepMC != 2 && statusHepMC != 4 ){
+      while ( statusHepMC <=10 ) statusHepMC+=10;
+      while ( statusHepMC >200 ) statusHepMC-=10;
+    }
+
+    //In the Pythia 6 convention, status=4 indicates a particle which could
+    //have decayed but did not within the allowed volume around the vertex.
+    //We adjust these particles to have status=1 in the HepMC file to avoid
+    //confusion with the beam particles.
+    if( statusHepMC == 4) statusHepMC = 1;
+
+    // Swap in the smeared kinematics of final-state particles.
+    // The beams are always kept as they are.
+    int pid = inParticle->Id();
+    if ( smeared && statusHepMC == 1
+         && inParticle != inEvent->BeamLepton() && inParticle != inEvent->BeamHadron() ){
+      const Smear::ParticleMCS* smearedParticle = smeared->GetTrackFromTruth(t);
+      if ( smearedParticle && smearedFourVector( *smearedParticle, inParticle->GetM(), pv ) ){
+        if ( smearedParticle->IsIdSmeared() ) pid = smearedParticle->Id();
+      } else {
+        undetected.at(t) = 1;
+      }
+    }
+
+    // Create GenParticle
+    hepevt_particles.push_back( std::make_shared<GenParticle>( pv, pid, statusHepMC ));
+    hepevt_particles.back()->set_generated_mass( inParticle->GetM() );
+
   }
-  erhic::EventMC* inEvent(NULL);
-  mcTree->SetBranchAddress("event",&inEvent);
 
-  // Get generator name
-  TClass* branchClass = TClass::GetClass(mcTree->GetBranch("event")->GetClassName());
-  TString generatorname = branchClass->GetName();
-  if (branchClass->InheritsFrom("erhic::EventDis")) {
-    generatorname.ReplaceAll("erhic::Event","");
+  // Build the event
+  // beam particles
+  // --------------
+  // Default is 1 = e-, 2 = hadron, 3 = scattered e-, 4 = exchange boson
+  // But this can (and does) differ, especially for the scattered lepton
+  // As always, be aware of Fortran starting to count at 1
+  // Vertex: We don't keep track of time
+  auto lepton=inEvent->BeamLepton();
+  int index_lepton = lepton->GetIndex();
+  if ( index_lepton !=1 ) std::cout << "Warning: Found BeamLepton at " << index_lepton << endl;
+  auto hep_lepton = hepevt_particles.at( index_lepton-1);
+  hep_lepton->set_status(4);
+
+  auto boson=inEvent->ExchangeBoson();
+  int index_boson = boson->GetIndex();
+  // This happens in Sartre who puts the boson at 3
+  // if ( index_boson !=4 ) std::cout << "Warning: Found ExchangeBoson at " << index_boson << endl;
+  // if ( boson->GetParentIndex() != index_lepton && boson->GetParentIndex1() != index_lepton ){
+  //   // This is common for Sartre, and any others that treat the boson like the beam
+  //   std::cout << "Warning: ExchangeBoson doesn't recognize the beam as its mother " << endl;
+  // }
+  auto hep_boson = hepevt_particles.at( index_boson-1);
+  // if needed / desired, could force hep_boson->set_status(4);
+
+  GenVertexPtr v_lepton = std::make_shared<GenVertex>();
+  v_lepton->add_particle_in  (hep_lepton);
+  v_lepton->add_particle_out (hep_boson);
+  hepmc3evt.add_vertex(v_lepton);
+
+  auto hadron=inEvent->BeamHadron();
+  int index_hadron = hadron->GetIndex();
+  if ( index_hadron !=2 ) std::cout << "Warning: Found BeamHadron at " << index_hadron << endl;
+  auto hep_hadron = hepevt_particles.at( index_hadron-1);
+  hep_hadron->set_status(4);
+  GenVertexPtr v_hadron = std::make_shared<GenVertex>();
+
+  v_hadron->add_particle_in (hep_hadron);
+  hepmc3evt.add_vertex(v_hadron);
+
+  // For Beagle, use
+  //                  
+  //  e      e'               
+  //   \v1__/                 i1      f1
+  //         \_gamma        /    \   /
+  //                 \ _v2_/__i2__ v3__f2
+  //                 /     \      / \                (*)
+  //             proton     \iN /    \fN
+  //
+  // where i1, .., iN are intermediate (!=1) and f1,..fN are final
+  // v2 == v_hadron, v3 == v_beagle_final
+
+  // Addendum: BeAGLE does support hadron/lepton decay. Attach the root to v3,
+  // and keep their children, e.g.:
+  // 
+  //   v2_/__i2__ v3__J/psi__e
+  //                \      \                          (*)
+  //                 \fN    e
+  //
+  // (But also keep decay chains)
+  // (*) comment lines ending in "\" generate compiler warnings 
+  
+  // Dummy to act as a catchall for intermediary particles in beagle
+  GenVertexPtr v_beagle_final = std::make_shared<GenVertex>();
+  if ( context.beaglemode ){
+    v_hadron->add_particle_in(hep_boson);
+    hepmc3evt.add_vertex( v_beagle_final );
+    // We don't have a connection yet, so in the pathological case
+    // that there are no non-final particles at all, this vertex floats free.
+    // That's too unlikely to occur to build in a fail-safe now
+  }
+  
+  // Now work our way through the remaining particles
+  // - Attach each particle that has a mother to their end vertex
+  // ---> Create / overwrite production vertex in the process.
+  //      If it's inconsistent, there's not much we can do
+  // - attach motherless particles to the exchange boson
+  // ---> In that case, leave the production vertex location in peace
+  // ---> Also note that ISR photons are motherless and thus
+  //      get attached to the exchange boson as well
+  // Topological order should just translate to the fact that
+  // children always have a higher index than their parents
+
+  // Note: Multiple parents would wreak havoc here - have to handle BeAGLE differently
+  for( unsigned int t=0; t<inEvent->GetNTracks(); ++t) {
+    const Particle* inParticle = inEvent->GetTrack(t);
+
+    // Skip what we already have, and what the detector didn't see
+    int index = inParticle->GetIndex();
+    if ( index==index_lepton || index==index_boson || index==index_hadron) continue;
+    if ( undetected.at( index-1 ) ) continue;
+    auto hep_in = hepevt_particles.at( index-1);
+    // auto hep_mom = hep_boson;
+    auto hep_mom = hep_hadron;
+    int momindex = inParticle->GetParentIndex();
+    auto statusHepMC = inParticle->GetStatus();
+
+    //For Djangoh events which fail to hadronize, shift the parent of the
+    //final-state parton from the incoming electron beam to th hadron beam     
+    if (context.djangoh){
+      if( statusHepMC==1 && momindex==1 &&
+          (abs(inParticle->Id())==1 || abs(inParticle->Id())==2 || abs(inParticle->Id())==3 || 
+           abs(inParticle->Id())==90 || inParticle->Id()==91 || inParticle->Id()==92) ){ 
+        momindex+=1;
+      }
+    }
+    
+    // suppress all the intermediate nucleons
+    // this may be worth doing anyway  just to reduce filesize
+    // if ( context.beaglemode && statusHepMC==3 ) continue;
+    // if ( context.beaglemode && statusHepMC==14 ) continue;
+    // if ( context.beaglemode && statusHepMC==18 ) continue;
+    // if ( context.beaglemode && statusHepMC==12 ) continue;
+    // This is purely for legibility, these particles should stay!
+    // note: 80000 are lighter ions, without specification
+    // if ( context.beaglemode && statusHepMC==1 && momindex == beagle_final_index
+    //           && ( hep_in->pid() == 2112 || hep_in->pid() == 2212 || hep_in->pid() == 80000 ) ) continue;
+    
+    // beagle finals 
+    if ( momindex == beagle_final_index ){
+      v_beagle_final->add_particle_out(hep_in);
+      continue;
+    }
+
+    // beagle intermediates
+    // out will be handled, but need to attach as incoming
+    if ( context.beaglemode && statusHepMC!=1 && statusHepMC!=2  ){
+      v_beagle_final->add_particle_in(hep_in);
+    }
+    
+    // Mother?
+    if ( momindex > 0 ){
+      hep_mom = hepevt_particles.at( momindex-1);
+    }
+    
+    // Does mom have an end vertex yet?
+    auto momend = hep_mom->end_vertex();
+    if (!momend) {
+      momend = std::make_shared<GenVertex>();
+      momend->add_particle_in(hep_mom);
+      hepmc3evt.add_vertex(momend);
+    }
+
+    momend->add_particle_out(hep_in);
+      
+    // update prod vertex?
+    if ( momindex > 1){
+      auto vnew = inParticle->GetVertex();
+      
+      // recalcuate vertex time using: dt = (SV-PV).Mag()/(pMother/eMother)
+      // where PV is the mother vertex
+      // add mother decay time recursively to account for cascading decays
+
+      int daughter_index = inParticle->GetIndex();
+      int mother_index = momindex;
+      double dt = 0;
+      while (mother_index > 1 && mother_index != beagle_final_index){
+        const Particle* daughter = inEvent->GetTrack(daughter_index-1);
+        const Particle* mother = inEvent->GetTrack(mother_index-1);
+        double decay_length = (daughter->GetVertex()-mother->GetVertex()).Mag();
+	  if(decay_length>1e-3){
+	    double pMother = mother->GetP();
+	    double eMother = mother->GetE();
+	    dt += decay_length * eMother / pMother; // E/p = 1/beta; this order of operations is numerically more stable
+        }
+	  
+        daughter_index = mother_index;
+        mother_index = mother->GetParentIndex();
+      }
+      momend->set_position( FourVector( vnew.x(), vnew.y(), vnew.z(), dt));
+    }
+    // file->write_event(hepmc3evt);
+  }
+
+  // Record which quantities of the smeared particles were measured
+  if ( smeared ){
+    for( unsigned int t=0; t<inEvent->GetNTracks(); ++t) {
+      const Smear::ParticleMCS* smearedParticle = smeared->GetTrackFromTruth(t);
+      if ( !smearedParticle || undetected.at(t) || !hepevt_particles.at(t)->parent_event() ) continue;
+      hepevt_particles.at(t)->add_attribute( "smeared",
+        std::make_shared<HepMC3::IntAttribute>( smearedQuantities(*smearedParticle) ));
+    }
+  }
+
+  return 0;
+}
+
+/**
+   Convert a smeared event without the Monte Carlo record.
+   Without lineage, all detected particles come from a single vertex
+   with the two (unsmeared) beams going in.
+   The PDG code is only known if the detector identified the particle,
+   and 0 otherwise.
+   Returns 0 on success.
+*/
+int convertSmearedEvent(const Smear::Event& smeared, Long64_t i,
+                        ConversionContext& context, GenEvent& hepmc3evt) {
+  hepmc3evt.set_event_number(i);
+  hepmc3evt.weights().clear();
+  hepmc3evt.weights().push_back(1.0);
+
+  // attach cross section in pb
+  GenCrossSectionPtr xsec = std::make_shared<GenCrossSection>();
+  xsec->set_cross_section( context.crossSection, context.crossSectionError);
+  hepmc3evt.set_cross_section(xsec);
+
+  GenVertexPtr vertex = std::make_shared<GenVertex>();
+  // The beams are copied unsmeared into the smeared event
+  const Smear::ParticleMCS* beams[2] = { smeared.BeamLepton(), smeared.BeamHadron() };
+  for (int b(0); b < 2; ++b) {
+    if (!beams[b]) continue;
+    FourVector pv(beams[b]->GetPx(), beams[b]->GetPy(), beams[b]->GetPz(), beams[b]->GetE());
+    vertex->add_particle_in(std::make_shared<GenParticle>(pv, beams[b]->Id(), 4));
+  }  // for
+  std::vector<std::pair<GenParticlePtr, int> > detected;
+  for (unsigned t(0); t < smeared.GetNTracks(); ++t) {
+    const Smear::ParticleMCS* particle = smeared.GetTrack(t);
+    if (!particle || particle == beams[0] || particle == beams[1]) continue;
+    const int pid = particle->IsIdSmeared() ? int(particle->Id()) : 0;
+    double mass(0.);
+    if (pid != 0 && particle->Id().Info()) {
+      mass = particle->Id().Info()->Mass();
+    }  // if
+    FourVector pv;
+    if (!smearedFourVector(*particle, mass, pv)) continue;
+    GenParticlePtr hep = std::make_shared<GenParticle>(pv, pid, 1);
+    vertex->add_particle_out(hep);
+    detected.push_back(std::make_pair(hep, smearedQuantities(*particle)));
+  }  // for
+  hepmc3evt.add_vertex(vertex);
+  for (unsigned n(0); n < detected.size(); ++n) {
+    detected.at(n).first->add_attribute("smeared",
+      std::make_shared<HepMC3::IntAttribute>(detected.at(n).second));
+  }  // for
+  return 0;
+}
+
+/**
+   The Monte Carlo and/or smeared trees of a conversion.
+   Each thread reading the input uses its own.
+*/
+struct TreeReader {
+  TreeReader()
+  : mcTree(NULL), smearedTree(NULL), mcEvent(NULL), smearedEvent(NULL) {
+  }
+
+  ~TreeReader() {
+    if (mcTree) mcTree->ResetBranchAddresses();
+    if (smearedTree) smearedTree->ResetBranchAddresses();
+    delete mcEvent;
+    delete smearedEvent;
+  }
+
+  /**
+   Open the EICTree in the Monte Carlo file and the Smeared tree in
+   the smeared file. Either file name may be empty, but not both.
+   Returns false if a file or tree cannot be opened.
+  */
+  bool Open(const std::string& mcFileName, const std::string& smearedFileName) {
+    if (!mcFileName.empty()) {
+      mcFile.reset(TFile::Open(mcFileName.c_str(), "READ"));
+      if (!mcFile || !mcFile->IsOpen()) {
+        std::cerr << "Unable to open " << mcFileName << std::endl;
+        return false;
+      }  // if
+      mcFile->GetObject("EICTree", mcTree);
+      if (!mcTree) {
+        std::cerr << "Unable to find EICTree in " << mcFileName << std::endl;
+        return false;
+      }  // if
+      mcTree->SetBranchAddress("event", &mcEvent);
+    }  // if
+    if (!smearedFileName.empty()) {
+      smearedFile.reset(TFile::Open(smearedFileName.c_str(), "READ"));
+      if (!smearedFile || !smearedFile->IsOpen()) {
+        std::cerr << "Unable to open " << smearedFileName << std::endl;
+        return false;
+      }  // if
+      smearedFile->GetObject("Smeared", smearedTree);
+      if (!smearedTree) {
+        std::cerr << "Unable to find Smeared tree in " << smearedFileName << std::endl;
+        return false;
+      }  // if
+      smearedTree->SetBranchAddress("eventS", &smearedEvent);
+    }  // if
+    return mcTree || smearedTree;
+  }
+
+  /**
+   Returns the number of entries common to the trees.
+  */
+  Long64_t GetEntries() const {
+    if (mcTree && smearedTree) {
+      return std::min(mcTree->GetEntries(), smearedTree->GetEntries());
+    }  // if
+    return mcTree ? mcTree->GetEntries() : smearedTree->GetEntries();
+  }
+
+  /**
+   Read an entry and convert it.
+   Returns 0 on success, -1 if the event cannot be converted.
+  */
+  int Convert(Long64_t i, ConversionContext& context, GenEvent& hepmc3evt) {
+    if (mcTree) mcTree->GetEntry(i);
+    if (smearedTree) smearedTree->GetEntry(i);
+    int status(0);
+    if (mcEvent) {
+      status = convertEvent(mcEvent, i, context, hepmc3evt, smearedEvent);
+    } else {
+      status = convertSmearedEvent(*smearedEvent, i, context, hepmc3evt);
+    }  // if
+    if (status != 0) {
+      return status;
+    }  // if
+    // Go through event-wise variables.
+    // Smeared kinematics replace Monte Carlo ones of the same name.
+    if (mcEvent) fillAttributes(context.mcAttributes, *mcEvent, hepmc3evt);
+    if (smearedEvent) fillAttributes(context.smearedAttributes, *smearedEvent, hepmc3evt);
+    return 0;
+  }
+
+  std::unique_ptr<TFile> mcFile;
+  std::unique_ptr<TFile> smearedFile;
+  TTree* mcTree;
+  TTree* smearedTree;
+  erhic::EventMC* mcEvent;
+  Smear::Event* smearedEvent;
+};
+
+/**
+   Converted events waiting to be written, keyed by entry number,
+   shared between the conversion workers and the writer.
+*/
+struct EventQueue {
+  std::mutex mutex;
+  // Signalled when a worker has converted an event or failed
+  std::condition_variable converted;
+  // Signalled when the writer has written an event or failed
+  std::condition_variable written;
+  std::map<Long64_t, std::unique_ptr<GenEvent> > events;
+  Long64_t nextToWrite;
+  Long64_t window;  // How far workers may run ahead of the writer
+  bool failed;
+};
+
+/**
+   Flag a failure and wake up everyone waiting on the queue.
+*/
+void abortQueue(EventQueue& queue) {
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  queue.failed = true;
+  queue.converted.notify_all();
+  queue.written.notify_all();
+}
+
+/**
+   Conversion worker.
+   Reads its own copy of the trees and converts the next unclaimed entry
+   until all are done, handing the events to the writer.
+*/
+void convertWorker(const std::string& mcFileName,
+                   const std::string& smearedFileName,
+                   Long64_t maxEvent,
+                   ConversionContext& context,
+                   std::atomic<Long64_t>& nextToRead,
+                   EventQueue& queue) {
+  TreeReader reader;
+  if (!reader.Open(mcFileName, smearedFileName)) {
+    abortQueue(queue);
+    return;
+  }  // if
+
+  for (Long64_t i = nextToRead++; i < maxEvent; i = nextToRead++) {
+    {
+      // Don't run too far ahead of the writer
+      std::unique_lock<std::mutex> lock(queue.mutex);
+      queue.written.wait(lock, [&queue, i] {
+          return queue.failed || i < queue.nextToWrite + queue.window;
+        });
+      if (queue.failed) break;
+    }
+    std::unique_ptr<GenEvent> hepmc3evt(
+      new GenEvent(HepMC3::Units::GEV, HepMC3::Units::MM));
+    if (reader.Convert(i, context, *hepmc3evt) != 0) {
+      abortQueue(queue);
+      break;
+    }  // if
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.events[i] = std::move(hepmc3evt);
+    queue.converted.notify_all();
+  }  // for
+}
+
+/**
+   Convert entries [0, maxEvent) with nThreads workers.
+   The calling thread is the only one writing, and writes the events
+   in their original order.
+   Returns 0 on success, -1 if any event failed to convert.
+*/
+int convertInParallel(const std::string& mcFileName,
+                      const std::string& smearedFileName,
+                      Long64_t maxEvent,
+                      unsigned nThreads,
+                      ConversionContext& context,
+                      HepMC3::Writer& file) {
+  // Make ROOT I/O safe to use from several threads, and fill the
+  // particle table up front so workers only ever read from it.
+  ROOT::EnableThreadSafety();
+  TDatabasePDG::Instance()->GetParticle(11);
+
+  EventQueue queue;
+  queue.nextToWrite = 0;
+  queue.window = 16 * nThreads;
+  queue.failed = false;
+  std::atomic<Long64_t> nextToRead(0);
+  std::vector<std::thread> workers;
+  for (unsigned n(0); n < nThreads; ++n) {
+    workers.push_back(std::thread(convertWorker, std::cref(mcFileName),
+                                  std::cref(smearedFileName), maxEvent,
+                                  std::ref(context), std::ref(nextToRead),
+                                  std::ref(queue)));
+  }  // for
+
+  for (Long64_t i(0); i < maxEvent; i++) {
+    std::unique_ptr<GenEvent> hepmc3evt;
+    {
+      std::unique_lock<std::mutex> lock(queue.mutex);
+      queue.converted.wait(lock, [&queue, i] {
+          return queue.failed || queue.events.count(i) > 0;
+        });
+      if (queue.failed) break;
+      hepmc3evt = std::move(queue.events[i]);
+      queue.events.erase(i);
+    }
+    if (i % 10000 == 0 && i != 0) {
+      std::cout << "Processing event " << i << std::endl;
+    }  // if
+    file.write_event(*hepmc3evt);
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.nextToWrite = i + 1;
+    queue.written.notify_all();
+  }  // for
+
+  for (unsigned n(0); n < workers.size(); ++n) {
+    workers.at(n).join();
+  }  // for
+  return queue.failed ? -1 : 0;
+}
+
+/**
+   Check that events of the class can be converted and set up the
+   generator-specific handling for them.
+   Returns false if the event class is not supported.
+*/
+bool setupContext(TClass* eventClass, ConversionContext& context,
+                  std::string& generatorname) {
+  TString name = eventClass->GetName();
+  if (eventClass->InheritsFrom("erhic::EventDis")) {
+    name.ReplaceAll("erhic::Event","");
   } else {
-    cerr << branchClass->GetName() << " is not supported." << endl;
-    return -1;
+    cerr << eventClass->GetName() << " is not supported." << endl;
+    return false;
   }  // if
+  generatorname = name.Data();
+
+  context.crossSection = 1.0;
+  context.crossSectionError = 0.0;
+  context.milouwarn = false;
 
   // BeAGLE is currently unfixable; using a kludge to salvage what we can
-  bool beaglemode=false;
-  if (branchClass->InheritsFrom("erhic::EventBeagle")) {
+  context.beaglemode=false;
+  if (eventClass->InheritsFrom("erhic::EventBeagle")) {
     cout << "Warning: BeAGLE support is rudimentary. Can't fix mother-daughter structure." << endl;
     cout << endl;
-    beaglemode=true;
+    context.beaglemode=true;
   }
 
   // Older Milou files need special treatment
-  bool legacymilou=false;
-  bool milouwarn=false; // Need to enter event loop to determine, but warn only once
-  if (branchClass->InheritsFrom("erhic::EventMilou")) {
-    legacymilou=true;
+  context.legacymilou=false;
+  if (eventClass->InheritsFrom("erhic::EventMilou")) {
+    context.legacymilou=true;
   }
 
-  // Run info
+  // Djangoh events that fail to hadronize need their partons reattached
+  context.djangoh = eventClass->InheritsFrom("erhic::EventDjangoh");
+  return true;
+}
+
+/**
+   Create the run information for a generator.
+*/
+std::shared_ptr<GenRunInfo> createRunInfo(const std::string& generatorname) {
   std::shared_ptr<GenRunInfo> run = std::make_shared<GenRunInfo>();
   struct GenRunInfo::ToolInfo generator={
-    std::string(generatorname),
+    generatorname,
     std::string("unknown version"),
     std::string("Used generator")
   };
@@ -121,44 +1238,64 @@ Long64_t TreeToHepMC(const std::string& inputFileName,
   std::vector<std::string> wnames;
   if (!wnames.size()) wnames.push_back("default");
   run->set_weight_names(wnames);
-  
+  return run;
+}
+
+/**
+   Attach the cross section et al. saved by a LogReader in the directory
+   to the run information, and keep the cross section for the events.
+*/
+void readRunInfo(TDirectory& directory, GenRunInfo& run,
+                 ConversionContext& context) {
   // cross-section et al are stored as special strings
   // We don't have incremental information, so attach the full info to the header.
   // Need to also use HepMC3::GenCrossSection for rivet
   // Christian Bierlich recommends just using the same for each event
 
-  double crossSection = 1.0;
-  double crossSectionError = 0.0;
-  
   // The super set, not all generators supply all of these
   // could also record  accepted_events and attempted_events
-  std::vector <string> RunAttributes = {"crossSection", "crossSectionError", "nEvents", "nTrials" };
+  std::vector <std::string> RunAttributes = {"crossSection", "crossSectionError", "nEvents", "nTrials" };
   for ( auto att : RunAttributes ){
     TObjString* ObjString(nullptr);
-    inFile.GetObject(att.c_str(), ObjString);
+    directory.GetObject(att.c_str(), ObjString);
     if (ObjString) {
       double value = std::atof(ObjString->String());
       if ( att == "crossSection" ) {
         // crossSection is in microbarn! Converting to HepMC's pb standard
         value *=1e6;
-        crossSection = value;
+        context.crossSection = value;
       }
       if ( att == "crossSectionError" ){
         // crossSection is in microbarn! Converting to HepMC's pb standard
         value *=1e6;
-        crossSectionError = value;
+        context.crossSectionError = value;
       }
       cout << " Adding to the header: " << att << "  " << value << endl;
-      run->add_attribute( att, std::make_shared<HepMC3::DoubleAttribute>( value )) ;
+      run.add_attribute( att, std::make_shared<HepMC3::DoubleAttribute>( value )) ;
     }
   }
+}
 
+/**
+   Open the HepMC output for an input file.
+   Returns NULL for an unknown output type.
+*/
+std::shared_ptr<HepMC3::Writer> openWriter(const std::string& inputFileName,
+                                           const std::string& outputDirName,
+                                           const erhic::HepMC_outtype outtype,
+                                           std::shared_ptr<GenRunInfo> run) {
   // Construct the output from the input file name,
   // stripping any leading directory path via
   // use of the BaseName() method from TSystem.
   TString outName = gSystem->BaseName(inputFileName.c_str());
+  // Remove zip extension, if there is one.
+  if ( outName.EndsWith(".gz", TString::kIgnoreCase) ||
+       outName.EndsWith(".zip", TString::kIgnoreCase) )
+    outName.Replace(outName.Last('.'), outName.Length(), "");
   // Replace the extension
-  outName.Replace(outName.Last('.'), outName.Length(), "");
+  if (outName.Last('.') > -1) {
+    outName.Replace(outName.Last('.'), outName.Length(), "");
+  }  // if
   outName.Append(".hepmc");
 
   TString outDir(outputDirName);
@@ -188,13 +1325,97 @@ Long64_t TreeToHepMC(const std::string& inputFileName,
     break;
   default :
     cerr << "Unknown HepMC_outtype" << endl;
-    return -1;
-    break; // Unneeded, except sometimes cint gets confused
+    break;
   }
-  
+  return file;
+}
+
+/**
+   Common implementation of TreeToHepMC and SmearedTreeToHepMC.
+   Either file name may be empty, but not both.
+   With both, the smeared event provides the final state of the
+   Monte Carlo event; with only the smeared file, the event has no lineage.
+*/
+Long64_t convertTrees(const std::string& mcFileName,
+                      const std::string& smearedFileName,
+                      const std::string& outputDirName,
+                      Long64_t maxEvent,
+                      const erhic::HepMC_outtype outtype,
+                      const std::string& attributes,
+                      unsigned nThreads) {
+  // Open the input file(s) and get the trees from them.
+  // Complain and quit if we don't find the file or the tree.
+  TreeReader reader;
+  if (!reader.Open(mcFileName, smearedFileName)) {
+    return 1;
+  }  // if
+
+  // Get generator name
+  ConversionContext context;
+  std::string generatorname("eic-smear");
+  if (reader.mcTree) {
+    TClass* branchClass =
+      TClass::GetClass(reader.mcTree->GetBranch("event")->GetClassName());
+    if (!setupContext(branchClass, context, generatorname)) {
+      return -1;
+    }  // if
+  } else {
+    // Without the Monte Carlo record none of the generator fixes apply
+    context.crossSection = 1.0;
+    context.crossSectionError = 0.0;
+    context.milouwarn = false;
+    context.beaglemode = false;
+    context.legacymilou = false;
+    context.djangoh = false;
+  }  // if
+
+  // Run info, including what the LogReader saved to the tree file
+  std::shared_ptr<GenRunInfo> run = createRunInfo(generatorname);
+  readRunInfo(reader.mcFile ? *reader.mcFile : *reader.smearedFile,
+              *run, context);
+
+  std::shared_ptr<HepMC3::Writer> file =
+    openWriter(smearedFileName.empty() ? mcFileName : smearedFileName,
+               outputDirName, outtype, run);
+  if (!file) {
+    return -1;
+  }  // if
+
+  // Decide once which event-wise variables become attributes,
+  // instead of inspecting every leaf in every event.
+  const std::set<std::string> selected = parseNameList(attributes);
+  if (reader.mcTree) {
+    context.mcAttributes = classifyAttributes(
+      TClass::GetClass(reader.mcTree->GetBranch("event")->GetClassName()),
+      selected, false);
+  }  // if
+  if (reader.smearedTree) {
+    context.smearedAttributes = classifyAttributes(
+      TClass::GetClass(reader.smearedTree->GetBranch("eventS")->GetClassName()),
+      selected, false);
+  }  // if
+  for (std::set<std::string>::const_iterator i = selected.begin();
+       i != selected.end(); ++i) {
+    bool found(false);
+    for (unsigned n(0); n < context.mcAttributes.size(); ++n) {
+      found |= context.mcAttributes.at(n).name == *i;
+    }  // for
+    for (unsigned n(0); n < context.smearedAttributes.size(); ++n) {
+      found |= context.smearedAttributes.at(n).name == *i;
+    }  // for
+    if (!found) {
+      cerr << "Warning: requested attribute " << *i
+           << " is not an exportable event variable - ignored" << endl;
+    }  // if
+  }  // for
+
+  if (nThreads == 0) {
+    nThreads = std::max(1u, std::thread::hardware_concurrency());
+  }  // if
+
   // Event Loop
-  if (mcTree->GetEntries() < maxEvent || maxEvent < 1) {
-    maxEvent = mcTree->GetEntries();
+  if (reader.GetEntries() < maxEvent || maxEvent < 1) {
+    maxEvent = reader.GetEntries();
   } 
   std::cout <<
     "/-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-/"
@@ -206,628 +1427,210 @@ Long64_t TreeToHepMC(const std::string& inputFileName,
     "/-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-/"
             << std::endl;
 
+  if (nThreads > 1) {
+    std::cout << "Converting with " << nThreads << " threads" << std::endl;
+    const int status = convertInParallel(mcFileName, smearedFileName,
+                                         maxEvent, nThreads, context, *file);
+    file->close();
+    return status;
+  }  // if
+
   for (Long64_t i(0); i < maxEvent; i++) {
     if (i % 10000 == 0 && i != 0) {
       std::cout << "Processing event " << i << std::endl;
     } 
-    mcTree->GetEntry(i);
     
     // Construct new empty HepMC3 event and fill it.
     // Using GeV and mm (!) as that's what afterburner for beam effects expect
     // It has been confirmed that BeAGLE uses MM
     // Need to check for other models as well
     GenEvent hepmc3evt( HepMC3::Units::GEV, HepMC3::Units::MM );
-    hepmc3evt.set_event_number(i);
-    hepmc3evt.weights().clear();
-    hepmc3evt.weights().push_back(1.0);
-
-    // attach cross section in pb
-    GenCrossSectionPtr xsec = std::make_shared<GenCrossSection>();
-    xsec->set_cross_section( crossSection, crossSectionError);
-    hepmc3evt.set_cross_section(xsec);
-
-    // Go through event-wise variables
-    // Leaves -> particles but also generator-specific variables
-    auto leaves = mcTree->GetListOfLeaves();
-    for ( int l = 0 ; l < leaves->GetEntries(); ++l ){
-      TLeaf* leaf = (TLeaf*) leaves->At(l);
-      TString lname = leaf->GetName();
-      TString ltype = leaf->GetTypeName();
-      if ( lname.BeginsWith("particles") ) continue;
-      // cout << lname << "  " << leaf->GetValue() << endl;
-
-      // Catch weight
-      if ( lname == "weight"){
-        hepmc3evt.weights().clear();
-        hepmc3evt.weights().push_back( leaf->GetValue() );
-        continue;
-      }
-      // Store generator variables - upconvert types
-      if ( ltype.Contains( "char", TString::kIgnoreCase) ) {
-        // This can be a char type or a C string. I'm not aware
-        // of either use case, so don't waste time to differentiate, just ignore
-        // cerr << lname << " is char ignored" << endl;
-        continue;
-      }
-      if ( ltype.Contains( "long", TString::kIgnoreCase) ) {
-        hepmc3evt.add_attribute(lname.Data(),std::make_shared<HepMC3::LongAttribute>( leaf->GetValue() )) ;
-        cerr << lname << " is long" << endl;
-        continue;
-      }
-      if ( ltype.Contains( "int", TString::kIgnoreCase) 
-           || ltype.Contains( "short", TString::kIgnoreCase) ) {
-        hepmc3evt.add_attribute(lname.Data(),std::make_shared<HepMC3::IntAttribute>( leaf->GetValue() )) ;
-        // cerr << lname << " is int or short" << endl;
-        continue;
-      }
-      if ( ltype.Contains( "float", TString::kIgnoreCase)
-           || ltype.Contains( "double", TString::kIgnoreCase) ) {
-        hepmc3evt.add_attribute(lname.Data(),std::make_shared<HepMC3::DoubleAttribute>( leaf->GetValue() )) ;
-        // cerr << lname << " is float or double" << endl;
-        continue;
-      }
-      // cerr << lname << " is " << ltype << "  - ignored" << endl;
-
-      // ignore everything else, e.g. bool      
-    } // leaf list
-
-    // Multiple parents seem to only be in BeAGLE
-    // and somewtimes there seem to be exactly 2 parents, sometimes a range like for daughters.
-    // I cannot differentiate between the two, and for the exact case, it erroneously gives the impression
-    // of a large range, like 17 -- 254 which will wreak havoc on the graph.
-    // "Remedy": pre-burner
-    // - All intermediate non-beam particles have the exchange boson as their mother.
-    // - hadrons and leptons with status 2:
-    //   - if they have exactly one parent with status 2 (decay chain),
-    //     maintain that parent
-    //   - otherwise, they're the start of a decay, treat like a final particle
-    // - hadrons and leptons with status 1:
-    //   - if they have exactly one parent with status 2 (decay product),
-    //     maintain that parent
-    //   - otherwise, they're final, attach to the single final particle vertex
-    // - When the graph gets created, we'll separate and add another dummy node to connect
-    //   the boson to via all non-finals
-    //   and the finals one as out-going edges
-    // --> Incorrect vertex information (but I don't see it correctly in the original anyway)
-
-    // Use a special index to refer to the dummy vertex
-    // Should be ushort_max, but keep it flexible
-    auto beagle_final_index = std::numeric_limits< decltype(inEvent->GetTrack(0)->GetParentIndex())>::max();
+    if ( reader.Convert(i, context, hepmc3evt) != 0 ){
+      return -1;
+    }
+
+    // Done! Write the event.
+    file->write_event(hepmc3evt);
+    // There's a bunch of cleanup one should do now, with all the dynamical
+    // vertices and particles. BUT shared_ptr should take care of that. Revisit if there are memory leaks.
+    // break;
     
-    if ( beaglemode ){
-      auto bosonindex=inEvent->ExchangeBoson()->GetIndex();
-      // IMPORTANT! ScatteredLepton() will segfault after we change its lineage!
-      // Last time we can use it.
-      auto scatteredindex = inEvent->ScatteredLepton()->GetIndex();
-      
-      for( unsigned int t=0; t<inEvent->GetNTracks(); ++t) {
-        Particle* inParticle = inEvent->GetTrack(t);
-        auto myindex = inParticle->GetIndex();
-        
-        // special cases first
-        // beam
-        if ( myindex==inEvent->BeamLepton()->GetIndex()
-             || myindex==inEvent->BeamHadron()->GetIndex()
-             ) continue;
-
-        // Scattered lepton. It may well not be a direct descendant, but we'll stuff that
-        // intermediate history in with the rest. But the beam needs a final lepton daughter
-        if ( myindex==scatteredindex ){
-          inParticle->SetParentIndex( inEvent->BeamLepton()->GetIndex() );
-          inParticle->SetParentIndex1( 0 );
-          inParticle->SetChild1Index( 0 );
-          inParticle->SetChildNIndex( 0 );
-          continue;
-        }
-        
-        // boson
-        if ( myindex==bosonindex ){
-          inParticle->SetChild1Index( 5 );
-          inParticle->SetChildNIndex( inEvent->GetNTracks() );
-          continue;
-        }
-        
-        auto pdg = TDatabasePDG::Instance()->GetParticle( inParticle->Id() );
-        // Note: ROOT's table is outdated and doesn't catch, e.g. Delta baryons 
-        switch (inParticle->GetStatus() ){
-        case 2 :
-          // mis-labeled as 2?
-          if ( !pdg ){ // ignore unknown particles (e.g. pomerons, ions)
-            inParticle->SetStatus(12);
-          } else if ( !TString(pdg->ParticleClass()).Contains("Lepton")
-                      && !TString(pdg->ParticleClass()).Contains("Baryon")
-                      && !TString(pdg->ParticleClass()).Contains("Meson")
-                      ){
-            inParticle->SetStatus(12);
-            inParticle->SetParentIndex( bosonindex );
-            inParticle->SetParentIndex1( 0 );
-            
-            inParticle->SetChild1Index( beagle_final_index ); // not needed but logically true
-            inParticle->SetChildNIndex( 0 );   
-          } else{
-            // properly labeled as 2. We better have children
-            if ( inParticle->GetChild1Index() == 0 ){
-              std::cout << "Processing event " << i << std::endl;
-              std::cout << "Processing track " << t << " with index " << inParticle->GetIndex() << std::endl;
-              std::cout << "I am a hadron or lepton with status 2, but I do not have children. "  << std::endl;
-              return -1;
-            }
-            // We better have exaxctly one parent
-            // Alas, this too does happen
-            if ( inParticle->GetParentIndex1()!=0 ){
-              std::cout << "Processing event " << i << std::endl;
-              std::cout << "Processing track " << t << " with index " << inParticle->GetIndex() << std::endl;
-              std::cout << "Warning: I am a hadron or lepton with status 2, but I have too many parents. "  << std::endl;
-              std::cout << "Discarding the older one"  << std::endl;
-              // std::cout << inParticle->GetParentIndex() << "  " << inParticle->GetParentIndex1() << endl;
-              inParticle->SetParentIndex( std::max ( inParticle->GetParentIndex(), inParticle->GetParentIndex1() ) );
-              inParticle->SetParentIndex1( 0 );
-            }
-            auto mom = inParticle->GetParent();
-            if ( !mom ){
-              std::cout << "Processing event " << i << std::endl;
-              std::cout << "Processing track " << t << " with index " << inParticle->GetIndex() << std::endl;
-              std::cout << "I am a hadron or lepton with status 2, but I have no parents. "  << std::endl;
-              return -1;
-            }
-            // status of mother?
-            if ( mom->GetStatus() == 1 ){
-              std::cout << "Processing event " << i << std::endl;
-              std::cout << "Processing track " << t << " with index " << inParticle->GetIndex() << std::endl;
-              std::cout << "I am a hadron or lepton with status 2, but my mother is final. "  << std::endl;
-              return -1;
-            }
-            if ( mom->GetStatus() != 2 ){
-              // We're the beginning of a decay, attach to "final" vertex
-              inParticle->SetParentIndex( beagle_final_index );
-              inParticle->SetParentIndex1( 0 );
-            }       
-          }
-          break;
-        case 1:
-          {
-            // final particles
-            auto mom = inParticle->GetParent();
-            if ( mom ){
-              // status of mother?
-              if ( mom->GetStatus() == 2 ){
-                // do nothing, we keep this mother as ours
-                inParticle->SetChild1Index( 0 );
-                inParticle->SetChildNIndex( 0 );
-                break;
-              }
-            }
-            // default behavior for finals
-            inParticle->SetParentIndex( beagle_final_index );
-            inParticle->SetParentIndex1( 0 );
-            
-            inParticle->SetChild1Index( 0 );
-            inParticle->SetChildNIndex( 0 );
-            break;
-          }
-        default : 
-          // everything else
-          inParticle->SetParentIndex( bosonindex );
-          inParticle->SetParentIndex1( 0 );
-          
-          inParticle->SetChild1Index( beagle_final_index ); // not needed but logically true
-          inParticle->SetChildNIndex( 0 );
-          break;
-        }
-      }
-    } // if ( beaglemode )
+  }  // event loop
 
-    if ( legacymilou && inEvent->BeamLepton()->GetChild1Index()==0 ){
-      if ( !milouwarn ){
-        cout << "Warning: Trying to repair legay Milou's parentage issues." << endl;
-        cout << endl;
-        milouwarn=true; 
-      }
+  file->close();
+  
+  Long64_t result = 0;
+  
+  return result;
+}
 
-      // e
-      inEvent->GetTrack(1-1)->SetChild1Index(3);
-      inEvent->GetTrack(1-1)->SetChildNIndex(4);
+}  // anonymous namespace
 
-      // p
-      inEvent->GetTrack(2-1)->SetChild1Index(6);
-      inEvent->GetTrack(2-1)->SetChildNIndex(0);
+// see include/eicsmear/functions.h for declaration and default values
 
-      // e'
-      inEvent->GetTrack(3-1)->SetParentIndex(1);
-      inEvent->GetTrack(3-1)->SetChild1Index(0);
-      inEvent->GetTrack(3-1)->SetChildNIndex(0);
+/**
+   This function converts our tree format to HepMC3
+   It would be better to skip the ROOT step, but that
+   would require a lot of duplication and/or refactorization
+*/
+Long64_t TreeToHepMC(const std::string& inputFileName,
+                     const std::string& outputDirName,
+                     Long64_t maxEvent,
+                     const erhic::HepMC_outtype outtype,
+                     const std::string& attributes,
+                     unsigned nThreads) {
+  
+  // Make sure this is a root file, 
+  if ( !TString(inputFileName).EndsWith(".root", TString::kIgnoreCase) ){
+    cerr << "Warning: " << inputFileName << " does not end with .root" << endl;
+  }
+  return convertTrees(inputFileName, "", outputDirName, maxEvent, outtype,
+                      attributes, nThreads);
+}
 
-      // gamma*
-      inEvent->GetTrack(4-1)->SetParentIndex(1);
-      inEvent->GetTrack(4-1)->SetChild1Index(5);
-      inEvent->GetTrack(4-1)->SetChildNIndex(0);
-      
-      // gamma
-      inEvent->GetTrack(5-1)->SetParentIndex(4);
-      inEvent->GetTrack(5-1)->SetChild1Index(0);
-      inEvent->GetTrack(5-1)->SetChildNIndex(0);
-      
-      // p'
-      inEvent->GetTrack(6-1)->SetParentIndex(2);
-      inEvent->GetTrack(6-1)->SetChild1Index(0);
-      inEvent->GetTrack(6-1)->SetChildNIndex(0);
-
-      // ISR 
-      if (inEvent->GetTrack(7-1) ){ 
-        inEvent->GetTrack(7-1)->SetParentIndex(0);
-        inEvent->GetTrack(7-1)->SetChild1Index(0);
-        inEvent->GetTrack(7-1)->SetChildNIndex(0);
-      }
-    }
-    
-    // First, fix sloppily implemented mother-daughter relations
-    // Not done for BeAGLE, because of the special vertex
-    if ( !beaglemode ){
-      for( unsigned int t=0; t<inEvent->GetNTracks(); ++t) {
-        const Particle* inParticle = inEvent->GetTrack(t);
-        
-        // Do my children know me?
-        auto myindex = inParticle->GetIndex();
-        // std::cout << "Processing track " << t << " with index " << myindex << std::endl;
-        auto c1 = inParticle->GetChild1Index();
-        auto cN = inParticle->GetChildNIndex();
-        if ( cN==0 ) cN =c1;
-        if ( c1>cN ) std::swap(c1,cN);
-        if ( c1>0 ) {
-          
-          //In a small number of Djangoh events, the particle list will be incomplete.
-          //A particle will have a child which is not included in the particle list.
-          bool djangohproblem = false;
-
-          for ( UShort_t c = c1; c<=cN; ++c ){ // sigh. index starts at 1, tracks at 0;
-            Particle* child = inEvent->GetTrack(c-1);
-            if ( !child ) {
-              cerr << "Trying to access a non-existant child" << endl;
-              cerr << "Event is " << i << "  Problem index is " << c << endl;
-              cerr << "If this is not a djangoh file, please contact the eic-smear developers"<<endl;
-              djangohproblem = true;
-              break;
-            }
- 
-            // std::cout << "     Processing child with index " << child->GetIndex() << std::endl;
-            auto p1 = child->GetParentIndex();
-            auto pN = child->GetParentIndex1();
-            if ( p1>pN ) std::swap(p1,pN);
-            if ( p1==0 && pN==0 ){ // child erroneously believes to be motherless
-              child->SetParentIndex( myindex );
-            } else if ( p1==0 ) { // We are the only parent, is it correctly assigned?
-              if ( pN != myindex ){
-                // Nothing we can do, e.g. pythia allows multiple parenthood but lacks a way to describe that, see:
-                // 12     12       2101        5       18       31
-                // ...
-                // 16     11          2       10       18       31
-                // ...
-                // 26      1       -211       12        0        0
-                // 27      1        211       16        0        0
-                // cerr << "My child thinks its mother is " << pN << ", but it should be " << myindex << endl;
-                // return -1;
-              }
-            } else {
-              // If multiple parents come from non-BeAGLE MC's revisit
-              cout << "Found more than one parent in a non-BeAGLE file. Please contact the authors." << endl;
-              return -1;
-              // We have more than one parent, are they correct?
-              // This would be the logic if p1 and pN _span_
-              // if ( myindex < p1 || myindex > pN ){
-              //   std::cout << "Processing event " << i << std::endl;
-              //   std::cout << "Processing track " << t << " with index " << myindex << std::endl;
-              //   std::cout << "     Processing child with index " << child->GetIndex() << std::endl;
-              //   cerr << "My child thinks its mothers range between " << p1 << " and " << pN
-              //           << ", but I am " << myindex << endl;
-              //   // return -1;
-              // }
-              // Instead, it seems that BeAGLE (mostly?) assumes this to mean
-              // exactly two parents, usually far apart in index
-              // if ( myindex != p1 && myindex != pN ){
-              //   // Problematic situation in BeAGLE:
-              //   //  I       S        PID       P1       P2       D1       D2
-              //   // ==========================================================
-              //   //  17     18       2112        0        0      260      261
-              //   // ...
-              //   // 254     19        111       41      244      260      261
-              //   // 255      2       2212       41      244      260      261
-              //   // ...
-              //   // 260     16       2112       17      254        0        0
-              //   // 261     16       2212       17      254        0        0
-              // }
-            }
-          }
-          if(djangohproblem) continue;
-        }
-        // Do my parents acknowledge me?
-        auto p1 = inParticle->GetParentIndex();
-        auto pN = inParticle->GetParentIndex1();
-        if ( p1>pN ) std::swap(p1,pN);
-        if ( p1==0 ) p1 =pN;
-        // Do all my parents acknowledge me?
-        if (pN > 0){
-          for ( unsigned int p = p1; p<=pN ; ++p ){
-            Particle* parent = inEvent->GetTrack(p-1);
-            auto pc1 = parent->GetChild1Index();
-            auto pcN = parent->GetChildNIndex();
-            if ( pc1>pcN ) std::swap(pc1,pcN);
-            if ( pc1 > myindex ){
-              // cout << "hello1" << endl;
-              parent->SetChild1Index( myindex );
-            }
-            if ( pcN < myindex ){
-              // cout << "hello2" << endl;
-              parent->SetChildNIndex( myindex );
-            }
-          }
-        }      
-      }
-    } // graph repair for !beaglemode
-      
-    // Perform consistency checks and collect particles
-    std::vector<GenParticlePtr> hepevt_particles;
-    hepevt_particles.reserve( inEvent->GetNTracks() );
-    for( unsigned int t=0; t<inEvent->GetNTracks(); ++t) {
-      const Particle* inParticle = inEvent->GetTrack(t);
-      // Particles with status 1 cannot have children
-      auto status = inParticle->GetStatus();
-      if ( status==1 ){
-        if (inParticle->GetNChildren() != 0 ){
-          cout << "Status is 1 but we have children?" << endl;
-          inParticle->Print();
-        } 
-      }
-      
-      // // All child-less particles should have a "safe" status (like 21), best would be 1
-      // if (inParticle->GetNChildren() == 0 ){
-      //        if ( status !=1 && status !=21 ){
-      //          cerr << "Status is " << status << " but we have no children?" << endl;
-      //          inParticle->Print();
-      //        }
-      // }
-
-      // // Mother-less particles should be the beam only
-      // Alas, that's not the case :-/
-      // if ( t>1 && inParticle->GetParentIndex()==0 && inParticle->GetParentIndex1() ==0 ){
-      //        cout << "Event: " << i << " -- We have no mother" << endl;
-      //        inParticle->Print();
-      // }
-
-      FourVector pv = FourVector( inParticle->GetPx(), inParticle->GetPy(), inParticle->GetPz(),inParticle->GetE() );
-      int statusHepMC = inParticle->GetStatus();
-      // We should use only 1 (final), 2 (decayed hadron or lepton), 4 (beam), and >10, <=200 (anything else)
-      // This may need to be decided on a generator-by-generator basis
-      // We can assume final particles already have status 1, because that's
-      // what EventMC::FinalState uses (and it's not overridden in existing classes)
-
-      // Catch decayed leptons and hadrons
-      // doesn't work for BeAGLE
-      if ( ! beaglemode && t>3 ){     // Ignore the beam
-        if (inParticle->GetNChildren() != 0 ){ // ignore final particles
-          auto pdg = TDatabasePDG::Instance()->GetParticle( inParticle->Id() );
-          if ( pdg ){ // ignore unknown particles (e.g. pomerons, ions)
-            if ( TString(pdg->ParticleClass()).Contains("Lepton")
-                 || TString(pdg->ParticleClass()).Contains("Baryon")
-                 || TString(pdg->ParticleClass()).Contains("Meson")
-                 ){
-              // Now our status should be 2!
-              // cout << statusHepMC << endl;
-              // inParticle->Print();
-              statusHepMC = 2;
-            }
-          }
-        }
-      }
+/**
+   Converts the output of SmearTree to HepMC3, alone or together with
+   the Monte Carlo tree it was smeared from.
+*/
+Long64_t SmearedTreeToHepMC(const std::string& smearedFileName,
+                            const std::string& mcFileName,
+                            const std::string& outputDirName,
+                            Long64_t maxEvent,
+                            const erhic::HepMC_outtype outtype,
+                            const std::string& attributes,
+                            unsigned nThreads) {
+  if (smearedFileName.empty()) {
+    std::cerr << "No smeared file given" << std::endl;
+    return 1;
+  }  // if
+  return convertTrees(mcFileName, smearedFileName, outputDirName, maxEvent,
+                      outtype, attributes, nThreads);
+}
 
-      // // catch DJANGOH trying to assign 4 to non beams
-      // if ( t>3  && (statusHepMC == 4 ) ){
-      //          cout << "Naughty Djangoh" << endl;
-      //          statusHepMC=14;
-      // }
-      
-      // force everything else to be legal
-      if ( statusHepMC != 1 && statusHepMC != 2 && statusHepMC != 4 ){
-        while ( statusHepMC <=10 ) statusHepMC+=10;
-        while ( statusHepMC >200 ) statusHepMC-=10;
-      }
 
-      //In the Pythia 6 convention, status=4 indicates a particle which could
-      //have decayed but did not within the allowed volume around the vertex.
-      //We adjust these particles to have status=1 in the HepMC file to avoid
-      //confusion with the beam particles.
-      if( statusHepMC == 4) statusHepMC = 1;
+/**
+   Converts a plain-text Monte Carlo file straight to HepMC, without
+   first building a ROOT tree. Events are created by the same factories
+   as used by BuildTree and converted by the same code as TreeToHepMC.
+*/
+Long64_t BuildHepMC(const std::string& inputFileName,
+                    const std::string& outputDirName,
+                    Long64_t maxEvent,
+                    const erhic::HepMC_outtype outtype,
+                    const std::string& attributes,
+                    const std::string& logFileName) {
+  // Open the input file for reading, the same way as the Forester does.
+  std::shared_ptr<std::istream> input;
+  if ( TString(inputFileName).EndsWith("gz", TString::kIgnoreCase) ||
+       TString(inputFileName).EndsWith("zip", TString::kIgnoreCase)){
+    auto tmp = std::make_shared<igzstream>();
+    tmp->open(inputFileName.c_str());
+    input = tmp;
+  } else {
+    input = std::make_shared<std::ifstream>(inputFileName.c_str());
+  }
+  if (!input->good()) {
+    std::cerr << "Unable to open " << inputFileName << std::endl;
+    return -1;
+  }  // if
 
-      // Create GenParticle
-      hepevt_particles.push_back( std::make_shared<GenParticle>( pv, inParticle->Id(), statusHepMC ));
-      hepevt_particles.back()->set_generated_mass( inParticle->GetM() );
+  // Determine which Monte Carlo generator produced the file.
+  std::unique_ptr<const erhic::FileType> fileType(
+    erhic::FileFactory::GetInstance().GetFile(input, inputFileName));
+  if (!fileType) {
+    std::cerr << inputFileName << " is not from a supported generator" << std::endl;
+    return -1;
+  }  // if
+  std::unique_ptr<erhic::VirtualEventFactory> factory(
+    fileType->CreateEventFactory(*input));
 
-    }
+  TClass* eventClass = TClass::GetClass(factory->EventName().c_str());
+  ConversionContext context;
+  std::string generatorname;
+  if (!eventClass || !setupContext(eventClass, context, generatorname)) {
+    return -1;
+  }  // if
 
-    // Build the event
-    // beam particles
-    // --------------
-    // Default is 1 = e-, 2 = hadron, 3 = scattered e-, 4 = exchange boson
-    // But this can (and does) differ, especially for the scattered lepton
-    // As always, be aware of Fortran starting to count at 1
-    // Vertex: We don't keep track of time
-    auto lepton=inEvent->BeamLepton();
-    int index_lepton = lepton->GetIndex();
-    if ( index_lepton !=1 ) std::cout << "Warning: Found BeamLepton at " << index_lepton << endl;
-    auto hep_lepton = hepevt_particles.at( index_lepton-1);
-    hep_lepton->set_status(4);
-
-    auto boson=inEvent->ExchangeBoson();
-    int index_boson = boson->GetIndex();
-    // This happens in Sartre who puts the boson at 3
-    // if ( index_boson !=4 ) std::cout << "Warning: Found ExchangeBoson at " << index_boson << endl;
-    // if ( boson->GetParentIndex() != index_lepton && boson->GetParentIndex1() != index_lepton ){
-    //   // This is common for Sartre, and any others that treat the boson like the beam
-    //   std::cout << "Warning: ExchangeBoson doesn't recognize the beam as its mother " << endl;
-    // }
-    auto hep_boson = hepevt_particles.at( index_boson-1);
-    // if needed / desired, could force hep_boson->set_status(4);
-
-    GenVertexPtr v_lepton = std::make_shared<GenVertex>();
-    v_lepton->add_particle_in  (hep_lepton);
-    v_lepton->add_particle_out (hep_boson);
-    hepmc3evt.add_vertex(v_lepton);
-
-    auto hadron=inEvent->BeamHadron();
-    int index_hadron = hadron->GetIndex();
-    if ( index_hadron !=2 ) std::cout << "Warning: Found BeamHadron at " << index_hadron << endl;
-    auto hep_hadron = hepevt_particles.at( index_hadron-1);
-    hep_hadron->set_status(4);
-    GenVertexPtr v_hadron = std::make_shared<GenVertex>();
-
-    v_hadron->add_particle_in (hep_hadron);
-    hepmc3evt.add_vertex(v_hadron);
-
-    // For Beagle, use
-    //                  
-    //  e      e'               
-    //   \v1__/                 i1      f1
-    //         \_gamma        /    \   /
-    //                 \ _v2_/__i2__ v3__f2
-    //                 /     \      / \                (*)
-    //             proton     \iN /    \fN
-    //
-    // where i1, .., iN are intermediate (!=1) and f1,..fN are final
-    // v2 == v_hadron, v3 == v_beagle_final
-
-    // Addendum: BeAGLE does support hadron/lepton decay. Attach the root to v3,
-    // and keep their children, e.g.:
-    // 
-    //   v2_/__i2__ v3__J/psi__e
-    //                \      \                          (*)
-    //                 \fN    e
-    //
-    // (But also keep decay chains)
-    // (*) comment lines ending in "\" generate compiler warnings 
-    
-    // Dummy to act as a catchall for intermediary particles in beagle
-    GenVertexPtr v_beagle_final = std::make_shared<GenVertex>();
-    if ( beaglemode ){
-      v_hadron->add_particle_in(hep_boson);
-      hepmc3evt.add_vertex( v_beagle_final );
-      // We don't have a connection yet, so in the pathological case
-      // that there are no non-final particles at all, this vertex floats free.
-      // That's too unlikely to occur to build in a fail-safe now
-    }
-    
-    // Now work our way through the remaining particles
-    // - Attach each particle that has a mother to their end vertex
-    // ---> Create / overwrite production vertex in the process.
-    //      If it's inconsistent, there's not much we can do
-    // - attach motherless particles to the exchange boson
-    // ---> In that case, leave the production vertex location in peace
-    // ---> Also note that ISR photons are motherless and thus
-    //      get attached to the exchange boson as well
-    // Topological order should just translate to the fact that
-    // children always have a higher index than their parents
-
-    // Note: Multiple parents would wreak havoc here - have to handle BeAGLE differently
-    for( unsigned int t=0; t<inEvent->GetNTracks(); ++t) {
-      const Particle* inParticle = inEvent->GetTrack(t);
+  // Run info. The LogReader saves its information to the current
+  // directory, so let it write to a file that only lives in memory.
+  std::shared_ptr<GenRunInfo> run = createRunInfo(generatorname);
+  std::string logFile(logFileName);
+  if (logFile.empty()) {
+    logFile = erhic::LogReaderFactory::GetInstance().Locate(inputFileName);
+  }  // if
+  if (!logFile.empty()) {
+    std::unique_ptr<erhic::LogReader> reader(fileType->CreateLogReader());
+    if (reader && reader->Extract(logFile)) {
+      TDirectory::TContext directoryGuard;
+      TMemFile logInfo("BuildHepMC_logInfo.root", "RECREATE");
+      reader->Save();
+      readRunInfo(logInfo, *run, context);
+    }  // if
+  }  // if
 
-      // Skip what we already have
-      int index = inParticle->GetIndex();
-      if ( index==index_lepton || index==index_boson || index==index_hadron) continue;
-      auto hep_in = hepevt_particles.at( index-1);
-      // auto hep_mom = hep_boson;
-      auto hep_mom = hep_hadron;
-      int momindex = inParticle->GetParentIndex();
-      auto statusHepMC = inParticle->GetStatus();
-
-      //For Djangoh events which fail to hadronize, shift the parent of the
-      //final-state parton from the incoming electron beam to th hadron beam     
-      if (branchClass->InheritsFrom("erhic::EventDjangoh")){
-        if( statusHepMC==1 && momindex==1 &&
-            (abs(inParticle->Id())==1 || abs(inParticle->Id())==2 || abs(inParticle->Id())==3 || 
-             abs(inParticle->Id())==90 || inParticle->Id()==91 || inParticle->Id()==92) ){ 
-          momindex+=1;
-        }
-      }
-      
-      // suppress all the intermediate nucleons
-      // this may be worth doing anyway  just to reduce filesize
-      // if ( beaglemode && statusHepMC==3 ) continue;
-      // if ( beaglemode && statusHepMC==14 ) continue;
-      // if ( beaglemode && statusHepMC==18 ) continue;
-      // if ( beaglemode && statusHepMC==12 ) continue;
-      // This is purely for legibility, these particles should stay!
-      // note: 80000 are lighter ions, without specification
-      // if ( beaglemode && statusHepMC==1 && momindex == beagle_final_index
-      //           && ( hep_in->pid() == 2112 || hep_in->pid() == 2212 || hep_in->pid() == 80000 ) ) continue;
-      
-      // beagle finals 
-      if ( momindex == beagle_final_index ){
-        v_beagle_final->add_particle_out(hep_in);
-        continue;
-      }
+  std::shared_ptr<HepMC3::Writer> file =
+    openWriter(inputFileName, outputDirName, outtype, run);
+  if (!file) {
+    return -1;
+  }  // if
 
-      // beagle intermediates
-      // out will be handled, but need to attach as incoming
-      if ( beaglemode && statusHepMC!=1 && statusHepMC!=2  ){
-        v_beagle_final->add_particle_in(hep_in);
-      }
-      
-      // Mother?
-      if ( momindex > 0 ){
-        hep_mom = hepevt_particles.at( momindex-1);
-      }
-      
-      // Does mom have an end vertex yet?
-      auto momend = hep_mom->end_vertex();
-      if (!momend) {
-        momend = std::make_shared<GenVertex>();
-        momend->add_particle_in(hep_mom);
-        hepmc3evt.add_vertex(momend);
-      }
+  const std::vector<EventAttribute> eventAttributes =
+    classifyAttributes(eventClass, parseNameList(attributes));
 
-      momend->add_particle_out(hep_in);
-        
-      // update prod vertex?
-      if ( momindex > 1){
-        auto vnew = inParticle->GetVertex();
-        
-        // recalcuate vertex time using: dt = (SV-PV).Mag()/(pMother/eMother)
-        // where PV is the mother vertex
-        // add mother decay time recursively to account for cascading decays
-
-        int daughter_index = inParticle->GetIndex();
-        int mother_index = momindex;
-        double dt = 0;
-        while (mother_index > 1 && mother_index != beagle_final_index){
-          const Particle* daughter = inEvent->GetTrack(daughter_index-1);
-          const Particle* mother = inEvent->GetTrack(mother_index-1);
-          double decay_length = (daughter->GetVertex()-mother->GetVertex()).Mag();
-	  if(decay_length>1e-3){
-	    double pMother = mother->GetP();
-	    double eMother = mother->GetE();
-	    dt += decay_length * eMother / pMother; // E/p = 1/beta; this order of operations is numerically more stable
-          }
-	  
-          daughter_index = mother_index;
-          mother_index = mother->GetParentIndex();
-        }
-        momend->set_position( FourVector( vnew.x(), vnew.y(), vnew.z(), dt));
-      }
-      // file->write_event(hepmc3evt);
-    }
+  // Align the input file at the start of the first event.
+  factory->FindFirstEvent();
 
-    // Done! Write the event.
+  std::cout <<
+    "/-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-/"
+            << std::endl;
+  std::cout <<
+    "/  Commencing conversion of " << inputFileName << std::endl;
+  std::cout <<
+    "/-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-/"
+            << std::endl;
+
+  Long64_t i(0);
+  while (maxEvent < 1 || i < maxEvent) {
+    std::unique_ptr<erhic::VirtualEvent> event;
+    // Catch exceptions from the event builder here so we don't break
+    // out of the whole loop for a single bad event.
+    try {
+      event.reset(factory->Create());
+    }  // try
+    catch(std::exception& e) {
+      std::cerr << "Caught exception in BuildHepMC(): "
+                << e.what() << std::endl;
+      std::cerr << "Event will be skipped..." << std::endl;
+      continue;
+    }  // catch
+    if (!event) {
+      break;  // End of input
+    }  // if
+    erhic::EventMC* inEvent = dynamic_cast<erhic::EventMC*>(event.get());
+    if (!inEvent) {
+      std::cerr << factory->EventName() << " is not supported." << std::endl;
+      file->close();
+      return -1;
+    }  // if
+
+    // Using GeV and mm (!) as that's what afterburner for beam effects expect
+    GenEvent hepmc3evt( HepMC3::Units::GEV, HepMC3::Units::MM );
+    if ( convertEvent(inEvent, i, context, hepmc3evt) != 0 ){
+      file->close();
+      return -1;
+    }
+    fillAttributes(eventAttributes, *inEvent, hepmc3evt);
     file->write_event(hepmc3evt);
-    // There's a bunch of cleanup one should do now, with all the dynamical
-    // vertices and particles. BUT shared_ptr should take care of that. Revisit if there are memory leaks.
-    // break;
-    
-  }  // event loop
+
+    ++i;
+    if (i % 10000 == 0) {
+      std::cout << "Processing event " << i << std::endl;
+    }  // if
+  }  // while
 
   file->close();
-  
-  Long64_t result = 0;
-  
-  return result;
+  std::cout << "Converted " << i << " events" << std::endl;
+  return 0;
 }
 
 
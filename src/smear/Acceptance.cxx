@@ -13,6 +13,47 @@
 #include <TLorentzVector.h>
 #include <TString.h>
 
+#include "eicsmear/erhic/VirtualEvent.h"
+
+namespace {
+
+// Number of kinematic variables in a compiled zone box.
+const int kNBoxVariables = 6;
+
+// Fills the zone-box variables of a particle (ordered as in
+// Zone::GetBox(), with angles mapped to their canonical ranges)
+// and the raw kinematics used by custom cuts (indexed by KinType).
+// Each variable is evaluated once, however many zones there are.
+void fillKinematics(const erhic::VirtualParticle& prt,
+                    double* box, double* kinematics) {
+  kinematics[Smear::kE] = prt.GetE();
+  kinematics[Smear::kP] = prt.GetP();
+  kinematics[Smear::kTheta] = prt.GetTheta();
+  kinematics[Smear::kPhi] = prt.GetPhi();
+  kinematics[Smear::kPz] = prt.GetPz();
+  kinematics[Smear::kPt] = prt.GetPt();
+  box[0] = Smear::FixTheta(kinematics[Smear::kTheta]);
+  box[1] = Smear::FixPhi(kinematics[Smear::kPhi]);
+  box[2] = kinematics[Smear::kE];
+  box[3] = kinematics[Smear::kP];
+  box[4] = kinematics[Smear::kPt];
+  box[5] = kinematics[Smear::kPz];
+}
+
+// Branch-free range test of one box, which the compiler can vectorise.
+// A variable is rejected only if it is below the minimum or above the
+// maximum, so NaN values pass, as in Zone::Contains().
+inline bool inBox(const double* x, const double* lower,
+                  const double* upper) {
+  int outside(0);
+  for (int k(0); k < kNBoxVariables; ++k) {
+    outside |= (x[k] < lower[k]) | (x[k] > upper[k]);
+  }  // for
+  return 0 == outside;
+}
+
+}  // anonymous namespace
+
 namespace Smear {
 
 Acceptance::~Acceptance() {
@@ -25,6 +66,25 @@ Acceptance::Acceptance(int genre)
 
 void Acceptance::AddZone(const Zone& z) {
   mZones.push_back(z);
+  Compile();
+}
+
+void Acceptance::Compile() {
+  Compile(mZones, mLower, mUpper, mHasCustomCuts);
+}
+
+void Acceptance::Compile(const std::vector<Zone>& zones,
+                         std::vector<double>& lower,
+                         std::vector<double>& upper,
+                         std::vector<char>& hasCustomCuts) {
+  lower.assign(zones.size() * kNBoxVariables, 0.);
+  upper.assign(zones.size() * kNBoxVariables, 0.);
+  hasCustomCuts.assign(zones.size(), 0);
+  for (unsigned i(0); i < zones.size(); ++i) {
+    zones.at(i).GetBox(&lower.at(i * kNBoxVariables),
+                       &upper.at(i * kNBoxVariables));
+    hasCustomCuts.at(i) = zones.at(i).HasCustomCuts();
+  }  // for
 }
 
 void Acceptance::SetGenre(int n) {
@@ -43,7 +103,7 @@ void Acceptance::AddParticle(int n) {
   mParticles.insert(n);
 }
 
-bool Acceptance::Is(const erhic::VirtualParticle& prt) const {
+bool Acceptance::IsSelectedSpecies(const erhic::VirtualParticle& prt) const {
   // Check for genre first (em, hadronic, any)
   // if (PGenre(prt) == 0 || (mGenre != 0 && PGenre(prt) != mGenre)) {
   //   return false;
@@ -74,18 +134,106 @@ bool Acceptance::Is(const erhic::VirtualParticle& prt) const {
   if (!mParticles.empty() && mParticles.count(prt.Id()) == 0) {
     return false;
   }  // if
+  return true;
+}
+
+bool Acceptance::Is(const erhic::VirtualParticle& prt) const {
+  if (!IsSelectedSpecies(prt)) {
+    return false;
+  }  // if
   // If there are no Zones, accept everything that passed genre check
   if (mZones.empty()) {
     return true;
   }  // if
+  double box[kNBoxVariables];
+  double kinematics[kInvalidKinType];
+  fillKinematics(prt, box, kinematics);
   for (unsigned i(0); i < mZones.size(); i++) {
-    if (mZones.at(i).Contains(prt)) {
+    if (inBox(box, &mLower[i * kNBoxVariables], &mUpper[i * kNBoxVariables])
+        && (!mHasCustomCuts[i] || mZones[i].PassesCustomCuts(kinematics))) {
       return true;
     }  // if
   }  // for
   return false;
 }
 
+void Acceptance::AcceptTracks(TrackKinematics& tracks, char* accepted,
+                              unsigned stride) const {
+  const unsigned n = tracks.tracks.size();
+  // Tracks of species not selected count as already decided, so are
+  // never tested against the zones
+  std::vector<char>& decided = tracks.decided;
+  std::vector<char>& inZone = tracks.inZone;
+  decided.resize(n);
+  inZone.resize(n);
+  bool any(false);
+  for (unsigned c(0); c < n; ++c) {
+    decided[c] = !IsSelectedSpecies(*tracks.tracks[c]);
+    any |= !decided[c];
+  }  // for
+  if (!any) {
+    return;
+  }  // if
+  // If there are no Zones, accept everything that passed genre check
+  if (mZones.empty()) {
+    for (unsigned c(0); c < n; ++c) {
+      if (!decided[c]) {
+        accepted[tracks.indices[c] * stride] = 1;
+      }  // if
+    }  // for
+    return;
+  }  // if
+  // For each zone, first run the branch-free box test over all tracks
+  // not yet accepted, then evaluate custom cuts only for tracks inside
+  // the box, so formulae are evaluated no more often than by Is().
+  for (unsigned i(0); i < mZones.size(); ++i) {
+    const double* lower = &mLower[i * kNBoxVariables];
+    const double* upper = &mUpper[i * kNBoxVariables];
+    for (unsigned c(0); c < n; ++c) {
+      inZone[c] = !decided[c] &&
+                  inBox(&tracks.boxes[c * kNBoxVariables], lower, upper);
+    }  // for
+    if (mHasCustomCuts[i]) {
+      for (unsigned c(0); c < n; ++c) {
+        if (inZone[c]) {
+          inZone[c] = mZones[i].PassesCustomCuts(
+            &tracks.kinematics[c * kInvalidKinType]);
+        }  // if
+      }  // for
+    }  // if
+    for (unsigned c(0); c < n; ++c) {
+      if (inZone[c]) {
+        decided[c] = 1;
+        accepted[tracks.indices[c] * stride] = 1;
+      }  // if
+    }  // for
+  }  // for
+}
+
+//
+// struct Acceptance::TrackKinematics
+//
+
+void Acceptance::TrackKinematics::Gather(const erhic::VirtualEvent& event) {
+  // Clearing keeps the capacity, so only the first events allocate
+  tracks.clear();
+  indices.clear();
+  boxes.clear();
+  kinematics.clear();
+  for (unsigned j(0); j < event.GetNTracks(); ++j) {
+    const erhic::VirtualParticle* track = event.GetTrack(j);
+    if (!track || track->GetStatus() != 1) {
+      continue;
+    }  // if
+    tracks.push_back(track);
+    indices.push_back(j);
+    boxes.resize(boxes.size() + kNBoxVariables);
+    kinematics.resize(kinematics.size() + kInvalidKinType);
+    fillKinematics(*track, &boxes[boxes.size() - kNBoxVariables],
+                   &kinematics[kinematics.size() - kInvalidKinType]);
+  }  // for
+}
+
 //
 // class Acceptance::CustomCut
 //
@@ -150,6 +298,16 @@ bool Acceptance::CustomCut::Contains(
   return z >= Min && z < Max;
 }
 
+bool Acceptance::CustomCut::Contains(const double* kinematics) const {
+  double x = kinematics[Kin1];
+  double y(0.);
+  if (2 == dim) {
+    y = kinematics[Kin2];
+  }  // if
+  double z = mFormula.Eval(x, y);
+  return z >= Min && z < Max;
+}
+
 //
 // class Acceptance::Zone
 //
@@ -182,32 +340,42 @@ void Acceptance::Zone::Add(const CustomCut& cut) {
 }
 
 Bool_t Acceptance::Zone::Contains(const erhic::VirtualParticle& prt) const {
-  bool accept(true);
-  const double theta = FixTheta(prt.GetTheta());
-  const double phi = FixPhi(prt.GetPhi());
-  if (theta < thetaMin || theta > thetaMax) {
-    accept = false;
-  } else if (phi < phiMin || phi > phiMax) {
-    accept = false;
-  } else if (prt.GetE() < EMin || prt.GetE() > EMax) {
-    accept = false;
-  } else if (prt.GetP() < PMin || prt.GetP() > PMax) {
-    accept = false;
-  } else if (prt.GetPz() < pZMin || prt.GetPz() > pZMax) {
-    accept = false;
-  } else if (prt.GetPt() < pTMin || prt.GetPt() > pTMax) {
-    accept = false;
-  }  // if
-  // If it made it this far, test the custom cut(s)
-  if (accept) {
-    for (unsigned j(0); j < CustomCuts.size(); ++j) {
-      if (!CustomCuts.at(j).Contains(prt)) {
-        accept = false;
-        break;
-      }  // if
-    }  // for
-  }  // if
-  return accept;
+  double box[kNBoxVariables];
+  double kinematics[kInvalidKinType];
+  fillKinematics(prt, box, kinematics);
+  double lower[kNBoxVariables];
+  double upper[kNBoxVariables];
+  GetBox(lower, upper);
+  // Only test the custom cut(s) if the particle is inside the box
+  return inBox(box, lower, upper) && PassesCustomCuts(kinematics);
+}
+
+void Acceptance::Zone::GetBox(double* lower, double* upper) const {
+  lower[0] = thetaMin;
+  upper[0] = thetaMax;
+  lower[1] = phiMin;
+  upper[1] = phiMax;
+  lower[2] = EMin;
+  upper[2] = EMax;
+  lower[3] = PMin;
+  upper[3] = PMax;
+  lower[4] = pTMin;
+  upper[4] = pTMax;
+  lower[5] = pZMin;
+  upper[5] = pZMax;
+}
+
+bool Acceptance::Zone::HasCustomCuts() const {
+  return !CustomCuts.empty();
+}
+
+bool Acceptance::Zone::PassesCustomCuts(const double* kinematics) const {
+  for (unsigned j(0); j < CustomCuts.size(); ++j) {
+    if (!CustomCuts.at(j).Contains(kinematics)) {
+      return false;
+    }  // if
+  }  // for
+  return true;
 }
 
 }  // namespace Smear
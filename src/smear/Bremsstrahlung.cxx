@@ -12,7 +12,10 @@
 #include <cassert>
 #include <cmath>
 
+#include <RVersion.h>
+
 #include "eicsmear/erhic/VirtualParticle.h"
+#include "eicsmear/smear/Distributor.h"
 
 namespace Smear {
 
@@ -103,7 +106,11 @@ void Bremsstrahlung::Smear(const erhic::VirtualParticle& prt,
   const int nGamma = NGamma();
   for (int i = 0; i < nGamma; i++) {
     if (!SetupPDF()) break;
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 24, 0)
+    double loss = mPdf->GetRandom(Distributor::GetRandom());
+#else
     double loss = mPdf->GetRandom();
+#endif
     mParticle->E -= loss;
   }  // for
   prtOut.SetE ( mParticle->GetE() );
@@ -10,15 +10,21 @@
 #include "eicsmear/smear/Detector.h"
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <functional>
 #include <list>
 #include <memory>
 #include <vector>
 
 #include "eicsmear/erhic/EventDis.h"
+#include "eicsmear/smear/DetectorStats.h"
+#include "eicsmear/smear/Device.h"
+#include "eicsmear/smear/Distributor.h"
 #include "eicsmear/smear/EventSmear.h"
 #include "eicsmear/erhic/Kinematics.h"
 #include "eicsmear/smear/ParticleMCS.h"
+#include "eicsmear/smear/ParticlePool.h"
 #include "eicsmear/smear/Smearer.h"
 #include "eicsmear/erhic/VirtualParticle.h"
 
@@ -26,21 +32,47 @@ using std::cout;
 using std::cerr;
 using std::endl;
 
+namespace {
+
+// Returns a smeared particle from the pool, or a new one without a pool.
+Smear::ParticleMCS* newParticle(Smear::ParticlePool* pool) {
+  Smear::ParticleMCS* particle =
+    (pool ? pool->Acquire() : new Smear::ParticleMCS());
+  particle->SetSmeared();
+  return particle;
+}
+
+// Returns true if any kinematic quantity of the particle is NaN.
+bool hasNan(const Smear::ParticleMCS& particle) {
+  return std::isnan(particle.GetE()) || std::isnan(particle.GetP()) ||
+         std::isnan(particle.GetPt()) || std::isnan(particle.GetPz()) ||
+         std::isnan(particle.GetTheta()) || std::isnan(particle.GetPhi());
+}
+
+}  // anonymous namespace
+
 namespace Smear {
 
 Detector::Detector()
 : useNM(false)
 , useJB(false)
-, useDA(false) {
+, useDA(false)
+, mStats(NULL)
+, mNScanPoints(-1) {
 }
 
 Detector::Detector(const Detector& other)
-: TObject(other) {
+: TObject(other)
+, mStats(NULL)
+, mNScanPoints(other.GetNScanPoints()) {
   useNM = other.useNM;
   useJB = other.useJB;
   useDA = other.useDA;
   Devices = other.CopyDevices();
   LegacyMode = other.GetLegacyMode();
+  if (other.mStats) {
+    mStats = new DetectorStats(*other.mStats);
+  }  // if
 }
 
 Detector& Detector::operator=(const Detector& that) {
@@ -48,14 +80,22 @@ Detector& Detector::operator=(const Detector& that) {
     useNM = that.useNM;
     useJB = that.useJB;
     useDA = that.useDA;
+    DeleteAllDevices();
     Devices = that.CopyDevices();
+    mNScanPoints = that.GetNScanPoints();
     LegacyMode = that.GetLegacyMode();
+    delete mStats;
+    mStats = NULL;
+    if (that.mStats) {
+      mStats = new DetectorStats(*that.mStats);
+    }  // if
   }  // if
   return *this;
 }
 
 Detector::~Detector() {
   DeleteAllDevices();
+  delete mStats;
 }
 
 void Detector::DeleteAllDevices() {
@@ -64,10 +104,30 @@ void Detector::DeleteAllDevices() {
     Devices.at(i) = NULL;
   }  // for
   Devices.clear();
+  mNScanPoints = 0;
+  if (mStats) {
+    mStats->Reset(Devices);
+  }  // if
 }
 
 void Detector::AddDevice(Smearer& dev) {
   Devices.push_back(dev.Clone());
+  mNScanPoints = -1;
+  if (mStats) {
+    mStats->Reset(Devices);
+  }  // if
+}
+
+void Detector::SetInstrumentation(bool on) {
+  if (on) {
+    if (!mStats) {
+      mStats = new DetectorStats;
+    }  // if
+    mStats->Reset(Devices);
+  } else {
+    delete mStats;
+    mStats = NULL;
+  }  // if
 }
 
 void Detector::SetEventKinematicsCalculator(TString s) {
@@ -118,6 +178,26 @@ void Detector::FillEventKinematics(Event* eventS) {
   }  // if
 }
 
+void Detector::Accept(const erhic::VirtualEvent& event,
+                      std::vector<char>& accepted) const {
+  Acceptance::TrackKinematics tracks;
+  Accept(event, tracks, accepted);
+}
+
+void Detector::Accept(const erhic::VirtualEvent& event,
+                      Acceptance::TrackKinematics& tracks,
+                      std::vector<char>& accepted) const {
+  const unsigned nDevices = Devices.size();
+  accepted.assign(event.GetNTracks() * nDevices, 0);
+  // Gather the kinematics once for all devices, each of which writes
+  // its column of the mask
+  tracks.Gather(event);
+  for (unsigned i(0); i < nDevices; ++i) {
+    Devices.at(i)->Accept.AcceptTracks(tracks, accepted.data() + i,
+                                       nDevices);
+  }  // for
+}
+
 std::list<Smearer*> Detector::Accept(const erhic::VirtualParticle& p) const {
   std::list<Smearer*> devices;
   // Only accept final-state particles, so skip the check against each
@@ -134,21 +214,154 @@ std::list<Smearer*> Detector::Accept(const erhic::VirtualParticle& p) const {
   return devices;
 }
 
+ParticleMCS* Detector::SmearCounted(const erhic::VirtualParticle& prt,
+                                    ParticlePool* pool) const {
+  typedef std::chrono::steady_clock Clock;
+  ParticleMCS* prtOut(NULL);
+  // As in Accept(), only final-state particles are tested.
+  if (prt.GetStatus() == 1) {
+    bool nan(false);
+    for (unsigned i(0); i < Devices.size(); ++i) {
+      DeviceStats& stats = mStats->GetDevice(i);
+      const ULong64_t bogus = ParticleMCS::GetNBogusValues();
+      const Clock::time_point start = Clock::now();
+      ++stats.tested;
+      // Smearing each accepted particle immediately, rather than after
+      // testing all devices, gives the same result: acceptance depends
+      // only on the unsmeared particle.
+      if (Devices.at(i)->Accept.Is(prt)) {
+        ++stats.accepted;
+        if (!prtOut) {
+          prtOut = newParticle(pool);
+        }  // if
+        Devices.at(i)->SmearAccepted(prt, *prtOut);
+      }  // if
+      stats.nanoseconds += std::chrono::duration_cast<
+        std::chrono::nanoseconds>(Clock::now() - start).count();
+      stats.bogus += ParticleMCS::GetNBogusValues() - bogus;
+      if (prtOut && !nan && hasNan(*prtOut)) {
+        ++stats.nan;
+        nan = true;
+      }  // if
+    }  // for
+  }  // if
+  mStats->AddParticle(prtOut != NULL);
+  return prtOut;
+}
+
 ParticleMCS* Detector::Smear(const erhic::VirtualParticle& prt) const {
+  return SmearParticle(prt, NULL);
+}
+
+ParticleMCS* Detector::Smear(const erhic::VirtualParticle& prt,
+                             ParticlePool& pool) const {
+  return SmearParticle(prt, &pool);
+}
+
+ParticleMCS* Detector::SmearParticle(const erhic::VirtualParticle& prt,
+                                     ParticlePool* pool) const {
   // Does the particle fall in the acceptance of any device?
   // If so, we smear it, if not, we skip it (store a NULL pointer).
-  std::list<Smearer*> devices = Accept(prt);
   ParticleMCS* prtOut(NULL);
-  if (!devices.empty()) {
-    // It passes through at least one device, so smear it.
-    // Devices in which it doesn't pass won't smear it.
-    prtOut = new ParticleMCS();
-    prtOut->SetSmeared();
-    std::list<Smearer*>::iterator iter;
-    for (iter = devices.begin(); iter != devices.end(); ++iter) {
-      (*iter)->Smear(prt, *prtOut);
+  if (mStats) {
+    prtOut = SmearCounted(prt, pool);
+  } else {
+    std::list<Smearer*> devices = Accept(prt);
+    if (!devices.empty()) {
+      // It passes through at least one device, so smear it.
+      // Devices in which it doesn't pass won't smear it.
+      prtOut = newParticle(pool);
+      std::list<Smearer*>::iterator iter;
+      for (iter = devices.begin(); iter != devices.end(); ++iter) {
+        (*iter)->SmearAccepted(prt, *prtOut);
+      }  // for
+    }  // if
+  }  // if
+  DeriveMomentum(prt, prtOut);
+  return prtOut;
+}
+
+void Detector::Smear(const erhic::VirtualParticle& prt,
+                     const std::vector<ParticlePool*>& pools,
+                     std::vector<ParticleMCS*>& replicas) const {
+  // Acceptance depends only on the unsmeared particle,
+  // so is the same for all replicas.
+  std::vector<char> accepted(Devices.size(), 0);
+  if (!mStats && prt.GetStatus() == 1) {
+    for (unsigned i(0); i < Devices.size(); ++i) {
+      accepted[i] = Devices.at(i)->Accept.Is(prt);
+    }  // for
+  }  // if
+  Smear(prt, accepted.data(), pools, replicas);
+}
+
+void Detector::Smear(const erhic::VirtualParticle& prt,
+                     const char* accepted,
+                     const std::vector<ParticlePool*>& pools,
+                     std::vector<ParticleMCS*>& replicas) const {
+  replicas.assign(pools.size(), NULL);
+  // Replicas beyond the scan points, if any, smear with fresh random
+  // numbers rather than replay those of another point.
+  const unsigned nScanPoints = GetNScanPoints();
+  if (mStats) {
+    // The statistics count each replica
+    for (unsigned i(0); i < pools.size(); ++i) {
+      if (i < nScanPoints) {
+        Distributor::BeginScanPoint(i);
+      } else if (i == nScanPoints && nScanPoints > 0) {
+        Distributor::EndScan();
+      }  // if
+      replicas.at(i) = SmearParticle(prt, pools.at(i));
     }  // for
-    
+    if (nScanPoints > 0) {
+      Distributor::EndScan();
+    }  // if
+    return;
+  }  // if
+  bool any(false);
+  for (unsigned j(0); j < Devices.size() && !any; ++j) {
+    any = accepted[j];
+  }  // for
+  if (!any) {
+    return;
+  }  // if
+  for (unsigned i(0); i < pools.size(); ++i) {
+    if (i < nScanPoints) {
+      Distributor::BeginScanPoint(i);
+    } else if (i == nScanPoints && nScanPoints > 0) {
+      Distributor::EndScan();
+    }  // if
+    ParticleMCS* prtOut = newParticle(pools.at(i));
+    for (unsigned j(0); j < Devices.size(); ++j) {
+      if (accepted[j]) {
+        Devices.at(j)->SmearAccepted(prt, *prtOut);
+      }  // if
+    }  // for
+    DeriveMomentum(prt, prtOut);
+    replicas.at(i) = prtOut;
+  }  // for
+  if (nScanPoints > 0) {
+    Distributor::EndScan();
+  }  // if
+}
+
+UInt_t Detector::GetNScanPoints() const {
+  if (mNScanPoints < 0) {
+    UInt_t nPoints(0);
+    for (unsigned i(0); i < Devices.size(); ++i) {
+      const Device* device = dynamic_cast<const Device*>(Devices.at(i));
+      if (device) {
+        nPoints = std::max(nPoints, device->GetNScanPoints());
+      }  // if
+    }  // for
+    mNScanPoints = nPoints;
+  }  // if
+  return mNScanPoints;
+}
+
+void Detector::DeriveMomentum(const erhic::VirtualParticle& prt,
+                              ParticleMCS* prtOut) const {
+  if (prtOut) {
     if (LegacyMode){
       // Compute derived momentum components.
       prtOut->SetPx( prtOut->GetP() * sin(prtOut->GetTheta()) * cos(prtOut->GetPhi()));
@@ -301,11 +514,7 @@ ParticleMCS* Detector::Smear(const erhic::VirtualParticle& prt) const {
       } // case treatment for momentum components changed
       
     } // LegacyMode
-  } // if devices not empty
-
-  // Done.
-  return prtOut;
-
+  } // if smeared
 }
 
 std::vector<Smearer*> Detector::CopyDevices() const {
@@ -319,6 +528,15 @@ std::vector<Smearer*> Detector::CopyDevices() const {
 }
 
 void Detector::Print(Option_t* o) const {
+  if (TString(o).Contains("stats", TString::kIgnoreCase)) {
+    if (mStats) {
+      mStats->Print();
+    } else {
+      std::cout << "No statistics: call SetInstrumentation() before smearing"
+                << std::endl;
+    }  // if
+    return;
+  }  // if
   for (unsigned i(0); i < GetNDevices(); ++i) {
     Devices.at(i)->Print(o);
   }  // for
@@ -0,0 +1,77 @@
+/**
+ \file
+ Implementation of class Smear::DetectorStats.
+
+ \date      2026-10-18
+ \copyright 2026 Brookhaven National Lab
+ */
+
+#include "eicsmear/smear/DetectorStats.h"
+
+#include <iomanip>
+#include <iostream>
+
+#include "eicsmear/smear/Smearer.h"
+
+namespace Smear {
+
+DeviceStats::DeviceStats()
+: tested(0)
+, accepted(0)
+, nanoseconds(0)
+, bogus(0)
+, nan(0) {
+}
+
+DetectorStats::DetectorStats()
+: mNParticles(0)
+, mNSmeared(0) {
+}
+
+DetectorStats::~DetectorStats() {
+}
+
+void DetectorStats::Reset(const std::vector<Smearer*>& devices) {
+  mDevices.assign(devices.size(), DeviceStats());
+  for (unsigned i(0); i < devices.size(); ++i) {
+    mDevices.at(i).name = TString::Format("%u %s", i,
+                                          devices.at(i)->ClassName());
+  }  // for
+  mNParticles = 0;
+  mNSmeared = 0;
+}
+
+void DetectorStats::Print(Option_t*) const {
+  std::cout << mNParticles << " particles, " << mNSmeared
+            << " smeared by at least one device" << std::endl;
+  std::cout << std::left << std::setw(24) << "device" << std::right
+            << std::setw(12) << "tested" << std::setw(12) << "accepted"
+            << std::setw(9) << "accept%" << std::setw(12) << "total ms"
+            << std::setw(10) << "ns/test" << std::setw(10) << "bogus"
+            << std::setw(8) << "NaN" << std::endl;
+  Long64_t nanoseconds(0);
+  for (unsigned i(0); i < mDevices.size(); ++i) {
+    const DeviceStats& device = mDevices.at(i);
+    double acceptance(0.), perTest(0.);
+    if (device.tested > 0) {
+      acceptance = 100. * device.accepted / device.tested;
+      perTest = double(device.nanoseconds) / device.tested;
+    }  // if
+    std::cout << std::left << std::setw(24) << device.name << std::right
+              << std::setw(12) << device.tested
+              << std::setw(12) << device.accepted
+              << std::setw(9) << std::fixed << std::setprecision(1)
+              << acceptance
+              << std::setw(12) << std::setprecision(2)
+              << device.nanoseconds / 1.e6
+              << std::setw(10) << std::setprecision(0) << perTest
+              << std::setw(10) << device.bogus
+              << std::setw(8) << device.nan << std::endl;
+    nanoseconds += device.nanoseconds;
+  }  // for
+  std::cout.unsetf(std::ios::fixed);
+  std::cout << std::setprecision(6) << "total " << nanoseconds / 1.e6
+            << " ms in devices" << std::endl;
+}
+
+}  // namespace Smear
@@ -16,7 +16,6 @@
 #include <string>
 #include <vector>
 
-#include <TUUID.h>
 #include <TDatabasePDG.h>
 
 #include "eicsmear/smear/FormulaString.h"
@@ -44,9 +43,8 @@ bool Device::Init(const TString& kinematicFunction,
   FormulaString f(kinematicFunction.Data());
   // The expression has to have exactly one variable.
   mSmeared = f.Variables().front();
-  // Use UUID for ROOT function name to avoid instances clashing
-  mKinematicFunction = new TF1(TUUID().AsString(),
-                               f.GetString().c_str(), -1e15, 1.e16);
+  // Compiled once per process and shared by all devices
+  mKinematicFunction = FormulaString::CompileFunction(kinematicFunction.Data());
   // Set the resolution function.
   mFormula = new FormulaString(resolutionFunction.Data());
   // cout << mFormula->GetString() << endl;
@@ -56,7 +54,11 @@ bool Device::Init(const TString& kinematicFunction,
 Device::Device(KinType type, const TString& formula, EGenre genre)
 : mSmeared(type)
 , mKinematicFunction(NULL)
-, mFormula(NULL) {
+, mFormula(NULL)
+, mCachedVariable(0.)
+, mCachedUnsmeared(0.)
+, mCachedResolution(0.)
+, mCacheValid(false) {
   Accept.SetGenre(genre);
   Init(FormulaString::GetKinName(type), formula, genre);
 }
@@ -65,34 +67,39 @@ Device::Device(const TString& variable, const TString& resolution,
                EGenre genre)
 : mSmeared(kInvalidKinType)
 , mKinematicFunction(NULL)
-, mFormula(NULL) {
+, mFormula(NULL)
+, mCachedVariable(0.)
+, mCachedUnsmeared(0.)
+, mCachedResolution(0.)
+, mCacheValid(false) {
   Init(variable, resolution, genre);
 }
 
 Device::Device(const Device& that)
 : Smearer(that)
 , mSmeared(that.mSmeared)
-, mKinematicFunction(NULL)
+, mKinematicFunction(that.mKinematicFunction)
 , mFormula(NULL)
-, mDimensions(that.mDimensions) {
-  if (that.mKinematicFunction) {
-    mKinematicFunction = static_cast<TF1*>(
-        that.mKinematicFunction->Clone(TUUID().AsString()));
-  }  // if
+, mDimensions(that.mDimensions)
+, mCachedVariable(0.)
+, mCachedUnsmeared(0.)
+, mCachedResolution(0.)
+, mCacheValid(false) {
+  // Copies share the compiled functions, so cost no compilation
   if (that.mFormula) {
     mFormula = static_cast<FormulaString*>(that.mFormula->Clone());
   }  // if
+  for (unsigned i(0); i < that.mScan.size(); ++i) {
+    mScan.push_back(static_cast<FormulaString*>(that.mScan.at(i)->Clone()));
+  }  // for
 }
 
 Device::~Device() {
+  SetScan(std::vector<TString>());
   if (mFormula) {
     delete mFormula;
     mFormula = NULL;
   }  // if
-  if (mKinematicFunction) {
-    delete mKinematicFunction;
-    mKinematicFunction = NULL;
-  }  // if
 }
 
 void Device::Smear(const erhic::VirtualParticle &prt, ParticleMCS &out) {
@@ -100,16 +107,49 @@ void Device::Smear(const erhic::VirtualParticle &prt, ParticleMCS &out) {
   if (!Accept.Is(prt)) {
     return;
   }  // if
+  SmearAccepted(prt, out);
+}
+
+void Device::SetScan(const std::vector<TString>& resolutions) {
+  for (unsigned i(0); i < mScan.size(); ++i) {
+    delete mScan.at(i);
+  }  // for
+  mScan.clear();
+  for (unsigned i(0); i < resolutions.size(); ++i) {
+    mScan.push_back(new FormulaString(resolutions.at(i).Data()));
+  }  // for
+}
+
+void Device::SmearAccepted(const erhic::VirtualParticle &prt,
+                           ParticleMCS &out) {
   // Get each argument for the resolution function from the particle.
   const std::vector<KinType> vars = mFormula->Variables();
   std::vector<double> args;
   for (unsigned i(0); i < vars.size(); ++i) {
     args.push_back(GetVariable(prt, vars.at(i)));
   }  // for
-  // Evaluate the quantity to smear and the resolution, then throw
-  // a random smeared value.
-  double unsmeared = mKinematicFunction->Eval(GetVariable(prt, mSmeared));
-  double resolution = mFormula->Eval(args);
+  // Evaluate the quantity to smear and the resolution, unless they are
+  // known from the previous particle, then throw a random smeared value.
+  const double variable = GetVariable(prt, mSmeared);
+  if (!mCacheValid || variable != mCachedVariable || args != mCachedArgs) {
+    mCachedUnsmeared = mKinematicFunction->Eval(variable);
+    mCachedResolution = mFormula->Eval(args);
+    mCachedVariable = variable;
+    mCachedArgs.swap(args);
+    mCacheValid = true;
+  }  // if
+  double unsmeared = mCachedUnsmeared;
+  double resolution = mCachedResolution;
+  // Scan points use their own resolution, with the same random numbers
+  const int point = Distributor::GetScanPoint();
+  if (point >= 0 && point < static_cast<int>(mScan.size())) {
+    const std::vector<KinType> scanVars = mScan.at(point)->Variables();
+    std::vector<double> scanArgs;
+    for (unsigned i(0); i < scanVars.size(); ++i) {
+      scanArgs.push_back(GetVariable(prt, scanVars.at(i)));
+    }  // for
+    resolution = mScan.at(point)->Eval(scanArgs);
+  }  // if
   double smeared = mDistribution.Generate(unsmeared, resolution);
   // mDistribution.Print();
   if ( false && abs(prt.Id())==11){
@@ -149,6 +189,10 @@ void Device::Print(Option_t* /* option */) const {
   const std::string name = FormulaString::GetKinName(mSmeared);
   std::cout << "Device smearing " << name << " with sigma(" << name <<
   ") = " << mFormula->GetInputString() << std::endl;
+  for (unsigned i(0); i < mScan.size(); ++i) {
+    std::cout << "  scan point " << i << ": sigma(" << name << ") = " <<
+    mScan.at(i)->GetInputString() << std::endl;
+  }  // for
 }
 
 }  // namespace Smear
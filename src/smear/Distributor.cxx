@@ -9,10 +9,41 @@
 
 #include "eicsmear/smear/Distributor.h"
 
+#include <cstddef>
+#include <vector>
+
+#include <RVersion.h>
 #include <TF1.h>
 #include <TRandom.h>
 #include <TUUID.h>
 
+namespace {
+
+// Generator of the calling thread, NULL for gRandom
+thread_local TRandom* threadRandom(NULL);
+
+// Scan point of the calling thread, -1 outside a scan, with the
+// standard-normal deviates recorded by point 0 and the next to reuse
+thread_local int scanPoint(-1);
+thread_local std::vector<double> deviates;
+thread_local std::size_t nextDeviate(0);
+
+/*
+ Returns a standard-normal deviate for the current scan point.
+ */
+double scanDeviate(TRandom* random) {
+  if (scanPoint > 0 && nextDeviate < deviates.size()) {
+    return deviates[nextDeviate++];
+  }  // if
+  const double z = random->Gaus(0., 1.);
+  if (scanPoint == 0) {
+    deviates.push_back(z);
+  }  // if
+  return z;
+}
+
+}  // anonymous namespace
+
 namespace Smear {
 
 Distributor::Distributor()
@@ -44,17 +75,52 @@ Distributor::~Distributor() {
 
 double Distributor::Generate(double mean, double sigma) {
   double random(0.);
-  if (!mDistribution) {
-    random = gRandom->Gaus(mean, sigma);
+  if (!mDistribution && scanPoint >= 0) {
+    random = mean + sigma * scanDeviate(GetRandom());
+  } else if (!mDistribution) {
+    random = GetRandom()->Gaus(mean, sigma);
   } else {
     mDistribution->SetParameters(mean, sigma);
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 24, 0)
+    if (mMinus > 0. || mPlus > 0.) {
+      random = mDistribution->GetRandom(mean - mMinus, mean + mPlus,
+                                        GetRandom());
+    } else {
+      random = mDistribution->GetRandom(GetRandom());
+    }  // if
+#else
     if (mMinus > 0. || mPlus > 0.) {
       random = mDistribution->GetRandom(mean - mMinus, mean + mPlus);
     } else {
       random = mDistribution->GetRandom();
     }  // if
+#endif
   }  // if
   return random;
 }
 
+void Distributor::SetThreadRandom(TRandom* random) {
+  threadRandom = random;
+}
+
+TRandom* Distributor::GetRandom() {
+  return threadRandom ? threadRandom : gRandom;
+}
+
+void Distributor::BeginScanPoint(int point) {
+  scanPoint = point;
+  nextDeviate = 0;
+  if (point == 0) {
+    deviates.clear();
+  }  // if
+}
+
+void Distributor::EndScan() {
+  scanPoint = -1;
+}
+
+int Distributor::GetScanPoint() {
+  return scanPoint;
+}
+
 }  // namespace Smear
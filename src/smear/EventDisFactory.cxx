@@ -9,20 +9,30 @@
 
 #include "eicsmear/smear/EventDisFactory.h"
 
+#include <string>
 #include <vector>
 
 #include <TBranch.h>
+#include <TTree.h>
 
 #include "eicsmear/erhic/EventDis.h"
+#include "eicsmear/erhic/EventMC.h"
+#include "eicsmear/erhic/OutputPolicy.h"
 #include "eicsmear/erhic/ParticleIdentifier.h"
 #include "eicsmear/erhic/VirtualParticle.h"
 #include "eicsmear/smear/ParticleMCS.h"
 
 namespace {
 
-Smear::ParticleMCS* mcToSmear(const erhic::VirtualParticle& mc) {
-  Smear::ParticleMCS* p = new Smear::ParticleMCS(mc.Get4Vector(),
-                                                 mc.Id(), mc.GetStatus());
+Smear::ParticleMCS* mcToSmear(const erhic::VirtualParticle& mc,
+                              Smear::ParticlePool* pool) {
+  Smear::ParticleMCS* p(NULL);
+  if (pool) {
+    p = pool->Acquire();
+    p->Reset(mc.Get4Vector(), mc.Id(), mc.GetStatus());
+  } else {
+    p = new Smear::ParticleMCS(mc.Get4Vector(), mc.Id(), mc.GetStatus());
+  }  // if
   p->SetStatus(mc.GetStatus());
   return p;
 }
@@ -32,48 +42,201 @@ Smear::ParticleMCS* mcToSmear(const erhic::VirtualParticle& mc) {
 namespace Smear {
 
 EventDisFactory::~EventDisFactory() {
+  // Return the particles to the pools before they go
+  if (mEvent) {
+    delete mEvent;
+    mEvent = NULL;
+  }  // if
+  for (unsigned i(0); i < mReplicas.size(); ++i) {
+    delete mReplicas.at(i);
+  }  // for
 }
 
 EventDisFactory::EventDisFactory(const Detector& d, TBranch& mcBranch)
 : mDetector(d)
-, mMcEvent(NULL) {
+, mMcEvent(NULL)
+, mDeriveSlim(true)
+, mRecycling(true)
+, mSparse(false)
+, mEvent(NULL)
+, mBranch(NULL) {
   mcBranch.SetAddress(&mMcEvent);
 }
 
+EventDisFactory::EventDisFactory(const Detector& d, TTree& mcTree)
+: mDetector(d)
+, mMcEvent(NULL)
+, mDeriveSlim(true)
+, mRecycling(true)
+, mSparse(false)
+, mEvent(NULL)
+, mBranch(NULL) {
+  mcTree.SetBranchAddress("event", &mMcEvent);
+}
+
+EventDisFactory::EventDisFactory(const Detector& d)
+: mDetector(d)
+, mMcEvent(NULL)
+, mDeriveSlim(false)
+, mRecycling(true)
+, mSparse(false)
+, mEvent(NULL)
+, mBranch(NULL) {
+}
+
 Event* EventDisFactory::Create() {
   Event* event = new Event;
-  for (unsigned j(0); j < mMcEvent->GetNTracks(); j++) {
-    const erhic::VirtualParticle* ptr = mMcEvent->GetTrack(j);
+  Build(*event);
+  return event;
+}
+
+TBranch* EventDisFactory::Branch(TTree& tree, const std::string& name,
+                                 const erhic::OutputPolicy& policy) {
+  AllocateEvent();
+  mBranch = policy.Branch(tree, name, EventName(), &mEvent);
+  return mBranch;
+}
+
+std::vector<TBranch*> EventDisFactory::BranchReplicas(
+    const std::vector<TTree*>& trees, const std::string& name,
+    const erhic::OutputPolicy& policy) {
+  AllocateReplicas(trees.size());
+  std::vector<TBranch*> branches;
+  for (unsigned i(0); i < trees.size(); ++i) {
+    TBranch* branch =
+      policy.Branch(*trees.at(i), name, EventName(), &mReplicas.at(i));
+    if (!branch) {
+      return std::vector<TBranch*>();
+    }  // if
+    branches.push_back(branch);
+  }  // for
+  mReplicaBranches = branches;
+  return branches;
+}
+
+void EventDisFactory::AllocateEvent() {
+  if (!mEvent) {
+    mEvent = new Event;
+    mEvent->SetParticlePool(&mPool);
+  }  // if
+}
+
+void EventDisFactory::AllocateReplicas(unsigned n) {
+  for (unsigned i(0); i < mReplicas.size(); ++i) {
+    delete mReplicas.at(i);
+  }  // for
+  mReplicas.clear();
+  mReplicaPools.clear();
+  mReplicaPools.resize(n);
+  for (unsigned i(0); i < n; ++i) {
+    mReplicas.push_back(new Event);
+    mReplicas.back()->SetParticlePool(&mReplicaPools.at(i));
+  }  // for
+}
+
+void EventDisFactory::Fill(TBranch& branch) {
+  if (!mRecycling) {
+    EventFactory<Event>::Fill(branch);
+    return;
+  }  // if
+  AllocateEvent();
+  // The address stays valid, so only needs setting for a new branch
+  if (mBranch != &branch) {
+    branch.ResetAddress();
+    branch.SetAddress(&mEvent);
+    mBranch = &branch;
+  }  // if
+  mEvent->Reset();
+  Build(*mEvent);
+  branch.GetTree()->Fill();
+}
+
+void EventDisFactory::FillReplicas(const std::vector<TBranch*>& branches) {
+  // The addresses stay valid, so only need setting for new branches,
+  // unless created by BranchReplicas()
+  if (branches != mReplicaBranches) {
+    AllocateReplicas(branches.size());
+    for (unsigned i(0); i < branches.size(); ++i) {
+      branches.at(i)->ResetAddress();
+      branches.at(i)->SetAddress(&mReplicas.at(i));
+    }  // for
+    mReplicaBranches = branches;
+  }  // if
+  for (unsigned i(0); i < mReplicas.size(); ++i) {
+    mReplicas.at(i)->Reset();
+  }  // for
+  Build(mReplicas.data(), mReplicas.size());
+  // Fill each tree once, however many of the branches it holds
+  for (unsigned i(0); i < branches.size(); ++i) {
+    TTree* tree = branches.at(i)->GetTree();
+    bool filled(false);
+    for (unsigned j(0); j < i && !filled; ++j) {
+      filled = (branches.at(j)->GetTree() == tree);
+    }  // for
+    if (!filled) {
+      tree->Fill();
+    }  // if
+  }  // for
+}
+
+void EventDisFactory::Build(Event& event) {
+  Event* events[] = {&event};
+  Build(events, 1);
+}
+
+void EventDisFactory::Build(Event* const* events, unsigned nEvents) {
+  // Slim events don't store the particle quantities used for smearing
+  erhic::EventMC* mcEvent = dynamic_cast<erhic::EventMC*>(mMcEvent);
+  if (mDeriveSlim && mcEvent && mcEvent->IsSlim()) {
+    mcEvent->ComputeDerivedQuantities();
+  }  // if
+  mPools.resize(nEvents);
+  for (unsigned k(0); k < nEvents; ++k) {
+    events[k]->SetSparse(mSparse);
+    mPools.at(k) = events[k]->GetParticlePool();
+  }  // for
+  // Only read the Monte Carlo event from here on, as it may be shared
+  // with factories smearing it in other threads.
+  const erhic::EventDis* mc = mMcEvent;
+  // Look up the special particles once per event, not once per track.
+  const erhic::VirtualParticle* scattered = mc->ScatteredLepton();
+  const erhic::VirtualParticle* beamLepton = mc->BeamLepton();
+  const erhic::VirtualParticle* beamHadron = mc->BeamHadron();
+  // Test the acceptance of all tracks by each device in one pass
+  mDetector.Accept(*mc, mTracks, mAccepted);
+  const unsigned nDevices = mDetector.GetNDevices();
+  for (unsigned j(0); j < mc->GetNTracks(); j++) {
+    const erhic::VirtualParticle* ptr = mc->GetTrack(j);
     if (!ptr) {
       continue;
     }  // if
-    // If this is the scattered lepton, record the index.
-    // Set the index even if the particle turns out to be outside the
-    // acceptance (in which case it will just point to a NULL anyway).
-    if (mMcEvent->ScatteredLepton() == ptr) {
-      ParticleMCS* p = mDetector.Smear(*ptr);
-      if (p) {
-        p->SetStatus(ptr->GetStatus());
-        event->SetScattered(j);
-      }  // if
-      event->AddLast(p);
-      // Only set the index if the scattered electron is detected
-    } else if (mMcEvent->BeamLepton() == ptr ||
-	       mMcEvent->BeamHadron() == ptr) {
+    if (beamLepton == ptr || beamHadron == ptr) {
       // It's convenient to keep the initial beams, unsmeared, in the
       // smeared event record, so copy their properties exactly
-      event->AddLast(mcToSmear(*ptr));
-    } else {
-      ParticleMCS* p = mDetector.Smear(*ptr);
+      for (unsigned k(0); k < nEvents; ++k) {
+        events[k]->AddLast(mcToSmear(*ptr, mPools.at(k)), j);
+      }  // for
+      continue;
+    }  // if
+    mDetector.Smear(*ptr, mAccepted.data() + j * nDevices, mPools,
+                    mSmeared);
+    for (unsigned k(0); k < nEvents; ++k) {
+      ParticleMCS* p = mSmeared.at(k);
       if (p) {
         p->SetStatus(ptr->GetStatus());
+        // If this is the scattered lepton, record the index.
+        // Only set the index if the scattered electron is detected.
+        if (scattered == ptr) {
+          events[k]->SetScattered(events[k]->GetNTracks());
+        }  // if
       }  // if
-      event->AddLast(p);
-    }  // if
+      events[k]->AddLast(p, j);
+    }  // for
   }  // for
   // Fill the event-wise kinematic variables.
-  mDetector.FillEventKinematics(event);
-  return event;
+  for (unsigned k(0); k < nEvents; ++k) {
+    mDetector.FillEventKinematics(events[k]);
+  }  // for
 }
 
 }  // namespace Smear
@@ -10,13 +10,19 @@
 #include "eicsmear/smear/EventSmear.h"
 
 #include <iostream>
+#include <string>
 #include <vector>
 
+#include "eicsmear/smear/ParticlePool.h"
+
 namespace Smear {
 
 Event::Event()
 : nTracks(0)
-, mScatteredIndex(-1) {
+, mScatteredIndex(-1)
+, mSparse(false)
+, mPool(NULL)
+, mSmearedIndicesValid(false) {
 }
 
 Event::~Event() {
@@ -24,20 +30,75 @@ Event::~Event() {
 }
 
 void Event::ClearParticles() {
-  for (unsigned i(0); i < particles.size(); ++i) {
-    if (GetTrack(i)) {
-      delete GetTrack(i);
-    }  // if
-  }  // for
+  if (mPool) {
+    mPool->Release();
+  } else {
+    for (unsigned i(0); i < particles.size(); ++i) {
+      if (GetTrack(i)) {
+        delete GetTrack(i);
+      }  // if
+    }  // for
+  }  // if
+  particles.clear();
+  mTruthIndices.clear();
+  mSmearedIndicesValid = false;
 }
 
 void Event::Reset() {
   ClearParticles();
+  // Keep the pool, and the storage of the particle lists, for reuse.
+  ParticlePool* pool = mPool;
+  std::vector<ParticleMCS*> storage;
+  storage.swap(particles);
+  std::vector<Int_t> truthStorage;
+  truthStorage.swap(mTruthIndices);
+  std::vector<Int_t> smearedStorage;
+  smearedStorage.swap(mSmearedIndices);
   *this = Event();
+  particles.swap(storage);
+  mTruthIndices.swap(truthStorage);
+  mSmearedIndices.swap(smearedStorage);
+  mPool = pool;
 }
 
 void Event::AddLast(ParticleMCS* track) {
   particles.push_back(track);
+  mSmearedIndicesValid = false;
+}
+
+void Event::AddLast(ParticleMCS* track, Int_t truthIndex) {
+  if (!mSparse) {
+    AddLast(track);
+  } else if (track) {
+    particles.push_back(track);
+    mTruthIndices.push_back(truthIndex);
+    mSmearedIndicesValid = false;
+  }  // if
+}
+
+const ParticleMCS* Event::GetTrackFromTruth(UInt_t truthIndex) const {
+  if (!mSparse) {
+    return GetTrack(truthIndex);
+  }  // if
+  if (!mSmearedIndicesValid) {
+    mSmearedIndices.clear();
+    for (unsigned i(0); i < mTruthIndices.size(); ++i) {
+      const Int_t truth = mTruthIndices.at(i);
+      if (truth < 0) {
+        continue;
+      }  // if
+      if (unsigned(truth) >= mSmearedIndices.size()) {
+        mSmearedIndices.resize(truth + 1, -1);
+      }  // if
+      mSmearedIndices.at(truth) = i;
+    }  // for
+    mSmearedIndicesValid = true;
+  }  // if
+  if (truthIndex >= mSmearedIndices.size() ||
+      mSmearedIndices.at(truthIndex) < 0) {
+    return NULL;
+  }  // if
+  return GetTrack(mSmearedIndices.at(truthIndex));
 }
 
 // The scattered lepton should be the first non-NULL entry in the track list
@@ -54,15 +115,8 @@ const ParticleMCS* Event::ScatteredLepton() const {
 // The stored Particle* are pointers to the original particles in the event
 // so don't delete them!
 void Event::HadronicFinalState(ParticlePtrList& final) const {
-  // Skip the first two entries, as these are the incident beams
-  for (unsigned i(2); i < GetNTracks(); ++i) {
-    if (!GetTrack(i)) {
-      continue;
-    }  // if
-    if (GetTrack(i) != ScatteredLepton()) {
-      final.push_back(GetTrack(i));
-    }  // if
-  }  // for
+  ParticleView hadrons = HadronicFinalStateParticles();
+  final.insert(final.end(), hadrons.begin(), hadrons.end());
 }
 
 std::vector<const erhic::VirtualParticle*> Event::GetTracks() const {
@@ -90,4 +144,8 @@ void Event::Print(Option_t* /* unused */) const {
   }  // for
 }
 
+bool Event::IsBookkeepingMember(const std::string& name) {
+  return name == "mScatteredIndex" || name == "mSparse";
+}
+
 }  // namespace Smear
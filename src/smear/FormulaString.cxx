@@ -10,15 +10,20 @@
 #include "eicsmear/smear/FormulaString.h"
 
 #include <algorithm>
+#include <cctype>
 #include <iterator>
 #include <list>
 #include <map>
+#include <mutex>
 #include <string>
 #include <vector>
 
+#include <TF1.h>
 #include <TFormula.h>
+#include <TROOT.h>
 #include <TString.h>
 #include <TUUID.h>
+#include <TVirtualMutex.h>
 
 namespace {
 
@@ -57,6 +62,24 @@ const std::map<std::string, Smear::KinType>& kinTypeTable() {
   return kinTypes;
 }
 
+// Compiled formulas and functions keyed by their parsed expression.
+// Never deleted, as they may be in use until the process exits.
+std::mutex compiledMutex;
+std::map<std::string, const TFormula*> compiledFormulas;
+std::map<std::string, const TF1*> compiledFunctions;
+
+// Returns the expression with whitespace removed.
+std::string normalize(const std::string& expression) {
+  std::string normalized;
+  for (std::string::const_iterator i = expression.begin();
+      i != expression.end(); ++i) {
+    if (!std::isspace(static_cast<unsigned char>(*i))) {
+      normalized.push_back(*i);
+    }  // if
+  }  // for
+  return normalized;
+}
+
 }  // anonymous namespace
 
 namespace Smear {
@@ -66,10 +89,7 @@ namespace Smear {
 // as accepted by TFormula.
 
 FormulaString::~FormulaString() {
-  if (mFormula) {
-    delete mFormula;
-    mFormula = NULL;
-  }  // if
+  // The compiled formula belongs to the cache (see Compile())
 }
 
 FormulaString::FormulaString()
@@ -79,11 +99,59 @@ FormulaString::FormulaString()
 FormulaString::FormulaString(const std::string& formula)
 : mFormula(NULL)
 , mInput(formula) {
-  std::string f = Parse(formula);
-  mFormula = new TFormula(TUUID().AsString(), f.c_str());
+  Parse(formula);
+  mFormula = Compile(formula);
+}
+
+FormulaString::FormulaString(const FormulaString& that)
+: TObject(that)
+, mFormula(that.mFormula)
+, mInput(that.mInput)
+, mVariables(that.mVariables) {
+}
+
+FormulaString* FormulaString::Clone(const char* /** Unused */) const {
+  return new FormulaString(*this);
+}
+
+const TFormula* FormulaString::Compile(const std::string& formula) {
+  if (formula.empty()) {
+    return NULL;
+  }  // if
+  const std::string expression = normalize(FormulaString().Parse(formula));
+  std::lock_guard<std::mutex> lock(compiledMutex);
+  const TFormula*& compiled = compiledFormulas[expression];
+  if (!compiled) {
+    // Kept out of ROOT's list of functions, which would delete it
+    TFormula* f = new TFormula(TUUID().AsString(), expression.c_str(), false);
+    // Evaluate once, so the formula is ready before any thread shares it
+    f->Eval(0., 0., 0., 0.);
+    compiled = f;
+  }  // if
+  return compiled;
+}
+
+const TF1* FormulaString::CompileFunction(const std::string& formula) {
+  const std::string expression = normalize(FormulaString().Parse(formula));
+  std::lock_guard<std::mutex> lock(compiledMutex);
+  const TF1*& compiled = compiledFunctions[expression];
+  if (!compiled) {
+    TF1* f = new TF1(TUUID().AsString(), expression.c_str(), -1e15, 1.e16);
+    {
+      // Kept out of ROOT's list of functions, which would delete it
+      R__LOCKGUARD(gROOTMutex);
+      gROOT->GetListOfFunctions()->Remove(f);
+    }
+    f->Eval(0.);
+    compiled = f;
+  }  // if
+  return compiled;
 }
 
 double FormulaString::Eval(const std::vector<double>& args) const {
+  if (!mFormula) {
+    return 0.;
+  }  // if
   if (args.size() != mVariables.size()) {
     std::cerr << "FormulaString::Eval() got " << args.size() <<
     " arguments, expected " << mVariables.size() << std::endl;
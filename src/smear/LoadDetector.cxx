@@ -0,0 +1,270 @@
+/**
+ \file
+ Compilation of detector macros into cached shared libraries, and
+ loading of detectors from them.
+
+ \date      2026-10-18
+ \copyright 2026 Brookhaven National Lab
+ */
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <RVersion.h>
+#include <TMD5.h>
+#include <TROOT.h>
+#include <TString.h>
+#include <TSystem.h>
+
+#include "eicsmear/functions.h"
+#include "eicsmear/smear/Detector.h"
+#include "eicsmear/smear/functions.h"
+
+namespace {
+
+// Headers a detector macro may rely on the interpreter to provide
+const char* const macroHeaders[] = {
+  "cmath",
+  "TMath.h",
+  "eicsmear/erhic/VirtualParticle.h",
+  "eicsmear/smear/Acceptance.h",
+  "eicsmear/smear/Bremsstrahlung.h",
+  "eicsmear/smear/Detector.h",
+  "eicsmear/smear/Device.h",
+  "eicsmear/smear/Distributor.h",
+  "eicsmear/smear/FormulaString.h",
+  "eicsmear/smear/NumSigmaPid.h",
+  "eicsmear/smear/ParticleID.h",
+  "eicsmear/smear/PerfectID.h",
+  "eicsmear/smear/PlanarTracker.h",
+  "eicsmear/smear/RadialTracker.h",
+  "eicsmear/smear/Smear.h",
+  "eicsmear/smear/Smearer.h",
+  "eicsmear/smear/Tracker.h"
+};
+
+/*
+ Where to find a compiled detector: the shared library, the name of
+ the function it exports and, for compiling it, the macro source.
+ */
+struct CacheEntry {
+  TString directory;
+  TString name;  // Base name of the library, macro name and hash
+  TString library;  // Full path, without extension
+  TString symbol;
+  TString function;  // Function in the macro returning the detector
+  std::string source;
+};
+
+/*
+ Returns the function building the detector: the one given or, by
+ default, the one named after the macro file, as ROOT does.
+ */
+TString detectorFunction(const TString& macro, const TString& function) {
+  if (!function.IsNull()) {
+    return function;
+  }  // if
+  TString name = gSystem->BaseName(macro);
+  const Ssiz_t dot = name.Last('.');
+  if (dot != kNPOS) {
+    name.Remove(dot);
+  }  // if
+  return name;
+}
+
+/*
+ Returns the cache directory given, else $EICSMEAR_DETECTOR_CACHE,
+ else ~/.cache/eic-smear/detectors.
+ */
+TString cacheDirectory(const TString& cacheDir) {
+  if (!cacheDir.IsNull()) {
+    return cacheDir;
+  }  // if
+  const char* env = gSystem->Getenv("EICSMEAR_DETECTOR_CACHE");
+  if (env && *env) {
+    return env;
+  }  // if
+  return TString(gSystem->HomeDirectory()) + "/.cache/eic-smear/detectors";
+}
+
+/*
+ Fills the cache entry for the macro, keyed by a hash of its content,
+ the function and the ROOT and eic-smear versions, so editing the macro
+ or updating either library misses the old entry.
+ Returns false if the macro can't be read.
+ */
+bool findEntry(const TString& macro, const TString& function,
+               const TString& cacheDir, CacheEntry& entry) {
+  std::ifstream file(macro.Data());
+  if (!file.good()) {
+    std::cerr << "Unable to read " << macro << std::endl;
+    return false;
+  }  // if
+  std::ostringstream content;
+  content << file.rdbuf();
+  entry.source = content.str();
+  entry.function = detectorFunction(macro, function);
+  TMD5 md5;
+  const std::string key = entry.source + '\n' + entry.function.Data() +
+    '\n' + ROOT_RELEASE + '\n' + erhic::EicSmearVersionString;
+  md5.Update(reinterpret_cast<const UChar_t*>(key.data()), key.size());
+  md5.Final();
+  const TString hash = md5.AsString();
+  TString base = gSystem->BaseName(macro);
+  const Ssiz_t dot = base.Last('.');
+  if (dot != kNPOS) {
+    base.Remove(dot);
+  }  // if
+  entry.directory = cacheDirectory(cacheDir);
+  entry.name = base + "_" + hash;
+  entry.library = entry.directory + "/" + entry.name;
+  entry.symbol = "eicsmear_build_detector_" + hash;
+  return true;
+}
+
+/*
+ Returns true if the compiled library of the entry exists.
+ */
+bool isCached(const CacheEntry& entry) {
+  const TString library = entry.library + "." + gSystem->GetSoExt();
+  return !gSystem->AccessPathName(library);
+}
+
+/*
+ Adds the include directory installed next to the eic-smear library to
+ the compiler's search path, so macros find the eic-smear headers.
+ */
+void addIncludePath() {
+  const char* library = gSystem->DynamicPathName("libeicsmear", kTRUE);
+  if (!library) {
+    return;
+  }  // if
+  const TString include =
+    TString(gSystem->DirName(gSystem->DirName(library))) + "/include";
+  if (!gSystem->AccessPathName(include + "/eicsmear")) {
+    gSystem->AddIncludePath("-I" + include);
+  }  // if
+}
+
+}  // anonymous namespace
+
+/**
+ Compiles the detector macro into a shared library in the cache.
+ The library is built in a directory of its own, and only moved into the
+ cache once complete, so jobs loading detectors meanwhile never see a
+ partial library.
+ */
+int CompileDetector(const TString& macro, const TString& function,
+                    const TString& cacheDir) {
+  CacheEntry entry;
+  if (!findEntry(macro, function, cacheDir, entry)) {
+    return 1;
+  }  // if
+  if (isCached(entry)) {
+    std::cout << macro << " is already compiled as " << entry.library <<
+    std::endl;
+    return 0;
+  }  // if
+  // The cache may be on a filesystem shared by jobs on many hosts, so
+  // the build directory is private to this host and process
+  const TString build = entry.directory + TString::Format(
+    "/build-%s-%d", gSystem->HostName(), gSystem->GetPid());
+  if (gSystem->mkdir(build, kTRUE) != 0) {
+    std::cerr << "Unable to create " << build << std::endl;
+    return 1;
+  }  // if
+  // The macro, behind the headers it may rely on, then a function with
+  // C linkage that the loader finds without the interpreter.
+  const TString wrapper = build + "/" + entry.name + ".cxx";
+  std::ofstream out(wrapper.Data());
+  out << "// Compiled by CompileDetector() from " << macro << std::endl;
+  for (unsigned i(0); i < sizeof(macroHeaders) / sizeof(macroHeaders[0]);
+       ++i) {
+    out << "#include <" << macroHeaders[i] << ">" << std::endl;
+  }  // for
+  out << std::endl << entry.source << std::endl << std::endl <<
+  "extern \"C\" Smear::Detector* " << entry.symbol << "() {" << std::endl <<
+  "  return new Smear::Detector(" << entry.function << "());" << std::endl <<
+  "}" << std::endl;
+  out.close();
+  addIncludePath();
+  // Keep the library, optimise, and compile without loading it
+  const int compiled = gSystem->CompileMacro(wrapper, "kOc",
+                                             build + "/" + entry.name, build);
+  // Move the products into the cache, the library last
+  std::vector<TString> files;
+  void* dir = gSystem->OpenDirectory(build);
+  if (dir) {
+    while (const char* name = gSystem->GetDirEntry(dir)) {
+      const TString file(name);
+      if (file != "." && file != "..") {
+        files.push_back(file);
+      }  // if
+    }  // while
+    gSystem->FreeDirectory(dir);
+  }  // if
+  const TString library = entry.name + "." + gSystem->GetSoExt();
+  for (unsigned pass(0); pass < 2; ++pass) {
+    for (unsigned i(0); i < files.size(); ++i) {
+      const TString& file = files.at(i);
+      const bool product = compiled && file.BeginsWith(entry.name) &&
+                           (file.EndsWith(".pcm") || file == library);
+      if (product && (file == library) == (pass == 1)) {
+        gSystem->Rename(build + "/" + file, entry.directory + "/" + file);
+      } else if (!product && pass == 1) {
+        gSystem->Unlink(build + "/" + file);
+      }  // if
+    }  // for
+  }  // for
+  gSystem->Unlink(build);
+  if (!compiled || !isCached(entry)) {
+    std::cerr << "Unable to compile " << macro << std::endl;
+    return 1;
+  }  // if
+  std::cout << "Compiled " << macro << " as " << entry.library << std::endl;
+  return 0;
+}
+
+/**
+ Returns the detector from the compiled library of the macro if it is
+ in the cache, else by interpreting the macro.
+ */
+Smear::Detector* LoadDetector(const TString& macro, const TString& function,
+                              const TString& cacheDir) {
+  CacheEntry entry;
+  if (!findEntry(macro, function, cacheDir, entry)) {
+    return NULL;
+  }  // if
+  if (isCached(entry)) {
+    if (gSystem->Load(entry.library) >= 0) {
+      typedef Smear::Detector* (*Builder)();
+      Builder build = reinterpret_cast<Builder>(
+        gSystem->DynFindSymbol(entry.library, entry.symbol));
+      if (build) {
+        return build();
+      }  // if
+    }  // if
+    std::cerr << "Unable to load " << entry.library <<
+    ", interpreting " << macro << " instead" << std::endl;
+  } else {
+    std::cout << "No compiled " << macro << " in " << entry.directory <<
+    ", interpreting it (see CompileDetector())" << std::endl;
+  }  // if
+  if (gROOT->LoadMacro(macro) != 0) {
+    std::cerr << "Unable to load " << macro << std::endl;
+    return NULL;
+  }  // if
+  int error(0);
+  Smear::Detector* detector = reinterpret_cast<Smear::Detector*>(
+    gROOT->ProcessLineFast("new Smear::Detector(" + entry.function + "());",
+                           &error));
+  if (error != 0) {
+    std::cerr << "Unable to call " << entry.function << "() from " <<
+    macro << std::endl;
+    return NULL;
+  }  // if
+  return detector;
+}
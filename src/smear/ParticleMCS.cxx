@@ -11,13 +11,24 @@
 
 #include <iomanip>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 
 #include <TMath.h>
 
+namespace {
+
+// Counts values reset by ParticleMCS::HandleBogusValues() in each
+// thread, so a thread counting its own corrections sees no others.
+thread_local ULong64_t nBogusValues(0);
+
+}  // anonymous namespace
+
 namespace Smear {
 
 ParticleMCS::ParticleMCS()
-: status(0)
+: mSmearFlags(0)
+, status(0)
 , id(0)
 , px(0.)
 , py(0.)
@@ -33,7 +44,8 @@ ParticleMCS::ParticleMCS()
 }
 
 ParticleMCS::ParticleMCS(const TLorentzVector& ep, int pdg, int stat)
-: status(stat)
+: mSmearFlags(0)
+, status(stat)
 , id(pdg)
 , px(ep.Px())
 , py(ep.Py())
@@ -51,6 +63,36 @@ ParticleMCS::ParticleMCS(const TLorentzVector& ep, int pdg, int stat)
 ParticleMCS::~ParticleMCS() {
 }
 
+void ParticleMCS::Reset() {
+  mSmearFlags = 0;
+  status = 0;
+  id = 0;
+  px = 0.;
+  py = 0.;
+  pz = 0.;
+  E = 0.;
+  pt = 0.;
+  p = 0.;
+  theta = 0.;
+  phi = 0.;
+  numSigma = std::nan("");
+  numSigmaType = 0;
+}
+
+void ParticleMCS::Reset(const TLorentzVector& ep, int pdg, int stat) {
+  Reset();
+  status = stat;
+  id = pdg;
+  px = ep.Px();
+  py = ep.Py();
+  pz = ep.Pz();
+  E = ep.E();
+  pt = ep.Pt();
+  p = ep.P();
+  theta = ep.Theta();
+  phi = ep.Phi();
+}
+
 TLorentzVector ParticleMCS::Get4Vector() const {
   return TLorentzVector(px, py, pz, E);
 }
@@ -154,17 +196,17 @@ Double_t ParticleMCS::GetRapidity() const {
     return numSigmaType;
   }
 
-  bool ParticleMCS::IsSmeared() const { return kParticleSmeared; }
-  bool ParticleMCS::IsESmeared() const { return kESmeared; }
-  bool ParticleMCS::IsPSmeared() const { return kPSmeared; }
-  bool ParticleMCS::IsPtSmeared() const { return kPtSmeared; }
-  bool ParticleMCS::IsPxSmeared() const { return kPxSmeared; }
-  bool ParticleMCS::IsPySmeared() const { return kPySmeared; }
-  bool ParticleMCS::IsPzSmeared() const { return kPzSmeared; }
-  bool ParticleMCS::IsThetaSmeared() const { return kThetaSmeared; }
-  bool ParticleMCS::IsPhiSmeared() const { return kPhiSmeared; }
-  bool ParticleMCS::IsIdSmeared() const { return kIdSmeared; }
-  bool ParticleMCS::IsNumSigmaSmeared() const { return kNumSigmaSmeared; }
+  bool ParticleMCS::IsSmeared() const { return TestSmearFlag(kSmearedParticle); }
+  bool ParticleMCS::IsESmeared() const { return TestSmearFlag(kSmearedE); }
+  bool ParticleMCS::IsPSmeared() const { return TestSmearFlag(kSmearedP); }
+  bool ParticleMCS::IsPtSmeared() const { return TestSmearFlag(kSmearedPt); }
+  bool ParticleMCS::IsPxSmeared() const { return TestSmearFlag(kSmearedPx); }
+  bool ParticleMCS::IsPySmeared() const { return TestSmearFlag(kSmearedPy); }
+  bool ParticleMCS::IsPzSmeared() const { return TestSmearFlag(kSmearedPz); }
+  bool ParticleMCS::IsThetaSmeared() const { return TestSmearFlag(kSmearedTheta); }
+  bool ParticleMCS::IsPhiSmeared() const { return TestSmearFlag(kSmearedPhi); }
+  bool ParticleMCS::IsIdSmeared() const { return TestSmearFlag(kSmearedId); }
+  bool ParticleMCS::IsNumSigmaSmeared() const { return TestSmearFlag(kSmearedNumSigma); }
   
   // -----------------------------------------------------------
   void ParticleMCS::SetVariable( const double z, const KinType kin) {
@@ -187,56 +229,47 @@ Double_t ParticleMCS::GetRapidity() const {
   }
 
   void ParticleMCS::SetE(const Double_t value, const bool CheckSetSmearFlag){
-    if ( kESmeared && CheckSetSmearFlag ) throw std::runtime_error ("Attempting to smear E twice");
-    else kESmeared = true;
+    MarkSmeared(kSmearedE, CheckSetSmearFlag, "E");
     E = value;
   }
 
   void ParticleMCS::SetP(Double_t value, const bool CheckSetSmearFlag){
-    if ( kPSmeared && CheckSetSmearFlag ) throw std::runtime_error ("Attempting to smear P twice");
-    else kPSmeared = true;
+    MarkSmeared(kSmearedP, CheckSetSmearFlag, "P");
     p = value;
   }
 
   void ParticleMCS::SetPt(Double_t value, const bool CheckSetSmearFlag){
-    if ( kPtSmeared && CheckSetSmearFlag ) throw std::runtime_error ("Attempting to smear Pt twice");
-    else kPtSmeared = true;
+    MarkSmeared(kSmearedPt, CheckSetSmearFlag, "Pt");
     pt = value;
   }
 
   void ParticleMCS::SetPx(Double_t value, const bool CheckSetSmearFlag){
-    if ( kPxSmeared && CheckSetSmearFlag ) throw std::runtime_error ("Attempting to smear Px twice");
-    else kPxSmeared = true;
+    MarkSmeared(kSmearedPx, CheckSetSmearFlag, "Px");
     px = value;
   }
 
   void ParticleMCS::SetPy(Double_t value, const bool CheckSetSmearFlag){
-    if ( kPySmeared && CheckSetSmearFlag ) throw std::runtime_error ("Attempting to smear Py twice");
-    else kPySmeared = true;
+    MarkSmeared(kSmearedPy, CheckSetSmearFlag, "Py");
     py = value;
   }
 
   void ParticleMCS::SetPz(Double_t value, const bool CheckSetSmearFlag){
-    if ( kPzSmeared && CheckSetSmearFlag ) throw std::runtime_error ("Attempting to smear Pz twice");
-    else kPzSmeared = true;
+    MarkSmeared(kSmearedPz, CheckSetSmearFlag, "Pz");
     pz = value;
   }
 
   void ParticleMCS::SetPhi(Double_t value, const bool CheckSetSmearFlag){
-    if ( kPhiSmeared && CheckSetSmearFlag ) throw std::runtime_error ("Attempting to smear Phi twice");
-    else kPhiSmeared = true;
+    MarkSmeared(kSmearedPhi, CheckSetSmearFlag, "Phi");
     phi = value;
   }
 
   void ParticleMCS::SetTheta(Double_t value, const bool CheckSetSmearFlag){
-    if ( kThetaSmeared && CheckSetSmearFlag ) throw std::runtime_error ("Attempting to smear Theta twice");
-    else kThetaSmeared = true;
+    MarkSmeared(kSmearedTheta, CheckSetSmearFlag, "Theta");
     theta = value;
   }
 
   void ParticleMCS::SetId(Int_t i, const bool CheckSetSmearFlag){
-    if ( kIdSmeared && CheckSetSmearFlag ) throw std::runtime_error ("Attempting to smear Id twice");
-    else kIdSmeared = true;	
+    MarkSmeared(kSmearedId, CheckSetSmearFlag, "Id");
     id = i;
   }
 
@@ -245,8 +278,7 @@ Double_t ParticleMCS::GetRapidity() const {
   }
 
   void ParticleMCS::SetNumSigma( const double d, const bool CheckSetSmearFlag){
-    if ( kNumSigmaSmeared && CheckSetSmearFlag ) throw std::runtime_error ("Attempting to smear numSigma twice");
-    else kNumSigmaSmeared = true;
+    MarkSmeared(kSmearedNumSigma, CheckSetSmearFlag, "numSigma");
     numSigma = d;
   }
 
@@ -254,6 +286,15 @@ Double_t ParticleMCS::GetRapidity() const {
     numSigmaType = i;
   }
 
+  void ParticleMCS::MarkSmeared(SmearFlag flag, const bool check,
+                                const char* name) {
+    if (check && TestSmearFlag(flag)) {
+      throw std::runtime_error(std::string("Attempting to smear ") + name +
+                               " twice");
+    }  // if
+    SetSmearFlag(flag, true);
+  }
+
   erhic::Pid ParticleMCS::Id() const {
     return ::erhic::Pid(id);
   }
@@ -262,23 +303,30 @@ Double_t ParticleMCS::GetRapidity() const {
     double fault(0.);
     if (kE == kin && GetE() < 0.) {
       SetE(fault, false);
+      ++nBogusValues;
     } else if (kP == kin && GetP() < 0.) {
       SetP(fault, false);
+      ++nBogusValues;
     } else if (kPt == kin && GetPt() < 0.) {
       SetPt(fault, false);
+      ++nBogusValues;
     }
   }  
+
+  ULong64_t ParticleMCS::GetNBogusValues() {
+    return nBogusValues;
+  }
   
-  void ParticleMCS::SetSmeared( bool flag) {kParticleSmeared=flag;}
-  void ParticleMCS::SetESmeared( bool flag) {kESmeared=flag;}
-  void ParticleMCS::SetPSmeared( bool flag) {kPSmeared=flag;}
-  void ParticleMCS::SetPtSmeared( bool flag) {kPtSmeared=flag;}
-  void ParticleMCS::SetPxSmeared( bool flag) {kPxSmeared=flag;}
-  void ParticleMCS::SetPySmeared( bool flag) {kPySmeared=flag;}
-  void ParticleMCS::SetPzSmeared( bool flag) {kPzSmeared=flag;}
-  void ParticleMCS::SetThetaSmeared( bool flag) {kThetaSmeared=flag;}
-  void ParticleMCS::SetPhiSmeared( bool flag) {kPhiSmeared=flag;}
-  void ParticleMCS::SetIdSmeared( bool flag) {kIdSmeared=flag;}
-  void ParticleMCS::SetNumSigmaSmeared( bool flag) {kNumSigmaSmeared=flag;}
+  void ParticleMCS::SetSmeared( bool flag) {SetSmearFlag(kSmearedParticle, flag);}
+  void ParticleMCS::SetESmeared( bool flag) {SetSmearFlag(kSmearedE, flag);}
+  void ParticleMCS::SetPSmeared( bool flag) {SetSmearFlag(kSmearedP, flag);}
+  void ParticleMCS::SetPtSmeared( bool flag) {SetSmearFlag(kSmearedPt, flag);}
+  void ParticleMCS::SetPxSmeared( bool flag) {SetSmearFlag(kSmearedPx, flag);}
+  void ParticleMCS::SetPySmeared( bool flag) {SetSmearFlag(kSmearedPy, flag);}
+  void ParticleMCS::SetPzSmeared( bool flag) {SetSmearFlag(kSmearedPz, flag);}
+  void ParticleMCS::SetThetaSmeared( bool flag) {SetSmearFlag(kSmearedTheta, flag);}
+  void ParticleMCS::SetPhiSmeared( bool flag) {SetSmearFlag(kSmearedPhi, flag);}
+  void ParticleMCS::SetIdSmeared( bool flag) {SetSmearFlag(kSmearedId, flag);}
+  void ParticleMCS::SetNumSigmaSmeared( bool flag) {SetSmearFlag(kSmearedNumSigma, flag);}
 
 }  // namespace Smear
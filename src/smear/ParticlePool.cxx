@@ -0,0 +1,31 @@
+/**
+ \file
+ Implementation of class Smear::ParticlePool.
+
+ \date      2026-10-18
+ \copyright 2026 Brookhaven National Lab
+ */
+
+#include "eicsmear/smear/ParticlePool.h"
+
+namespace Smear {
+
+ParticlePool::ParticlePool()
+: mNAcquired(0) {
+}
+
+ParticlePool::~ParticlePool() {
+}
+
+ParticleMCS* ParticlePool::Acquire() {
+  if (mNAcquired < mParticles.size()) {
+    ParticleMCS* particle = &mParticles[mNAcquired++];
+    particle->Reset();
+    return particle;
+  }  // if
+  mParticles.emplace_back();
+  ++mNAcquired;
+  return &mParticles.back();
+}
+
+}  // namespace Smear
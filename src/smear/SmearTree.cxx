@@ -7,25 +7,45 @@
  \copyright 2011 Brookhaven National Lab
  */
 
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <fstream>
+#include <map>
 #include <sstream>
 #include <cmath>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <TClass.h>
+#include <TDatabasePDG.h>
 #include <TROOT.h>
 #include <TSystem.h>
 #include <TChain.h>
 #include <TString.h>
 #include <TRandom2.h>
+#include <TRandom3.h>
 #include <TTree.h>
+#include <TTreeCache.h>
 #include <TFile.h>
 #include <TStopwatch.h>
 #include <TH1D.h>
+#include <TRegexp.h>
 
+#include "eicsmear/erhic/EventMC.h"
+#include "eicsmear/erhic/InputPolicy.h"
+#include "eicsmear/erhic/OutputPolicy.h"
 #include "eicsmear/erhic/VirtualParticle.h"
 #include "eicsmear/smear/Detector.h"
+#include "eicsmear/smear/DetectorStats.h"
+#include "eicsmear/smear/Distributor.h"
 #include "eicsmear/smear/EventDisFactory.h"
 #include "eicsmear/smear/ParticleMCS.h"
 #include "eicsmear/smear/Smear.h"
@@ -34,58 +54,263 @@
 #include "eicsmear/hadronic/EventSmear.h"
 #endif
 
-/**
- Smear nEvents events from the TTree named EICTree in the named input file,
- using the smearing definitions in the Detector.
- Write the resulting Smeared TTree to a file named outFileName.
- If nEvents <= 0 smear all events in the tree.
- Returns 0 upon success, 1 upon failure.
+namespace {
+
+/*
+ Splits a whitespace- or comma-separated list of file names and expands
+ wildcards in the file name part (not the directory) of each.
+ Expanded names are sorted, so the order doesn't depend on the file system.
  */
-int SmearTree(const Smear::Detector& detector, const TString& inFileName,
-              const TString& outFileName, Long64_t nEvents) {
-  // Open the input file and get the Monte Carlo tree from it.
-  // Complain and quit if we don't find the file or the tree.
-  TFile inFile(inFileName, "READ");
-  if (!inFile.IsOpen()) {
-    std::cerr << "Unable to open " << inFileName << std::endl;
+std::vector<TString> expandFileNames(const TString& names) {
+  std::vector<TString> files;
+  std::istringstream stream(TString(names).ReplaceAll(",", " ").Data());
+  std::string token;
+  while (stream >> token) {
+    TString pattern(token.c_str());
+    TString base = gSystem->BaseName(pattern);
+    if (!base.MaybeWildcard()) {
+      files.push_back(pattern);
+      continue;
+    }  // if
+    TString dir = gSystem->DirName(pattern);
+    TRegexp wildcard(base, kTRUE);
+    std::vector<TString> matches;
+    void* dirp = gSystem->OpenDirectory(dir);
+    if (dirp) {
+      while (const char* entry = gSystem->GetDirEntry(dirp)) {
+        TString name(entry);
+        Ssiz_t length(0);
+        if (wildcard.Index(name, &length) == 0 && length == name.Length()) {
+          matches.push_back(dir + "/" + name);
+        }  // if
+      }  // while
+      gSystem->FreeDirectory(dirp);
+    }  // if
+    if (matches.empty()) {
+      std::cerr << "No files match " << pattern << std::endl;
+    }  // if
+    std::sort(matches.begin(), matches.end());
+    files.insert(files.end(), matches.begin(), matches.end());
+  }  // while
+  return files;
+}
+
+/*
+ Returns the default name of the smeared output for an input file,
+ in outputDirName if it is given, else next to the input.
+ */
+TString smearedFileName(const TString& inFileName,
+                        const TString& outputDirName = "") {
+  TString outName(inFileName);
+  if (!outputDirName.IsNull()) {
+    outName = outputDirName + "/" + gSystem->BaseName(inFileName);
+  }  // if
+  return outName.ReplaceAll(".root", ".smear.root");
+}
+
+/*
+ Input read while smearing: bytes and read calls to all files, and the
+ fraction of reads served by the cache of each input file.
+ */
+class ReadStats {
+ public:
+  ReadStats()
+  : mBytes(TFile::GetFileBytesRead())
+  , mCalls(TFile::GetFileReadCalls())
+  , mStart(std::chrono::steady_clock::now())
+  , mHits(0.)
+  , mEntries(0) {
+  }
+
+  /*
+   Records the cache efficiency of the file the chain is reading,
+   weighted by the number of entries read from it.
+   Call after reading the last entry from each file.
+   */
+  void AddFile(TChain& chain) {
+    TTree* tree = chain.GetTree();
+    TFile* file = chain.GetCurrentFile();
+    if (!tree || !file) {
+      return;
+    }  // if
+    const Long64_t entries = tree->GetReadEntry() + 1;
+    TTreeCache* cache = dynamic_cast<TTreeCache*>(file->GetCacheRead(tree));
+    if (cache) {
+      mHits += cache->GetEfficiencyRel() * entries;
+    }  // if
+    mEntries += entries;
+  }
+
+  void Print() const {
+    const Long64_t bytes = TFile::GetFileBytesRead() - mBytes;
+    const Int_t calls = TFile::GetFileReadCalls() - mCalls;
+    const double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - mStart).count();
+    std::cout << "Read " << bytes / 1.e6 << " MB in " << calls <<
+    " calls";
+    if (seconds > 0.) {
+      std::cout << " (" << bytes / 1.e6 / seconds << " MB/s)";
+    }  // if
+    std::cout << ", cache hit rate " <<
+    (mEntries > 0 ? 100. * mHits / mEntries : 0.) << "%" << std::endl;
+  }
+
+ protected:
+  Long64_t mBytes;
+  Int_t mCalls;
+  std::chrono::steady_clock::time_point mStart;
+  double mHits;
+  Long64_t mEntries;
+};
+
+/*
+ Chains the EICTrees of the input files, in order, and sets up reading
+ them with the input policy.
+ Complains and returns false if a file or its tree is missing.
+ */
+bool chainInputs(TChain& mcTree, const std::vector<TString>& inFileNames,
+                 const erhic::InputPolicy& inputPolicy) {
+  // Prefetching is set up when the files are opened
+  inputPolicy.ApplyGlobal();
+  for (unsigned i(0); i < inFileNames.size(); ++i) {
+    // Connect to each file now, so missing ones are reported up front
+    if (mcTree.Add(inFileNames.at(i), 0) == 0) {
+      std::cerr << "Unable to find EICTree in " << inFileNames.at(i) <<
+      std::endl;
+      return false;
+    }  // if
+  }  // for
+  if (inFileNames.empty() || mcTree.LoadTree(0) < 0) {
+    std::cerr << "No input to smear" << std::endl;
+    return false;
   }  // if
-  TTree* mcTree(NULL);
-  inFile.GetObject("EICTree", mcTree);
-  if (!mcTree) {
-    std::cerr << "Unable to find EICTree in " << inFileName << std::endl;
+  // Cache the branches we read. The chain passes this on to each file.
+  inputPolicy.Apply(mcTree);
+  return true;
+}
+
+/*
+ Writes the detector and output policy to the current directory, with
+ the statistics of the copy of the detector that did the smearing,
+ if it is instrumented.
+ */
+void writeSetup(const Smear::Detector& detector,
+                const Smear::Detector& smearing,
+                const erhic::OutputPolicy& policy) {
+  detector.Write("detector");
+  policy.Write("outputPolicy");
+  if (smearing.GetStats()) {
+    smearing.GetStats()->Write("detectorStats");
+    smearing.Print("stats");
+  }  // if
+}
+
+/*
+ Smears up to nEvents events from the EICTrees of the input files,
+ chained in order, to a single output file written with the output
+ policy. The input is read with the input policy.
+ Sparse events store only the detected particles of DIS events.
+ DIS events are smeared nReplicas times, replica 0 going to the
+ "Smeared" tree and replica k to "Smeared_k". A detector scanning
+ resolutions smears one replica per scan point.
+ Returns 0 upon success, 1 upon failure.
+ */
+int smearChain(const Smear::Detector& detector,
+               const std::vector<TString>& inFileNames,
+               const TString& outName, Long64_t nEvents,
+               const erhic::OutputPolicy& policy,
+               const erhic::InputPolicy& inputPolicy, bool sparse,
+               unsigned nReplicas) {
+  // Chain the Monte Carlo trees of the input files.
+  // Complain and quit if we don't find a file or its tree.
+  TChain mcTree("EICTree");
+  if (!chainInputs(mcTree, inFileNames, inputPolicy)) {
     return 1;
   }  // if
   std::unique_ptr<erhic::VirtualEventFactory> builder;
+  // The builder smears with its own copy of the detector, which
+  // holds the statistics of an instrumented detector.
+  const Smear::Detector* smearing(NULL);
+  Smear::EventDisFactory* disFactory(NULL);
   // Need to determine the type of object in the tree to choose
   // the correct smeared event builder.
-  TClass* branchClass = TClass::GetClass(mcTree->GetBranch("event")->GetClassName());
+  TClass* branchClass = TClass::GetClass(mcTree.GetBranch("event")->GetClassName());
   if (branchClass->InheritsFrom("erhic::EventDis")) {
-    builder.reset(new Smear::EventDisFactory(detector,
-                                             *(mcTree->GetBranch("event"))));
+    Smear::EventDisFactory* factory =
+      new Smear::EventDisFactory(detector, mcTree);
+    factory->SetSparse(sparse);
+    builder.reset(factory);
+    smearing = &factory->GetDetector();
+    disFactory = factory;
 #ifdef WITH_PYTHIA6
   } else if (branchClass->InheritsFrom("erhic::hadronic::EventMC")) {
-    builder.reset(new Smear::HadronicEventBuilder(detector,
-                                             *(mcTree->GetBranch("event"))));
+    Smear::HadronicEventBuilder* factory =
+      new Smear::HadronicEventBuilder(detector, mcTree);
+    builder.reset(factory);
+    smearing = &factory->GetDetector();
 #endif
   } else {
     std::cerr << branchClass->GetName() << " is not supported for smearing" <<
     std::endl;
+    return 1;
   }  // if
   // Open the output file.
   // Complain and quit if something goes wrong.
-  TString outName(outFileName);
-  if (outName.IsNull()) {
-    outName = TString(inFileName).ReplaceAll(".root", ".smear.root");
-  }  // if
+  policy.ApplyGlobal();
   TFile outFile(outName, "RECREATE");
   if (!outFile.IsOpen()) {
     std::cerr << "Unable to create " << outName << std::endl;
     return 1;
   }  // if
+  policy.Apply(outFile);
+  // Each point of a resolution scan is a replica
+  const unsigned nScanPoints = detector.GetNScanPoints();
+  if (nScanPoints > 0 && nReplicas == 1) {
+    nReplicas = nScanPoints;
+  } else if (nScanPoints > 0 && nReplicas != nScanPoints) {
+    std::cerr << "Need one replica for each of the " << nScanPoints <<
+    " scan points, not " << nReplicas << std::endl;
+    return 1;
+  }  // if
+  if (nReplicas > 1 && !disFactory) {
+    std::cerr << "Replicas are only supported for DIS events" << std::endl;
+    return 1;
+  }  // if
   TTree smearedTree("Smeared", "A tree of smeared Monte Carlo events");
-  TBranch* eventbranch = builder->Branch(smearedTree, "eventS");
-  if (mcTree->GetEntries() < nEvents || nEvents < 1) {
-    nEvents = mcTree->GetEntries();
+  // Trees of the further replicas, all filled by one call
+  std::vector<std::unique_ptr<TTree> > replicaTrees;
+  std::vector<TTree*> trees(1, &smearedTree);
+  for (unsigned k(1); k < nReplicas; ++k) {
+    replicaTrees.emplace_back(new TTree(TString::Format("Smeared_%u", k),
+                                        "A replica of the smeared events"));
+    trees.push_back(replicaTrees.back().get());
+  }  // for
+  // The DIS builder branches its recycled events. Other builders set the
+  // address of each event they fill, so the branch starts with one of
+  // our own.
+  TBranch* eventbranch(NULL);
+  std::vector<TBranch*> replicaBranches;
+  TObject* event(NULL);
+  if (replicaTrees.empty() && disFactory) {
+    eventbranch = disFactory->Branch(smearedTree, "eventS", policy);
+  } else if (disFactory) {
+    replicaBranches = disFactory->BranchReplicas(trees, "eventS", policy);
+    if (!replicaBranches.empty()) {
+      eventbranch = replicaBranches.front();
+    }  // if
+  } else {
+    eventbranch =
+      policy.Branch(smearedTree, "eventS", builder->EventName(), &event);
+  }  // if
+  std::unique_ptr<TObject> eventOwner(event);
+  if (!eventbranch) {
+    return 1;
+  }  // if
+  for (unsigned k(0); k < trees.size(); ++k) {
+    policy.Apply(*trees.at(k));
+  }  // for
+  if (mcTree.GetEntries() < nEvents || nEvents < 1) {
+    nEvents = mcTree.GetEntries();
   }  // if
   std::cout <<
   "/-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-/"
@@ -96,18 +321,446 @@ int SmearTree(const Smear::Detector& detector, const TString& inFileName,
   std::cout <<
   "/-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-/"
   << std::endl;
+  ReadStats reads;
   for (Long64_t i(0); i < nEvents; i++) {
     if (i % 10000 == 0 && i != 0) {
       std::cout << "Processing event " << i << std::endl;
     }  // if
-    mcTree->GetEntry(i);
-    builder->Fill(*eventbranch);
+    mcTree.GetEntry(i);
+    if (replicaTrees.empty()) {
+      builder->Fill(*eventbranch);
+    } else {
+      disFactory->FillReplicas(replicaBranches);
+    }  // if
+    // Collect the cache statistics of each file before moving on
+    TTree* current = mcTree.GetTree();
+    if (i + 1 == nEvents ||
+        current->GetReadEntry() + 1 == current->GetEntries()) {
+      reads.AddFile(mcTree);
+    }  // if
   }  // for
+  reads.Print();
   smearedTree.Write();
-  detector.Write("detector");
+  for (unsigned k(0); k < replicaTrees.size(); ++k) {
+    replicaTrees.at(k)->Write();
+  }  // for
+  writeSetup(detector, *smearing, policy);
   outFile.Purge();
   std::cout <<
   "|~~~~~~~~~~~~~~~~~~ Completed Successfully ~~~~~~~~~~~~~~~~~~~|"
   << std::endl;
   return 0;
 }
+
+/*
+ Progress of one input file smeared by SmearTreeShards().
+ */
+struct Shard {
+  TString input;
+  TString output;
+  UInt_t seed;
+  int status;
+  double seconds;
+  Long64_t nEvents;
+};
+
+/*
+ Smears one shard with its own random seed, so the result is the same
+ however many shards run at once. Returns the SmearTree() status.
+ */
+int smearShard(const Smear::Detector& detector, const Shard& shard,
+               Long64_t nEvents, const erhic::OutputPolicy& policy,
+               const erhic::InputPolicy& inputPolicy, bool sparse,
+               unsigned nReplicas) {
+  gRandom->SetSeed(shard.seed);
+  return smearChain(detector, std::vector<TString>(1, shard.input),
+                    shard.output, nEvents, policy, inputPolicy, sparse,
+                    nReplicas);
+}
+
+/*
+ Hands each event read by one thread to the threads smearing it with
+ each detector. The reader publishes an event by incrementing the
+ generation, and reads the next one once no worker is busy.
+ */
+struct Lockstep {
+  std::mutex mutex;
+  std::condition_variable read;  // Signalled when an event is published
+  std::condition_variable smeared;  // Signalled when no worker is busy
+  erhic::EventDis* event;
+  Long64_t generation;
+  unsigned nBusy;
+  bool finished;  // No more events
+};
+
+/*
+ The smearing of the input with one detector, into its own file.
+ */
+struct DetectorJob {
+  const Smear::Detector* detector;
+  Smear::EventDisFactory* factory;
+  TString output;
+  UInt_t seed;
+  int status;
+};
+
+/*
+ Smears each event published by the reader with the factory of the job,
+ writing to the output of the job, with its own random generator.
+ Sets the job status to 0 upon success, 1 upon failure.
+ */
+void smearJob(DetectorJob& job, const erhic::OutputPolicy& policy,
+              Lockstep& step) {
+  TRandom3 random(job.seed);
+  Smear::Distributor::SetThreadRandom(&random);
+  // Open the file in this thread, so its trees go to this thread's
+  // directory. Take part in the lockstep even if it fails.
+  TFile outFile(job.output, "RECREATE");
+  std::unique_ptr<TTree> smearedTree;
+  TBranch* eventbranch(NULL);
+  if (outFile.IsOpen()) {
+    policy.Apply(outFile);
+    smearedTree.reset(new TTree("Smeared",
+                                "A tree of smeared Monte Carlo events"));
+    eventbranch = job.factory->Branch(*smearedTree, "eventS", policy);
+    if (eventbranch) {
+      policy.Apply(*smearedTree);
+    }  // if
+  } else {
+    std::cerr << "Unable to create " << job.output << std::endl;
+  }  // if
+  Long64_t generation(0);
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(step.mutex);
+      step.read.wait(lock, [&step, generation] {
+          return step.generation != generation;
+        });
+      generation = step.generation;
+      if (step.finished) {
+        break;
+      }  // if
+    }
+    if (eventbranch) {
+      job.factory->SetMcEvent(step.event);
+      job.factory->Fill(*eventbranch);
+    }  // if
+    std::lock_guard<std::mutex> lock(step.mutex);
+    if (--step.nBusy == 0) {
+      step.smeared.notify_one();
+    }  // if
+  }  // while
+  if (eventbranch) {
+    smearedTree->Write();
+    writeSetup(*job.detector, job.factory->GetDetector(), policy);
+    outFile.Purge();
+    job.status = 0;
+  }  // if
+  Smear::Distributor::SetThreadRandom(NULL);
+}
+
+/*
+ Smears up to nEvents DIS events from the EICTrees of the input files,
+ read once, with each detector, to the output file of each detector.
+ Each detector smears in its own thread, with its own random seed drawn
+ from gRandom. Returns 0 upon success, 1 if any detector failed.
+ */
+int smearDetectors(const std::vector<Smear::Detector>& detectors,
+                   const std::vector<TString>& inFileNames,
+                   const std::vector<TString>& outNames, Long64_t nEvents,
+                   const erhic::OutputPolicy& policy,
+                   const erhic::InputPolicy& inputPolicy, bool sparse) {
+  // Make ROOT safe to use from several threads, and fill the particle
+  // table up front so the workers only ever read from it.
+  ROOT::EnableThreadSafety();
+  TDatabasePDG::Instance()->GetParticle(11);
+  TChain mcTree("EICTree");
+  if (!chainInputs(mcTree, inFileNames, inputPolicy)) {
+    return 1;
+  }  // if
+  TClass* branchClass = TClass::GetClass(mcTree.GetBranch("event")->GetClassName());
+  if (!branchClass->InheritsFrom("erhic::EventDis")) {
+    std::cerr << branchClass->GetName() <<
+    " is not supported for smearing with several detectors" << std::endl;
+    return 1;
+  }  // if
+  erhic::EventDis* mcEvent(NULL);
+  mcTree.SetBranchAddress("event", &mcEvent);
+  policy.ApplyGlobal();
+  // Copy the detectors here rather than in the workers, as copying
+  // their functions isn't safe to do from several threads at once.
+  std::vector<std::unique_ptr<Smear::EventDisFactory> > factories;
+  std::vector<DetectorJob> jobs;
+  for (unsigned i(0); i < detectors.size(); ++i) {
+    factories.emplace_back(new Smear::EventDisFactory(detectors.at(i)));
+    factories.back()->SetSparse(sparse);
+    DetectorJob job = {
+      &detectors.at(i), factories.back().get(), outNames.at(i),
+      gRandom->Integer(kMaxUInt - 1) + 1, 1
+    };
+    jobs.push_back(job);
+  }  // for
+  if (mcTree.GetEntries() < nEvents || nEvents < 1) {
+    nEvents = mcTree.GetEntries();
+  }  // if
+  std::cout <<
+  "/-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-/"
+  << std::endl;
+  std::cout <<
+  "/  Commencing Smearing of " << nEvents << " events with " <<
+  detectors.size() << " detectors."
+  << std::endl;
+  std::cout <<
+  "/-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-/"
+  << std::endl;
+  Lockstep step;
+  step.event = NULL;
+  step.generation = 0;
+  step.nBusy = 0;
+  step.finished = false;
+  std::vector<std::thread> workers;
+  for (unsigned i(0); i < jobs.size(); ++i) {
+    workers.push_back(std::thread(smearJob, std::ref(jobs.at(i)),
+                                  std::cref(policy), std::ref(step)));
+  }  // for
+  ReadStats reads;
+  for (Long64_t i(0); i <= nEvents; i++) {
+    std::unique_lock<std::mutex> lock(step.mutex);
+    step.smeared.wait(lock, [&step] { return step.nBusy == 0; });
+    if (i == nEvents) {
+      step.finished = true;
+    } else {
+      if (i % 10000 == 0 && i != 0) {
+        std::cout << "Processing event " << i << std::endl;
+      }  // if
+      mcTree.GetEntry(i);
+      // Done once here, as the workers only read the event: derive the
+      // quantities a slim event doesn't store, and fill the caches of the
+      // event so the workers never write to it.
+      erhic::EventMC* mc = dynamic_cast<erhic::EventMC*>(mcEvent);
+      if (mc) {
+        if (mc->IsSlim()) {
+          mc->ComputeDerivedQuantities();
+        }  // if
+        std::vector<const erhic::VirtualParticle*> beams;
+        mc->IdentifyBeams(beams);
+        mc->FinalStateMomentum();
+      }  // if
+      TTree* current = mcTree.GetTree();
+      if (i + 1 == nEvents ||
+          current->GetReadEntry() + 1 == current->GetEntries()) {
+        reads.AddFile(mcTree);
+      }  // if
+      step.event = mcEvent;
+      step.nBusy = jobs.size();
+    }  // if
+    ++step.generation;
+    step.read.notify_all();
+  }  // for
+  for (unsigned i(0); i < workers.size(); ++i) {
+    workers.at(i).join();
+  }  // for
+  reads.Print();
+  int status(0);
+  for (unsigned i(0); i < jobs.size(); ++i) {
+    if (jobs.at(i).status != 0) {
+      std::cerr << "Smearing to " << jobs.at(i).output << " failed" <<
+      std::endl;
+      status = 1;
+    }  // if
+  }  // for
+  if (status == 0) {
+    std::cout <<
+    "|~~~~~~~~~~~~~~~~~~ Completed Successfully ~~~~~~~~~~~~~~~~~~~|"
+    << std::endl;
+  }  // if
+  return status;
+}
+
+}  // anonymous namespace
+
+/**
+ Smear nEvents events from the TTree named EICTree in the named input file,
+ using the smearing definitions in the Detector.
+ Write the resulting Smeared TTree to a file named outFileName.
+ If nEvents <= 0 smear all events in the tree.
+ Several input files, separated by whitespace or commas and/or given
+ by wildcards, are chained into the one output; by default it is named
+ after the first of them.
+ Returns 0 upon success, 1 upon failure.
+ */
+int SmearTree(const Smear::Detector& detector, const TString& inFileName,
+              const TString& outFileName, Long64_t nEvents,
+              const erhic::OutputPolicy& policy,
+              const erhic::InputPolicy& inputPolicy, bool sparse,
+              unsigned nReplicas) {
+  const std::vector<TString> inFileNames = expandFileNames(inFileName);
+  if (inFileNames.empty()) {
+    std::cerr << "Unable to open " << inFileName << std::endl;
+    return 1;
+  }  // if
+  TString outName(outFileName);
+  if (outName.IsNull()) {
+    outName = smearedFileName(inFileNames.front());
+  }  // if
+  return smearChain(detector, inFileNames, outName, nEvents, policy,
+                    inputPolicy, sparse, nReplicas);
+}
+
+/**
+ Smears the input files, read once, with each detector in parallel.
+ Writes the Smeared tree of each detector to the output file of the
+ same index; by default they are named after the first input file,
+ e.g. ep.smear.0.root, ep.smear.1.root etc.
+ Returns 0 upon success, 1 upon failure.
+ */
+int SmearTree(const std::vector<Smear::Detector>& detectors,
+              const TString& inFileName,
+              const std::vector<TString>& outFileNames, Long64_t nEvents,
+              const erhic::OutputPolicy& policy,
+              const erhic::InputPolicy& inputPolicy, bool sparse) {
+  if (detectors.empty()) {
+    std::cerr << "No detectors to smear with" << std::endl;
+    return 1;
+  }  // if
+  const std::vector<TString> inFileNames = expandFileNames(inFileName);
+  if (inFileNames.empty()) {
+    std::cerr << "Unable to open " << inFileName << std::endl;
+    return 1;
+  }  // if
+  std::vector<TString> outNames(outFileNames);
+  if (outNames.empty()) {
+    TString base = smearedFileName(inFileNames.front());
+    base.ReplaceAll(".smear.root", ".smear");
+    for (unsigned i(0); i < detectors.size(); ++i) {
+      outNames.push_back(base + TString::Format(".%u.root", i));
+    }  // for
+  } else if (outNames.size() != detectors.size()) {
+    std::cerr << "Need one output file per detector" << std::endl;
+    return 1;
+  }  // if
+  return smearDetectors(detectors, inFileNames, outNames, nEvents, policy,
+                        inputPolicy, sparse);
+}
+
+/**
+ Smears each input file to its own output, running up to nJobs at once
+ as separate processes.
+ Returns the number of input files that failed, so 0 upon success.
+ */
+int SmearTreeShards(const Smear::Detector& detector,
+                    const TString& inFileNames,
+                    const TString& outputDirName,
+                    Long64_t nEvents,
+                    unsigned nJobs,
+                    const erhic::OutputPolicy& policy,
+                    const erhic::InputPolicy& inputPolicy, bool sparse,
+                    unsigned nReplicas) {
+  const std::vector<TString> inputs = expandFileNames(inFileNames);
+  if (inputs.empty()) {
+    std::cerr << "Unable to open " << inFileNames << std::endl;
+    return 1;
+  }  // if
+  // Draw the seeds up front, so they only depend on the state of
+  // gRandom on entry and not on the order in which shards finish.
+  std::vector<Shard> shards;
+  for (unsigned i(0); i < inputs.size(); ++i) {
+    Shard shard = {
+      inputs.at(i), smearedFileName(inputs.at(i), outputDirName),
+      gRandom->Integer(kMaxUInt - 1) + 1, -1, 0., 0
+    };
+    shards.push_back(shard);
+  }  // for
+  if (nJobs == 0) {
+    nJobs = std::max(1u, std::thread::hardware_concurrency());
+  }  // if
+  // A forked process only gets the thread calling fork(), so must not
+  // rely on the others, e.g. holding a lock
+  if (nJobs > 1 && ROOT::IsImplicitMTEnabled()) {
+    std::cerr << "Implicit multithreading is enabled, so smearing the " <<
+    "shards one after the other in this process" << std::endl;
+    nJobs = 1;
+  }  // if
+  typedef std::chrono::steady_clock Clock;
+  std::map<pid_t, std::pair<unsigned, Clock::time_point> > running;
+  unsigned next(0);
+  while (next < shards.size() || !running.empty()) {
+    if (next < shards.size() && (nJobs < 2 || running.size() < nJobs)) {
+      Shard& shard = shards.at(next);
+      const Clock::time_point start = Clock::now();
+      if (nJobs < 2) {
+        // Smear in this process, one shard after the other
+        shard.status = smearShard(detector, shard, nEvents, policy,
+                                  inputPolicy, sparse, nReplicas);
+        shard.seconds =
+          std::chrono::duration<double>(Clock::now() - start).count();
+        ++next;
+        continue;
+      }  // if
+      // Each process works on its own copy of the detector
+      std::cout.flush();
+      std::cerr.flush();
+      const pid_t pid = fork();
+      if (pid == 0) {
+        const int status = smearShard(detector, shard, nEvents, policy,
+                                      inputPolicy, sparse, nReplicas);
+        std::cout.flush();
+        std::cerr.flush();
+        // Skip ROOT's exit handlers, which belong to the parent
+        _exit(status);
+      } else if (pid < 0) {
+        std::cerr << "Unable to start a job for " << shard.input << std::endl;
+        shard.status = 1;
+      } else {
+        running[pid] = std::make_pair(next, start);
+      }  // if
+      ++next;
+      continue;
+    }  // if
+    // Only wait for our own jobs, leaving any other children of the
+    // process to whoever started them
+    bool finished(false);
+    for (auto job = running.begin(); job != running.end();) {
+      int status(0);
+      const pid_t pid = waitpid(job->first, &status, WNOHANG);
+      if (pid == 0) {
+        ++job;
+        continue;
+      }  // if
+      Shard& shard = shards.at(job->second.first);
+      shard.seconds = std::chrono::duration<double>(
+        Clock::now() - job->second.second).count();
+      // The job is lost if it can't be waited for
+      shard.status =
+        (pid > 0 && WIFEXITED(status) ? WEXITSTATUS(status) : 1);
+      job = running.erase(job);
+      finished = true;
+    }  // for
+    if (!finished) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }  // if
+  }  // while
+  // Summarise the throughput of each shard
+  int nFailed(0);
+  std::cout << "Shard summary (events, seconds, events/s):" << std::endl;
+  for (unsigned i(0); i < shards.size(); ++i) {
+    Shard& shard = shards.at(i);
+    if (shard.status == 0) {
+      TFile file(shard.output, "READ");
+      TTree* tree(NULL);
+      file.GetObject("Smeared", tree);
+      if (tree) {
+        shard.nEvents = tree->GetEntries();
+      }  // if
+    }  // if
+    if (shard.status != 0) {
+      ++nFailed;
+      std::cout << "  " << shard.input << ": FAILED" << std::endl;
+      continue;
+    }  // if
+    std::cout << "  " << shard.output << ": " << shard.nEvents << ", " <<
+    shard.seconds << ", " <<
+    (shard.seconds > 0. ? shard.nEvents / shard.seconds : 0.) << std::endl;
+  }  // for
+  return nFailed;
+}